@@ -0,0 +1,110 @@
+/**************************************************************
+ *                         aot.c
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Implementation for our aot.h
+ *
+ *     Purpose: Sets up the machine a translated program runs
+ * 				on, the same memory and console ./um uses, and
+ * 				hands it to the threaded engine if the translated
+ * 				code cannot go on. Stores into segment 0 mark the
+ * 				region they land in as stale, so its translation
+ * 				is never run again.
+ *
+ *     Success Output:
+ *              The output is identical to ./um on the same
+ *              program and input
+ *
+ *     Failure output:
+ *              A Hanson checked runtime exception is raised if
+ *              there is a problem executing any instruction
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "aot.h"
+#include "threaded.h"
+
+/*  Function: aot_store
+    Purpose: stores a word into segment 0 from translated code. If the
+    word is not the one the program was translated from, the region it is
+    in is marked stale.
+    Parameters: the machine, where to store, the word, and the pc of the
+    store
+    Returns: 1 if the word changed an instruction later in the running
+    region, which must then be left for the interpreter at the next pc,
+    otherwise 0
+    Expectation: the index must be in segment 0
+*/
+int aot_store(Aot_T aot, uint32_t index, uint32_t word, uint32_t pc)
+{
+    assert(aot != NULL);
+
+    segment_store(aot->memory_total, 0, index, word);
+    if (word == aot->image[index]) {
+        return 0;
+    }
+
+    uint32_t region = aot->region_of[index];
+    aot->stale[region] = 1;
+    return index > pc && region == aot->region_of[pc];
+}
+
+/*  Function: aot_main
+    Purpose: runs a translated program as ./um would run it, taking its
+    input from stdin and writing its output to stdout
+    Parameters: the arguments of the program, the words it was translated
+    from and how many there are, the region of every pc and how many
+    regions there are, and the translated code
+    Returns: 0 if the program halted, 1 if it ran off the end of segment 0,
+    RUN_LIMIT if it went over a memory limit
+    Expectation: no arguments after the name of the program
+*/
+int aot_main(int argc, char *argv[], const uint32_t *image, uint32_t length,
+             const uint32_t *region_of, uint32_t num_regions,
+             int (*run)(Aot_T aot))
+{
+    assert(image != NULL && region_of != NULL && run != NULL);
+
+    if (argc != 1) {
+        fprintf(stderr, "Usage: %s < input\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    struct Aot_T aot;
+    aot.memory_total = seg_new();
+    uint32_t *seg_0 = seg_initial(aot.memory_total, length);
+    assert(seg_0 != NULL);
+    memcpy(seg_0, image, (size_t) length * sizeof(uint32_t));
+    aot.console = console_new(STDIN_FILENO, STDOUT_FILENO, 0);
+    aot.image = image;
+    aot.length = length;
+    aot.region_of = region_of;
+    aot.stale = calloc((size_t) num_regions + 1, 1);
+    assert(aot.stale != NULL);
+
+    int result = run(&aot);
+
+    /* the interpreter decodes segment 0 as it is now, so it runs whatever
+       was stored over the translated words */
+    if (result == AOT_INTERPRET) {
+        Threaded_T machine = threaded_new(aot.memory_total, aot.console, 0);
+        uint64_t executed = 0;
+        threaded_jump(machine, aot.regs, aot.pc);
+        result = threaded_run(machine, RUN_UNLIMITED, &executed);
+        threaded_free(&machine);
+    }
+    else {
+        seg_free(aot.memory_total);
+    }
+
+    console_free(&aot.console);
+    free(aot.stale);
+    return result;
+}
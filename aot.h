@@ -0,0 +1,105 @@
+/**************************************************************
+ *                         aot.h
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Interface for the runtime of translated programs
+ *
+ *     Purpose: um2c translates a um program into C with one
+ * 				label per instruction, which is compiled against
+ * 				libum.a into a native executable. This is what
+ * 				that C calls: the macros its instructions are
+ * 				written with, the store into segment 0 and the
+ * 				main program. Translated code that may no longer
+ * 				match segment 0 (because it was stored to) is not
+ * 				run; the threaded engine takes over at that pc
+ * 				instead, as it does for loadprogram of another
+ * 				segment and for invalid words.
+ *
+ *     Success Output:
+ *              The output is identical to ./um on the same
+ *              program and input
+ *
+ *     Failure output:
+ *              A Hanson checked runtime exception is raised if
+ *              there is a problem executing any instruction
+ *
+ **************************************************************/
+
+#include <stdint.h>
+#include <assert.h>
+#include "seg_mem.h"
+#include "console.h"
+
+#ifndef AOT_H
+#define AOT_H
+
+/* what a translated program returns: it halted, or the interpreter has
+   to continue from the saved registers and pc */
+enum aot_status { AOT_HALTED = 0, AOT_INTERPRET };
+
+typedef struct Aot_T *Aot_T;
+
+/* this struct holds seven variables
+    1. The memory and console of the machine
+    2. The words the program was translated from and how many there are
+    3. The region of every pc, the translated code between one label and
+       the next, and whether each region has been stored to since
+    4. The registers and pc to continue from when the interpreter takes
+       over
+
+   It is defined here so that translated code can read it directly.
+*/
+struct Aot_T {
+    MemSeg_T memory_total;
+    Console_T console;
+    const uint32_t *image;
+    uint32_t length;
+    const uint32_t *region_of;
+    uint8_t *stale;
+    uint32_t regs[8];
+    uint32_t pc;
+};
+
+int aot_store(Aot_T aot, uint32_t index, uint32_t word, uint32_t pc);
+int aot_main(int argc, char *argv[], const uint32_t *image, uint32_t length,
+             const uint32_t *region_of, uint32_t num_regions,
+             int (*run)(Aot_T aot));
+
+/* the macros below are used by the code um2c writes, whose registers are
+   the locals r0 to r7. It has a label at the start of every region, a
+   table of them by pc called table, with fallback for every other pc, and
+   a label fallback that saves the registers and returns AOT_INTERPRET,
+   continuing from the pc in the local at */
+
+/* hands the rest of the run to the interpreter, starting at pc to */
+#define AOT_FALLBACK(to)                                                \
+        do {                                                            \
+                at = (to);                                              \
+                goto fallback;                                          \
+        } while (0)
+
+/* at the top of every region: a region that was stored to is interpreted */
+#define AOT_ENTER(region, to)                                           \
+        do {                                                            \
+                if (aot->stale[region]) {                               \
+                        AOT_FALLBACK(to);                               \
+                }                                                       \
+        } while (0)
+
+/* a jump to a target known only at run time. Targets without a label are
+   interpreted, and one past the end runs off the program, which the
+   interpreter reports */
+#define AOT_DISPATCH(target)                                            \
+        do {                                                            \
+                at = (target);                                          \
+                if (at > aot->length) {                                 \
+                        at = aot->length;                               \
+                }                                                       \
+                goto *table[at];                                        \
+        } while (0)
+
+#endif
+/* AOT_H */
@@ -0,0 +1,167 @@
+#!/bin/bash
+#
+#                          bench.sh
+#
+#     Assignment: Homework 6 - Universal Machine
+#     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+#     Date: Nov 21, 2021
+#
+#     Runs the benchmark images several times, checks every output
+#     against its golden file and writes the results as JSON:
+#     median and best wall time, instructions per second, peak RSS
+#     and the number of map and unmap instructions. The instruction
+#     and map counts come from one run of the profiling engine.
+#
+#     Usage: ./bench.sh [-u um] [-e engine] [-n runs] [-i "images"]
+#                       [-o results.json]
+#            ./bench.sh -c old.json new.json [-x percent]
+#
+#     The second form compares two result files, from two builds
+#     (-u) or two engines (-e), and flags every image that got more
+#     than percent (default 5) slower or whose output was wrong.
+#     It exits with failure if anything was flagged.
+#
+
+UM=./um
+ENGINE=threaded
+RUNS=3
+IMAGES="midmark sandmark codex advent"
+OUT=bench.json
+THRESHOLD=5
+COMPARE=""
+
+# name, program, input and golden output of every benchmark image
+image_file() {
+    case $1 in
+        midmark)  echo "midmark.um midmark.out /dev/null" ;;
+        sandmark) echo "sandmark.umz sandmark.out /dev/null" ;;
+        codex)    echo "codex.umz codex.out codex.in" ;;
+        advent)   echo "advent.umz advent.out advent.in" ;;
+        *)        echo "" ;;
+    esac
+}
+
+usage() {
+    echo "Usage: $0 [-u um] [-e engine] [-n runs] [-i \"images\"]" \
+         "[-o results.json]" >&2
+    echo "       $0 -c old.json new.json [-x percent]" >&2
+    exit 1
+}
+
+# prints the value of the first numeric field with a name in some JSON
+field() {
+    echo "$1" | grep -o "\"$2\": *[0-9.]*" | head -1 | sed 's/.*: *//'
+}
+
+# compares two result files, one image per line
+compare() {
+    local old=$1 new=$2 flagged=0
+    printf "%-10s %12s %12s %8s\n" image old_s new_s change
+    while read -r line; do
+        local name=$(echo "$line" | sed -n 's/.*"name": *"\([a-z]*\)".*/\1/p')
+        [ -z "$name" ] && continue
+        local before=$(grep "\"name\": \"$name\"" "$old")
+        local ok=$(echo "$line" | grep -c '"ok": true')
+        local new_s=$(field "$line" median_s)
+        if [ -z "$before" ]; then
+            printf "%-10s %12s %12s %8s\n" "$name" - "$new_s" new
+            continue
+        fi
+        local old_s=$(field "$before" median_s)
+        local verdict=$(awk -v a="$old_s" -v b="$new_s" -v t="$THRESHOLD" \
+            'BEGIN { c = a > 0 ? (b - a) / a * 100 : 0;
+                     printf "%+7.1f%% %s", c, (c > t ? "REGRESSION" : "") }')
+        if [ "$ok" = 0 ]; then
+            verdict="$verdict WRONG OUTPUT"
+        fi
+        printf "%-10s %12s %12s %s\n" "$name" "$old_s" "$new_s" "$verdict"
+        case $verdict in
+            *REGRESSION*|*WRONG*) flagged=1 ;;
+        esac
+    done < "$new"
+    return $flagged
+}
+
+while getopts "u:e:n:i:o:cx:" opt; do
+    case $opt in
+        u) UM=$OPTARG ;;
+        e) ENGINE=$OPTARG ;;
+        n) RUNS=$OPTARG ;;
+        i) IMAGES=$OPTARG ;;
+        o) OUT=$OPTARG ;;
+        c) COMPARE=1 ;;
+        x) THRESHOLD=$OPTARG ;;
+        *) usage ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+if [ -n "$COMPARE" ]; then
+    [ $# = 2 ] || usage
+    compare "$1" "$2"
+    exit $?
+fi
+[ $# = 0 ] || usage
+
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+failed=0
+
+{
+    echo "{ \"um\": \"$UM\", \"engine\": \"$ENGINE\", \"runs\": $RUNS,"
+    echo "  \"images\": ["
+} > "$OUT"
+
+first=1
+for name in $IMAGES; do
+    set -- $(image_file "$name")
+    [ $# = 3 ] || { echo "bench: unknown image $name" >&2; exit 1; }
+    program=$1 golden=$2 input=$3
+
+    # the instruction and map counts do not change from run to run
+    "$UM" -p "$TMP/profile.json" "$program" < "$input" > /dev/null
+    profile=$(tr -d '\n' < "$TMP/profile.json")
+    instructions=$(field "$profile" instructions)
+    maps=$(field "$profile" map)
+    unmaps=$(field "$profile" unmap)
+
+    ok=true
+    : > "$TMP/times"
+    rss=0
+    for run in $(seq "$RUNS"); do
+        start=$(date +%s%N)
+        "$UM" -t -e "$ENGINE" "$program" < "$input" > "$TMP/out" \
+                                                   2> "$TMP/err"
+        end=$(date +%s%N)
+        echo "$(( (end - start) / 1000 ))" >> "$TMP/times"
+        if ! cmp -s "$TMP/out" "$golden"; then
+            ok=false
+        fi
+        run_rss=$(sed -n 's/^peak rss: *\([0-9]*\).*/\1/p' "$TMP/err")
+        [ "${run_rss:-0}" -gt "$rss" ] && rss=$run_rss
+    done
+    [ $ok = true ] || failed=1
+
+    median=$(sort -n "$TMP/times" | awk '{ t[NR] = $1 }
+        END { print (NR % 2 ? t[(NR + 1) / 2] : (t[NR / 2] + t[NR / 2 + 1]) / 2) / 1e6 }')
+    best=$(sort -n "$TMP/times" | head -1 | awk '{ print $1 / 1e6 }')
+    mips=$(awk -v i="$instructions" -v s="$median" \
+           'BEGIN { printf "%.1f", (s > 0 ? i / s / 1e6 : 0) }')
+
+    printf "%-10s %-5s median %8.3fs  best %8.3fs  %8s Minstr/s  rss %7s KB" \
+           "$name" "$ok" "$median" "$best" "$mips" "$rss"
+    printf "  map %s unmap %s\n" "$maps" "$unmaps"
+
+    [ $first = 1 ] || echo "," >> "$OUT"
+    first=0
+    printf "    { \"name\": \"%s\", \"ok\": %s, \"instructions\": %s, " \
+           "$name" "$ok" "$instructions" >> "$OUT"
+    printf "\"median_s\": %s, \"best_s\": %s, \"mips\": %s, " \
+           "$median" "$best" "$mips" >> "$OUT"
+    printf "\"peak_rss_kb\": %s, \"maps\": %s, \"unmaps\": %s }" \
+           "$rss" "$maps" "$unmaps" >> "$OUT"
+done
+
+printf "\n  ]\n}\n" >> "$OUT"
+echo "results written to $OUT"
+exit $failed
@@ -0,0 +1,527 @@
+/**************************************************************
+ *                         cfg.c
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Implementation for our cfg.h
+ *
+ *     Purpose: Splits the words of a program into basic blocks
+ * 				and links them by the jumps between them. Block
+ * 				leaders are pc 0, every word after a LOADP or
+ * 				HALT and every jump target found so far; since a
+ * 				new leader ends a block early, which can lose a
+ * 				constant, the scan is repeated until no new
+ * 				leader turns up.
+ *
+ *     Success Output:
+ *              Every word belongs to exactly one block
+ *
+ *     Failure output:
+ *              A Hanson checked runtime exception is raised if
+ *              memory for the graph cannot be allocated
+ *
+ **************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "cfg.h"
+#include "decode.h"
+
+/* the constants a register may hold at some point of a block: n of them,
+   or any value at all if n is 0 */
+struct Values {
+    int n;
+    uint32_t v[CFG_MAX_VALUES];
+};
+
+/*  Function: add_value
+    Purpose: adds a constant to a set, which becomes unknown if it is full
+    Parameters: the set, the constant
+    Returns: N/A
+    Expectation: the set is not unknown
+*/
+static void add_value(struct Values *set, uint32_t value)
+{
+    for (int i = 0; i < set->n; i++) {
+        if (set->v[i] == value) {
+            return;
+        }
+    }
+    if (set->n == CFG_MAX_VALUES) {
+        set->n = 0;
+        return;
+    }
+    set->v[set->n++] = value;
+}
+
+/*  Function: join
+    Purpose: gives the constants either of two sets may hold
+    Parameters: where to put the result, the two sets
+    Returns: N/A
+*/
+static void join(struct Values *result, const struct Values *x,
+                 const struct Values *y)
+{
+    struct Values joined = *x;
+    for (int i = 0; i < y->n && joined.n != 0; i++) {
+        add_value(&joined, y->v[i]);
+    }
+    if (y->n == 0) {
+        joined.n = 0;
+    }
+    *result = joined;
+}
+
+/*  Function: arith
+    Purpose: gives the constants an arithmetic instruction may compute
+    from two sets. A division by zero is left out, as it cannot happen in
+    a program that runs.
+    Parameters: where to put the result, the opcode, the two sets
+    Returns: N/A
+*/
+static void arith(struct Values *result, unsigned op, const struct Values *x,
+                  const struct Values *y)
+{
+    struct Values out = { 0, { 0 } };
+    int any = 0;
+
+    for (int i = 0; i < x->n && y->n != 0; i++) {
+        for (int j = 0; j < y->n; j++) {
+            uint32_t a = x->v[i], b = y->v[j], value;
+            if (op == OP_ADD) {
+                value = a + b;
+            }
+            else if (op == OP_MUL) {
+                value = a * b;
+            }
+            else if (op == OP_DIV) {
+                if (b == 0) {
+                    continue;
+                }
+                value = a / b;
+            }
+            else {
+                value = ~(a & b);
+            }
+
+            if (!any) {
+                out.n = 1;
+                out.v[0] = value;
+                any = 1;
+            }
+            else {
+                add_value(&out, value);
+                if (out.n == 0) {
+                    *result = out;
+                    return;
+                }
+            }
+        }
+    }
+    *result = out;
+}
+
+/*  Function: truth
+    Purpose: says what a set gives as the condition of a CMOV
+    Parameters: the set
+    Returns: 1 if every constant is non-zero, 0 if every one is zero, and
+    -1 if it could be either
+*/
+static int truth(const struct Values *set)
+{
+    int zeros = 0;
+    for (int i = 0; i < set->n; i++) {
+        zeros += set->v[i] == 0;
+    }
+    if (set->n == 0 || (zeros != 0 && zeros != set->n)) {
+        return -1;
+    }
+    return zeros == 0;
+}
+
+/*  Function: scan_block
+    Purpose: runs through one block, following the constants every
+    register may hold, to find where it ends and where it goes
+    Parameters: the program and its length, the leaders so far, the pc the
+    block starts at, where to put how it ends and the targets of its jump
+    Returns: the pc after its last instruction
+*/
+static uint32_t scan_block(const uint32_t *code, uint32_t length,
+                           const uint8_t *leader, uint32_t start, int *how,
+                           struct Values *targets)
+{
+    /* nothing is known about the registers when a block is entered */
+    struct Values r[8];
+    memset(r, 0, sizeof(r));
+    targets->n = 0;
+
+    for (uint32_t pc = start; pc < length; ) {
+        uint32_t word = code[pc++];
+        unsigned op = word >> 28;
+        unsigned a = (word >> 6) & 0x7, b = (word >> 3) & 0x7, c = word & 0x7;
+
+        switch (op) {
+        case OP_CMOV:
+            if (truth(&r[c]) == 1) {
+                r[a] = r[b];
+            }
+            else if (truth(&r[c]) == -1) {
+                join(&r[a], &r[a], &r[b]);
+            }
+            break;
+        case OP_SLOAD:
+            r[a].n = 0;
+            break;
+        case OP_ADD:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_NAND:
+            arith(&r[a], op, &r[b], &r[c]);
+            break;
+        case OP_MAP:
+            r[b].n = 0;
+            break;
+        case OP_IN:
+            r[c].n = 0;
+            break;
+        case OP_LV:
+            r[(word >> 25) & 0x7].n = 1;
+            r[(word >> 25) & 0x7].v[0] = word & 0x1ffffff;
+            break;
+        case OP_LOADP: {
+            int loads = r[b].n != 0;
+            for (int i = 0; i < r[b].n; i++) {
+                loads = loads && r[b].v[i] != 0;
+            }
+            if (loads) {
+                *how = EXIT_LOADPROGRAM;
+            }
+            else if (r[c].n == 0) {
+                *how = EXIT_COMPUTED;
+            }
+            else {
+                *how = EXIT_JUMP;
+                *targets = r[c];
+            }
+            return pc;
+        }
+        case OP_HALT:
+            *how = EXIT_HALT;
+            return pc;
+        case OP_SSTORE:
+        case OP_UNMAP:
+        case OP_OUT:
+            break;
+        default:
+            *how = EXIT_INVALID;
+            return pc;
+        }
+
+        if (pc < length && leader[pc]) {
+            *how = EXIT_FALL;
+            return pc;
+        }
+    }
+
+    *how = EXIT_FALL;
+    return length;
+}
+
+/*  Function: find_leaders
+    Purpose: marks the first pc of every block
+    Parameters: the program and its length, the array of marks, with room
+    for length + 1
+    Returns: N/A
+*/
+static void find_leaders(const uint32_t *code, uint32_t length,
+                         uint8_t *leader)
+{
+    leader[0] = 1;
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        uint32_t pc = 0;
+        while (pc < length) {
+            int how;
+            struct Values targets;
+            uint32_t end = scan_block(code, length, leader, pc, &how,
+                                      &targets);
+            for (int i = 0; i < targets.n; i++) {
+                if (targets.v[i] < length && !leader[targets.v[i]]) {
+                    leader[targets.v[i]] = 1;
+                    changed = 1;
+                }
+            }
+            if (!leader[end]) {
+                leader[end] = 1;
+                changed = 1;
+            }
+            pc = end;
+        }
+    }
+}
+
+/*  Function: loop_body
+    Purpose: finds the natural loop of a header: the blocks that reach one
+    of its back edges without going through the header
+    Parameters: the predecessor lists of the graph (preds[first[i]] up to
+    preds[first[i + 1]] lead to block i), the header, the tails of its
+    back edges and how many there are, an array of stamps, the stamp for
+    this loop, and a work stack with room for every block
+    Returns: the loop, whose blocks are malloc'd
+*/
+static struct Loop loop_body(const uint32_t *first,
+                             const uint32_t *preds, uint32_t header,
+                             const uint32_t *tails, uint32_t num_tails,
+                             uint32_t *stamps, uint32_t stamp,
+                             uint32_t *stack)
+{
+    struct Loop loop = { header, 0, 0, NULL };
+    uint32_t depth = 0;
+
+    stamps[header] = stamp;
+    loop.num_blocks = 1;
+    for (uint32_t i = 0; i < num_tails; i++) {
+        if (stamps[tails[i]] != stamp) {
+            stamps[tails[i]] = stamp;
+            stack[depth++] = tails[i];
+        }
+    }
+
+    /* the stack ends up holding the body, so it is also the result */
+    uint32_t done = 0;
+    while (done < depth) {
+        uint32_t block = stack[done++];
+        for (uint32_t p = first[block]; p < first[block + 1]; p++) {
+            if (stamps[preds[p]] != stamp) {
+                stamps[preds[p]] = stamp;
+                stack[depth++] = preds[p];
+            }
+        }
+    }
+
+    loop.num_blocks += depth;
+    loop.blocks = malloc(loop.num_blocks * sizeof(uint32_t));
+    assert(loop.blocks != NULL);
+    loop.blocks[0] = header;
+    memcpy(loop.blocks + 1, stack, depth * sizeof(uint32_t));
+    return loop;
+}
+
+/*  Function: find_loops
+    Purpose: marks every block entered by a back edge of a depth first
+    search from block 0 as a loop header, and finds the body of each
+    Parameters: the graph, with its blocks and edges
+    Returns: N/A
+*/
+static void find_loops(Cfg_T cfg)
+{
+    uint32_t n = cfg->num_blocks;
+    struct Block *blocks = cfg->blocks;
+
+    /* predecessor lists, one run of preds per block */
+    uint32_t *first = calloc(n + 1, sizeof(uint32_t));
+    assert(first != NULL);
+    for (uint32_t i = 0; i < n; i++) {
+        for (int s = 0; s < blocks[i].num_succs; s++) {
+            first[blocks[i].succs[s] + 1]++;
+        }
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        first[i + 1] += first[i];
+    }
+    uint32_t *preds = malloc((first[n] + 1) * sizeof(uint32_t));
+    uint32_t *fill = malloc((n + 1) * sizeof(uint32_t));
+    assert(preds != NULL && fill != NULL);
+    memcpy(fill, first, (n + 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; i++) {
+        for (int s = 0; s < blocks[i].num_succs; s++) {
+            preds[fill[blocks[i].succs[s]]++] = i;
+        }
+    }
+
+    /* an iterative search, so a long chain of blocks cannot overflow the
+       C stack. An edge to a block still on the stack is a back edge */
+    uint8_t *state = calloc(n, 1);
+    uint32_t *stack = malloc((n + 1) * sizeof(uint32_t));
+    int *next = calloc(n, sizeof(int));
+    uint32_t *back_tail = malloc((first[n] + 1) * sizeof(uint32_t));
+    uint32_t *back_head = malloc((first[n] + 1) * sizeof(uint32_t));
+    assert(state && stack && next && back_tail && back_head);
+    uint32_t num_back = 0;
+
+    for (uint32_t root = 0; root < n; root++) {
+        if (state[root] != 0) {
+            continue;
+        }
+        uint32_t depth = 0;
+        stack[depth++] = root;
+        state[root] = 1;
+        while (depth > 0) {
+            uint32_t block = stack[depth - 1];
+            if (next[block] == blocks[block].num_succs) {
+                state[block] = 2;
+                depth--;
+                continue;
+            }
+            uint32_t succ = blocks[block].succs[next[block]++];
+            if (state[succ] == 0) {
+                state[succ] = 1;
+                stack[depth++] = succ;
+            }
+            else if (state[succ] == 1) {
+                back_tail[num_back] = block;
+                back_head[num_back++] = succ;
+                blocks[succ].loop = 1;
+            }
+        }
+    }
+
+    /* one loop per header, with the tails of all its back edges */
+    uint32_t *stamps = calloc(n, sizeof(uint32_t));
+    uint32_t *tails = malloc((num_back + 1) * sizeof(uint32_t));
+    assert(stamps != NULL && tails != NULL);
+    cfg->loops = malloc((n + 1) * sizeof(struct Loop));
+    assert(cfg->loops != NULL);
+    cfg->num_loops = 0;
+
+    for (uint32_t header = 0; header < n; header++) {
+        if (!blocks[header].loop) {
+            continue;
+        }
+        uint32_t num_tails = 0;
+        for (uint32_t e = 0; e < num_back; e++) {
+            if (back_head[e] == header) {
+                tails[num_tails++] = back_tail[e];
+            }
+        }
+        cfg->loops[cfg->num_loops] = loop_body(first, preds, header,
+                                               tails, num_tails, stamps,
+                                               cfg->num_loops + 1, stack);
+        cfg->num_loops++;
+    }
+
+    free(first);
+    free(preds);
+    free(fill);
+    free(state);
+    free(stack);
+    free(next);
+    free(back_tail);
+    free(back_head);
+    free(stamps);
+    free(tails);
+}
+
+/*  Function: cfg_new
+    Purpose: builds the control-flow graph of a program
+    Parameters: the words of the program and how many there are
+    Returns: an allocated Cfg_T, which points at the words
+    Expectation: the words stay as they are while the graph is used
+*/
+Cfg_T cfg_new(const uint32_t *code, uint32_t length)
+{
+    assert(code != NULL || length == 0);
+
+    Cfg_T cfg = malloc(sizeof(struct Cfg_T));
+    assert(cfg != NULL);
+    cfg->code = code;
+    cfg->length = length;
+
+    uint8_t *leader = calloc((size_t) length + 1, 1);
+    assert(leader != NULL);
+    find_leaders(code, length, leader);
+
+    cfg->num_blocks = 0;
+    for (uint32_t pc = 0; pc < length; pc++) {
+        cfg->num_blocks += leader[pc];
+    }
+    cfg->blocks = calloc(cfg->num_blocks + 1, sizeof(struct Block));
+    cfg->block_of = malloc(((size_t) length + 1) * sizeof(uint32_t));
+    struct Values *targets = malloc((cfg->num_blocks + 1) *
+                                    sizeof(struct Values));
+    assert(cfg->blocks && cfg->block_of && targets);
+
+    /* the leaders no longer change, so one more scan gives the blocks */
+    uint32_t i = 0;
+    for (uint32_t pc = 0; pc < length; i++) {
+        struct Block *block = &cfg->blocks[i];
+        block->start = pc;
+        block->end = scan_block(code, length, leader, pc, &block->exit,
+                                &targets[i]);
+        for (; pc < block->end; pc++) {
+            cfg->block_of[pc] = i;
+        }
+    }
+    assert(i == cfg->num_blocks);
+
+    for (i = 0; i < cfg->num_blocks; i++) {
+        struct Block *block = &cfg->blocks[i];
+        if (block->exit == EXIT_FALL && block->end < length) {
+            block->succs[block->num_succs++] = cfg->block_of[block->end];
+        }
+        for (int t = 0; block->exit == EXIT_JUMP && t < targets[i].n; t++) {
+            if (targets[i].v[t] < length) {
+                block->succs[block->num_succs++] =
+                        cfg->block_of[targets[i].v[t]];
+            }
+        }
+    }
+
+    free(leader);
+    free(targets);
+    find_loops(cfg);
+    return cfg;
+}
+
+/*  Function: cfg_free
+    Purpose: frees a control-flow graph, but not the words it points at
+    Parameters: a pointer to the graph
+    Returns: N/A
+    Expectation: the graph must not be NULL
+*/
+void cfg_free(Cfg_T *cfg)
+{
+    assert(cfg != NULL && *cfg != NULL);
+
+    for (uint32_t i = 0; i < (*cfg)->num_loops; i++) {
+        free((*cfg)->loops[i].blocks);
+    }
+    free((*cfg)->loops);
+    free((*cfg)->blocks);
+    free((*cfg)->block_of);
+    free(*cfg);
+    *cfg = NULL;
+}
+
+/*  Function: cfg_counts
+    Purpose: lays a profile over the graph: how many times every block was
+    entered and how many instructions ran in every block and loop
+    Parameters: the graph, and how many times every pc ran
+    Returns: N/A
+    Expectation: counts has one entry for every word of the program
+*/
+void cfg_counts(Cfg_T cfg, const uint64_t *counts)
+{
+    assert(cfg != NULL && counts != NULL);
+
+    for (uint32_t i = 0; i < cfg->num_blocks; i++) {
+        struct Block *block = &cfg->blocks[i];
+        block->entries = counts[block->start];
+        block->instructions = 0;
+        for (uint32_t pc = block->start; pc < block->end; pc++) {
+            block->instructions += counts[pc];
+        }
+    }
+    for (uint32_t l = 0; l < cfg->num_loops; l++) {
+        struct Loop *loop = &cfg->loops[l];
+        loop->instructions = 0;
+        for (uint32_t i = 0; i < loop->num_blocks; i++) {
+            loop->instructions += cfg->blocks[loop->blocks[i]].instructions;
+        }
+    }
+}
@@ -0,0 +1,102 @@
+/**************************************************************
+ *                         cfg.h
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Interface for our control-flow graph of a UM program
+ *
+ *     Purpose: Splits the words of a program into basic blocks
+ * 				and links them by the jumps between them. The
+ * 				only jump is LOADP, whose target is a register,
+ * 				so the constants every register can hold are
+ * 				followed through each block (through LV, CMOV
+ * 				and arithmetic) to find the targets. Jumps that
+ * 				cannot be resolved that way are marked computed.
+ * 				Loops are found from the back edges of a depth
+ * 				first search, and execution counts from um -P can
+ * 				be laid over blocks and loops.
+ *
+ *     Success Output:
+ *              Every word belongs to exactly one block
+ *
+ *     Failure output:
+ *              A Hanson checked runtime exception is raised if
+ *              memory for the graph cannot be allocated
+ *
+ **************************************************************/
+
+#include <stdint.h>
+
+#ifndef CFG_H
+#define CFG_H
+
+/* the most constants a register is followed through before it is treated
+   as unknown, and so the most targets a jump can have */
+#define CFG_MAX_VALUES 4
+
+/* how a block ends: by running into the next block, a jump with known
+   targets, a jump whose target is not known, a loadprogram of another
+   segment, a halt, or a word that is not an instruction */
+enum block_exit { EXIT_FALL = 0, EXIT_JUMP, EXIT_COMPUTED, EXIT_LOADPROGRAM,
+    EXIT_HALT, EXIT_INVALID };
+
+/* this struct holds seven variables
+    1. The pc of its first instruction and the pc after its last
+    2. The index of every block it can go to next, and how many there are
+    3. How it ends, an enum block_exit
+    4. Whether it is the header of a loop
+    5. With a profile, how many times it was entered and how many of its
+       instructions ran
+*/
+struct Block {
+    uint32_t start;
+    uint32_t end;
+    uint32_t succs[CFG_MAX_VALUES];
+    int num_succs;
+    int exit;
+    int loop;
+    uint64_t entries;
+    uint64_t instructions;
+};
+
+/* this struct holds four variables
+    1. The header block of the loop
+    2. How many blocks are in its body, counting the header
+    3. With a profile, how many instructions ran in its body
+    4. The blocks of its body, the header first
+*/
+struct Loop {
+    uint32_t header;
+    uint32_t num_blocks;
+    uint64_t instructions;
+    uint32_t *blocks;
+};
+
+typedef struct Cfg_T *Cfg_T;
+
+/* this struct holds seven variables
+    1. The words of the program and how many there are
+    2. Its blocks in pc order, and how many there are
+    3. The index of the block every pc belongs to
+    4. Its loops, and how many there are
+
+   It is defined here so that umdump can walk the graph directly.
+*/
+struct Cfg_T {
+    const uint32_t *code;
+    uint32_t length;
+    struct Block *blocks;
+    uint32_t num_blocks;
+    uint32_t *block_of;
+    struct Loop *loops;
+    uint32_t num_loops;
+};
+
+Cfg_T cfg_new(const uint32_t *code, uint32_t length);
+void cfg_free(Cfg_T *cfg);
+void cfg_counts(Cfg_T cfg, const uint64_t *counts);
+
+#endif
+/* CFG_H */
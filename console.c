@@ -0,0 +1,438 @@
+/**************************************************************
+ *                       console.c
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Implementation for our console.h
+ *
+ *     Purpose: Buffers the bytes of the OUT and IN instructions
+ * 				so that they do not cost a locked stdio call
+ * 				each. Output is written when the buffer fills,
+ * 				when an IN has to wait for input and when the
+ * 				console is freed at halt. Input is read from
+ * 				the descriptor in large blocks. Output can also
+ * 				be handed to a writer thread through a lock-free
+ * 				ring, so a slow reader downstream of the pipe
+ * 				does not stall the machine. A console made with
+ * 				CONSOLE_MEMORY is instead fed and drained by a
+ * 				host program embedding the machine.
+ *
+ *     Success Output:
+ *              Every byte is written in order, exactly once
+ *
+ *     Failure output:
+ *              A Hanson checked runtime exception is raised if
+ *              the buffers or the writer thread cannot be set up
+ *
+ **************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "console.h"
+#include "session.h"
+
+/* size of the output buffer, and of each read() of input */
+static const size_t OUT_SIZE = 64 * 1024;
+static const size_t IN_SIZE = 64 * 1024;
+
+/* size of the ring shared with the writer thread, a power of two */
+static const size_t RING_SIZE = 4 * 1024 * 1024;
+
+/* a single-producer, single-consumer byte ring. head and tail count every
+   byte ever pushed and popped, so head - tail is the number of bytes
+   waiting. The machine only writes head and the writer thread only writes
+   tail, so neither needs a lock to move bytes. A side that has to wait
+   (the writer on an empty ring, the machine on a full one) says so in
+   writer_asleep or machine_asleep and sleeps on its condition, and the
+   other side only takes the lock to wake it when that flag is set */
+struct Ring {
+    unsigned char *data;
+    size_t size;
+    size_t head;
+    size_t tail;
+    int done;
+    int fd;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t filled;
+    pthread_cond_t emptied;
+    int writer_asleep;
+    int machine_asleep;
+};
+
+/*  Function: write_all
+    Purpose: writes every byte of a buffer, retrying short writes
+    Parameters: the descriptor, the bytes, how many there are
+    Returns: N/A. Write errors are ignored, as putchar's would be.
+*/
+static void write_all(int fd, const unsigned char *bytes, size_t count)
+{
+    while (count > 0) {
+        ssize_t done = write(fd, bytes, count);
+        if (done < 0 && errno == EINTR) {
+            continue;
+        }
+        if (done <= 0) {
+            return;
+        }
+        bytes += done;
+        count -= done;
+    }
+}
+
+/*  Function: wake
+    Purpose: wakes the other side of the ring if it is asleep. The caller
+    has just moved head or tail with a sequentially consistent store, and
+    the sleeper sets its flag the same way before checking them again, so
+    either it sees the move or this sees the flag.
+    Parameters: the ring, the sleeper's flag and its condition
+    Returns: N/A
+*/
+static void wake(struct Ring *ring, int *asleep, pthread_cond_t *cond)
+{
+    if (__atomic_load_n(asleep, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&ring->lock);
+        pthread_cond_signal(cond);
+        pthread_mutex_unlock(&ring->lock);
+    }
+}
+
+/*  Function: writer
+    Purpose: body of the writer thread. Writes whatever is waiting in the
+    ring until the console is freed and the ring is empty.
+    Parameters: the ring
+    Returns: NULL
+*/
+static void *writer(void *cl)
+{
+    struct Ring *ring = cl;
+
+    for (;;) {
+        size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        size_t waiting = head - ring->tail;
+
+        if (waiting == 0) {
+            if (__atomic_load_n(&ring->done, __ATOMIC_ACQUIRE) &&
+                __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == ring->tail) {
+                return NULL;
+            }
+
+            /* sleep until the machine pushes bytes or frees the console */
+            pthread_mutex_lock(&ring->lock);
+            __atomic_store_n(&ring->writer_asleep, 1, __ATOMIC_SEQ_CST);
+            while (__atomic_load_n(&ring->head, __ATOMIC_SEQ_CST) ==
+                   ring->tail &&
+                   !__atomic_load_n(&ring->done, __ATOMIC_SEQ_CST)) {
+                pthread_cond_wait(&ring->filled, &ring->lock);
+            }
+            __atomic_store_n(&ring->writer_asleep, 0, __ATOMIC_RELAXED);
+            pthread_mutex_unlock(&ring->lock);
+            continue;
+        }
+
+        /* write up to the end of the ring, the rest goes next time */
+        size_t start = ring->tail & (ring->size - 1);
+        size_t chunk = ring->size - start < waiting ? ring->size - start
+                                                    : waiting;
+        write_all(ring->fd, ring->data + start, chunk);
+        __atomic_store_n(&ring->tail, ring->tail + chunk, __ATOMIC_SEQ_CST);
+        wake(ring, &ring->machine_asleep, &ring->emptied);
+    }
+}
+
+/*  Function: ring_push
+    Purpose: copies bytes into the ring, waiting for room if the writer
+    thread has fallen a whole ring behind
+    Parameters: the ring, the bytes, how many there are
+    Returns: N/A
+*/
+static void ring_push(struct Ring *ring, const unsigned char *bytes,
+                      size_t count)
+{
+    while (count > 0) {
+        size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        size_t room = ring->size - (ring->head - tail);
+
+        if (room == 0) {
+            /* sleep until the writer thread has written some out */
+            pthread_mutex_lock(&ring->lock);
+            __atomic_store_n(&ring->machine_asleep, 1, __ATOMIC_SEQ_CST);
+            while (__atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST) == tail) {
+                pthread_cond_wait(&ring->emptied, &ring->lock);
+            }
+            __atomic_store_n(&ring->machine_asleep, 0, __ATOMIC_RELAXED);
+            pthread_mutex_unlock(&ring->lock);
+            continue;
+        }
+
+        size_t start = ring->head & (ring->size - 1);
+        size_t chunk = ring->size - start;
+        if (chunk > room) {
+            chunk = room;
+        }
+        if (chunk > count) {
+            chunk = count;
+        }
+        memcpy(ring->data + start, bytes, chunk);
+        __atomic_store_n(&ring->head, ring->head + chunk, __ATOMIC_SEQ_CST);
+        wake(ring, &ring->writer_asleep, &ring->filled);
+        bytes += chunk;
+        count -= chunk;
+    }
+}
+
+/*  Function: console_new
+    Purpose: creates a console reading from and writing to two descriptors
+    Parameters: the input descriptor, the output descriptor, either of
+    which may be CONSOLE_MEMORY, and whether output is handed to a writer
+    thread
+    Returns: an allocated Console_T
+    Expectation: output kept for console_drain is not handed to a thread
+*/
+Console_T console_new(int in_fd, int out_fd, int async)
+{
+    assert(!async || out_fd != CONSOLE_MEMORY);
+
+    Console_T console = malloc(sizeof(struct Console_T));
+    assert(console != NULL);
+
+    console->out = malloc(OUT_SIZE);
+    console->in = malloc(IN_SIZE);
+    assert(console->out != NULL && console->in != NULL);
+    console->out_len = 0;
+    console->out_cap = OUT_SIZE;
+    console->in_pos = 0;
+    console->in_len = 0;
+    console->in_cap = IN_SIZE;
+    console->in_fd = in_fd;
+    console->out_fd = out_fd;
+    console->eof = 0;
+    console->ring = NULL;
+
+    if (async) {
+        struct Ring *ring = malloc(sizeof(struct Ring));
+        assert(ring != NULL);
+        ring->data = malloc(RING_SIZE);
+        assert(ring->data != NULL);
+        ring->size = RING_SIZE;
+        ring->head = 0;
+        ring->tail = 0;
+        ring->done = 0;
+        ring->fd = out_fd;
+        ring->writer_asleep = 0;
+        ring->machine_asleep = 0;
+        pthread_mutex_init(&ring->lock, NULL);
+        pthread_cond_init(&ring->filled, NULL);
+        pthread_cond_init(&ring->emptied, NULL);
+        int rc = pthread_create(&ring->thread, NULL, writer, ring);
+        assert(rc == 0);
+        (void) rc;
+        console->ring = ring;
+    }
+
+    return console;
+}
+
+/*  Function: console_free
+    Purpose: writes any pending output, waits for the writer thread to
+    finish, and frees the console
+    Parameters: a pointer to the console to be freed
+    Returns: N/A
+    Expectation: the console must not be NULL
+*/
+void console_free(Console_T *console)
+{
+    assert(console != NULL && *console != NULL);
+
+    console_flush(*console);
+
+    struct Ring *ring = (*console)->ring;
+    if (ring != NULL) {
+        __atomic_store_n(&ring->done, 1, __ATOMIC_SEQ_CST);
+        wake(ring, &ring->writer_asleep, &ring->filled);
+        pthread_join(ring->thread, NULL);
+        pthread_cond_destroy(&ring->filled);
+        pthread_cond_destroy(&ring->emptied);
+        pthread_mutex_destroy(&ring->lock);
+        free(ring->data);
+        free(ring);
+    }
+
+    free((*console)->out);
+    free((*console)->in);
+    free(*console);
+    *console = NULL;
+}
+
+/*  Function: console_flush
+    Purpose: writes the buffered output, or hands it to the writer thread.
+    Output kept for console_drain stays where it is, and the buffer only
+    grows if it is full.
+    Parameters: the console
+    Returns: N/A
+    Expectation: the console must not be NULL
+*/
+void console_flush(Console_T console)
+{
+    assert(console != NULL);
+
+    if (console->out_fd == CONSOLE_MEMORY) {
+        if (console->out_len == console->out_cap) {
+            console->out_cap *= 2;
+            console->out = realloc(console->out, console->out_cap);
+            assert(console->out != NULL);
+        }
+        return;
+    }
+    if (console->out_len == 0) {
+        return;
+    }
+    session_output(console->out, console->out_len);
+    if (console->ring != NULL) {
+        ring_push(console->ring, console->out, console->out_len);
+    }
+    else {
+        write_all(console->out_fd, console->out, console->out_len);
+    }
+    console->out_len = 0;
+}
+
+/*  Function: console_fill
+    Purpose: slow path of console_get. Writes pending output so a prompt
+    is visible before waiting, then reads the next block of input.
+    Parameters: the console
+    Returns: the first byte read, or CONSOLE_EOF once the input has ended
+    Expectation: the console must not be NULL
+*/
+uint32_t console_fill(Console_T console)
+{
+    assert(console != NULL);
+
+    console_flush(console);
+
+    /* an engine stops at an IN rather than wait for a host's input, so
+       this is only reached once the host has ended it */
+    if (console->in_fd == CONSOLE_MEMORY) {
+        assert(console->eof);
+        return CONSOLE_EOF;
+    }
+
+    while (!console->eof) {
+        ssize_t got = read(console->in_fd, console->in, console->in_cap);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            console->eof = 1;
+            break;
+        }
+        console->in_len = got;
+        console->in_pos = 1;
+        return console->in[0];
+    }
+
+    return CONSOLE_EOF;
+}
+
+/*  Function: console_feed
+    Purpose: adds input from a host program after any not yet handed out
+    Parameters: the console, the bytes, how many there are
+    Returns: N/A
+    Expectation: the console reads from CONSOLE_MEMORY and its input has
+    not been ended
+*/
+void console_feed(Console_T console, const void *bytes, size_t count)
+{
+    assert(console != NULL && console->in_fd == CONSOLE_MEMORY);
+    assert(!console->eof);
+    assert(bytes != NULL || count == 0);
+
+    /* move the bytes still to be handed out to the front, then make room
+       for the new ones */
+    size_t unread = console->in_len - console->in_pos;
+    memmove(console->in, console->in + console->in_pos, unread);
+    console->in_pos = 0;
+    console->in_len = unread;
+
+    if (unread + count > console->in_cap) {
+        while (unread + count > console->in_cap) {
+            console->in_cap *= 2;
+        }
+        console->in = realloc(console->in, console->in_cap);
+        assert(console->in != NULL);
+    }
+    memcpy(console->in + unread, bytes, count);
+    console->in_len += count;
+}
+
+/*  Function: console_end_input
+    Purpose: ends a host program's input. IN instructions get the bytes
+    already fed and then CONSOLE_EOF.
+    Parameters: the console
+    Returns: N/A
+    Expectation: the console reads from CONSOLE_MEMORY
+*/
+void console_end_input(Console_T console)
+{
+    assert(console != NULL && console->in_fd == CONSOLE_MEMORY);
+
+    console->eof = 1;
+}
+
+/*  Function: console_drain
+    Purpose: hands output to a host program, oldest bytes first
+    Parameters: the console, where to copy the bytes, and room for how many
+    Returns: the number of bytes copied, 0 once there are none left
+    Expectation: the console writes to CONSOLE_MEMORY
+*/
+size_t console_drain(Console_T console, void *buffer, size_t size)
+{
+    assert(console != NULL && console->out_fd == CONSOLE_MEMORY);
+    assert(buffer != NULL || size == 0);
+
+    size_t count = console->out_len < size ? console->out_len : size;
+    memcpy(buffer, console->out, count);
+    memmove(console->out, console->out + count, console->out_len - count);
+    console->out_len -= count;
+
+    return count;
+}
+
+/*  Function: console_pending
+    Purpose: lets a host program write output straight from the console's
+    buffer instead of copying it out with console_drain
+    Parameters: the console, where to put how many bytes there are
+    Returns: the oldest byte not yet taken, valid until the machine runs
+    again or console_consume is called
+    Expectation: the console writes to CONSOLE_MEMORY
+*/
+const unsigned char *console_pending(Console_T console, size_t *count)
+{
+    assert(console != NULL && console->out_fd == CONSOLE_MEMORY);
+    assert(count != NULL);
+
+    *count = console->out_len;
+    return console->out;
+}
+
+/*  Function: console_consume
+    Purpose: drops output a host program has written from console_pending
+    Parameters: the console, how many of the oldest bytes to drop
+    Returns: N/A
+    Expectation: the console writes to CONSOLE_MEMORY and holds at least
+    count bytes
+*/
+void console_consume(Console_T console, size_t count)
+{
+    assert(console != NULL && console->out_fd == CONSOLE_MEMORY);
+    assert(count <= console->out_len);
+
+    memmove(console->out, console->out + count, console->out_len - count);
+    console->out_len -= count;
+}
@@ -0,0 +1,122 @@
+/**************************************************************
+ *                       console.h
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Interface for our console I/O
+ *
+ *     Purpose: Buffers the bytes of the OUT and IN instructions
+ * 				so that they do not cost a locked stdio call
+ * 				each. Output is written when the buffer fills,
+ * 				when an IN has to wait for input and when the
+ * 				console is freed at halt. Input is read from
+ * 				the descriptor in large blocks. Output can also
+ * 				be handed to a writer thread through a lock-free
+ * 				ring, so a slow reader downstream of the pipe
+ * 				does not stall the machine. A console made with
+ * 				CONSOLE_MEMORY is instead fed and drained by a
+ * 				host program embedding the machine.
+ *
+ *     Success Output:
+ *              Every byte is written in order, exactly once
+ *
+ *     Failure output:
+ *              A Hanson checked runtime exception is raised if
+ *              the buffers or the writer thread cannot be set up
+ *
+ **************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+/* value an IN instruction gets once the input has ended */
+#define CONSOLE_EOF (~(uint32_t) 0)
+
+/* descriptor of a console whose input is fed and output drained by a
+   host program through console_feed and console_drain */
+#define CONSOLE_MEMORY (-1)
+
+typedef struct Console_T *Console_T;
+
+/* this struct holds ten variables
+    1. The output buffer, how much of it is used, and its size
+    2. The input buffer, the next byte to hand out, how many it holds and
+       its size
+    3. The descriptors input is read from and output is written to, either
+       of which may be CONSOLE_MEMORY
+    4. Whether the input has ended
+    5. The ring shared with the writer thread, or NULL if output is written
+       directly
+
+   It is defined here so that console_put and console_get can be inlined
+   into the engines.
+*/
+struct Console_T {
+    unsigned char *out;
+    size_t out_len;
+    size_t out_cap;
+    unsigned char *in;
+    size_t in_pos;
+    size_t in_len;
+    size_t in_cap;
+    int in_fd;
+    int out_fd;
+    int eof;
+    struct Ring *ring;
+};
+
+Console_T console_new(int in_fd, int out_fd, int async);
+void console_free(Console_T *console);
+void console_flush(Console_T console);
+uint32_t console_fill(Console_T console);
+void console_feed(Console_T console, const void *bytes, size_t count);
+void console_end_input(Console_T console);
+size_t console_drain(Console_T console, void *buffer, size_t size);
+const unsigned char *console_pending(Console_T console, size_t *count);
+void console_consume(Console_T console, size_t count);
+
+/*  Function: console_put
+    Purpose: buffers one byte of output
+    Parameters: the console, the byte
+    Returns: N/A
+*/
+static inline void console_put(Console_T console, unsigned char byte)
+{
+    if (console->out_len == console->out_cap) {
+        console_flush(console);
+    }
+    console->out[console->out_len++] = byte;
+}
+
+/*  Function: console_get
+    Purpose: hands out the next byte of input, reading more from the
+    descriptor (after writing any pending output) if the buffer is empty
+    Parameters: the console
+    Returns: the byte, or CONSOLE_EOF once the input has ended
+*/
+static inline uint32_t console_get(Console_T console)
+{
+    if (console->in_pos < console->in_len) {
+        return console->in[console->in_pos++];
+    }
+    return console_fill(console);
+}
+
+/*  Function: console_waiting
+    Purpose: says whether the next console_get has to wait for the
+    descriptor, because every byte read so far has been handed out
+    Parameters: the console
+    Returns: 1 if it has to wait, otherwise 0
+*/
+static inline int console_waiting(Console_T console)
+{
+    return console->in_pos == console->in_len && !console->eof;
+}
+
+#endif
+/* CONSOLE_H */
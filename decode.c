@@ -0,0 +1,374 @@
+/**************************************************************
+ *                       decode.c
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Implementation for our decode.h
+ *
+ *     Purpose: Splits every word of segment 0 into its opcode,
+ * 				register indices and load value once, when the
+ * 				program is loaded, so the engine does not decode
+ * 				the same words millions of times. Stores into
+ * 				segment 0 re-decode only the word they change.
+ *
+ *     Success Output:
+ *              Every record matches the word it was decoded
+ * 				from, and one END record follows the last word
+ *
+ *     Failure output:
+ *              A Hanson checked runtime exception is raised if
+ *              memory for the cache cannot be allocated
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "decode.h"
+
+/* the longest sequence that is fused */
+#define MAX_FUSED 3
+
+/* this struct holds four variables
+    1. The decoded records, one per word plus the END record
+    2. The number of words currently decoded
+    3. The number of records the array has room for
+    4. Whether frequent sequences are fused
+*/
+struct Decoded {
+    Instr *instrs;
+    uint32_t length;
+    uint32_t capacity;
+    int fuse;
+};
+
+/* the fused opcode of every pair of opcodes that is fused, or 0 (which no
+   fused opcode is) */
+static const uint8_t fused_pair[OP_END + 1][OP_END + 1] = {
+    [OP_LV][OP_SLOAD]    = OP_LV_SLOAD,
+    [OP_LV][OP_SSTORE]   = OP_LV_SSTORE,
+    [OP_LV][OP_ADD]      = OP_LV_ADD,
+    [OP_LV][OP_NAND]     = OP_LV_NAND,
+    [OP_LV][OP_LV]       = OP_LV_LV,
+    [OP_LV][OP_LOADP]    = OP_LV_LOADP,
+    [OP_SLOAD][OP_LV]    = OP_SLOAD_LV,
+    [OP_SSTORE][OP_LV]   = OP_SSTORE_LV,
+    [OP_ADD][OP_LV]      = OP_ADD_LV,
+    [OP_NAND][OP_NAND]   = OP_NAND_NAND,
+    [OP_NAND][OP_ADD]    = OP_NAND_ADD,
+};
+
+/* triples are a fused pair followed by one more opcode */
+static const struct {
+    uint8_t pair;
+    uint8_t third;
+    uint8_t fused;
+} fused_triples[] = {
+    { OP_LV_LV, OP_LOADP, OP_LV_LV_LOADP },
+};
+
+static const int NUM_TRIPLES = sizeof(fused_triples) /
+                               sizeof(fused_triples[0]);
+
+/* the opcode of the first instruction of every fused sequence */
+static const uint8_t first_op[NUM_DECODED_OPS] = {
+    [OP_LV_SLOAD]    = OP_LV,
+    [OP_LV_SSTORE]   = OP_LV,
+    [OP_LV_ADD]      = OP_LV,
+    [OP_LV_NAND]     = OP_LV,
+    [OP_LV_LV]       = OP_LV,
+    [OP_LV_LOADP]    = OP_LV,
+    [OP_SLOAD_LV]    = OP_SLOAD,
+    [OP_SSTORE_LV]   = OP_SSTORE,
+    [OP_ADD_LV]      = OP_ADD,
+    [OP_NAND_NAND]   = OP_NAND,
+    [OP_NAND_ADD]    = OP_NAND,
+    [OP_LV_LV_LOADP] = OP_LV,
+};
+
+/* the name of every opcode, for the profiler and the disassembler */
+static const char *const names[] = {
+    "cmov", "sload", "sstore", "add", "mul", "div", "nand", "halt",
+    "map", "unmap", "out", "in", "loadp", "lv", "invalid", "end"
+};
+
+/*  Function: decode_op_name
+    Purpose: names an opcode
+    Parameters: an opcode of enum um_op
+    Returns: its name, such as "nand"
+*/
+const char *decode_op_name(unsigned op)
+{
+    return op <= OP_END ? names[op] : "?";
+}
+
+/*  Function: decode_base
+    Purpose: finds the opcode of the instruction a record was decoded from
+    Parameters: an opcode of enum um_op or enum fused_op
+    Returns: the um_op, which is op itself unless op is fused
+*/
+unsigned decode_base(unsigned op)
+{
+    assert(op < NUM_DECODED_OPS);
+    return op <= OP_END ? op : first_op[op];
+}
+
+/*  Function: match
+    Purpose: finds the fused opcode for the start of a sequence
+    Parameters: the opcodes of up to three instructions in a row, and how
+    many of them there are
+    Returns: the fused opcode of the longest fused sequence they start
+    with, or ops[0] if none
+*/
+static unsigned match(const unsigned *ops, int length)
+{
+    if (length < 2 || fused_pair[ops[0]][ops[1]] == 0) {
+        return ops[0];
+    }
+
+    unsigned pair = fused_pair[ops[0]][ops[1]];
+    for (int i = 0; length > 2 && i < NUM_TRIPLES; i++) {
+        if (fused_triples[i].pair == pair && fused_triples[i].third == ops[2]) {
+            return fused_triples[i].fused;
+        }
+    }
+    return pair;
+}
+
+/*  Function: decode_fusable
+    Purpose: says whether a sequence of opcodes is one decode_program fuses
+    Parameters: the opcodes and how many there are
+    Returns: 1 if fused, otherwise 0
+*/
+int decode_fusable(const unsigned *ops, int length)
+{
+    if (length < 2 || length > MAX_FUSED) {
+        return 0;
+    }
+    unsigned fused = match(ops, length);
+    if (length == 2) {
+        return fused != ops[0];
+    }
+    return fused > OP_END && fused != fused_pair[ops[0]][ops[1]];
+}
+
+/*  Function: fuse
+    Purpose: gives record i the fused opcode of the longest sequence that
+    starts there, or its own opcode if none does
+    Parameters: the cache, the index of the record
+    Returns: N/A
+*/
+static void fuse(Decoded cache, uint32_t i)
+{
+    Instr *instrs = cache->instrs;
+    unsigned ops[MAX_FUSED];
+    int available = 0;
+
+    while (available < MAX_FUSED && i + available < cache->length) {
+        ops[available] = decode_base(instrs[i + available].op);
+        available++;
+    }
+    instrs[i].op = match(ops, available);
+}
+
+/*  Function: decode_word
+    Purpose: Splits one instruction word into a decoded record
+    Parameters: the record to fill in, the instruction word
+    Returns: N/A
+*/
+static void decode_word(Instr *ins, uint32_t word)
+{
+    ins->op = word >> 28;
+    ins->value = 0;
+
+    if (ins->op == OP_LV) {
+        ins->a = (word >> 25) & 0x7;
+        ins->b = 0;
+        ins->c = 0;
+        ins->value = word & 0x1ffffff;
+        return;
+    }
+    if (ins->op > OP_LV) {
+        ins->op = OP_INVALID;
+    }
+    ins->a = (word >> 6) & 0x7;
+    ins->b = (word >> 3) & 0x7;
+    ins->c = word & 0x7;
+}
+
+/*  Function: decode_text
+    Purpose: writes one instruction word as assembly, followed by what it
+    does, for the disassembler
+    Parameters: the word, where to write the text and its size
+    Returns: N/A
+*/
+void decode_text(uint32_t word, char *text, size_t size)
+{
+    Instr ins;
+    decode_word(&ins, word);
+    unsigned a = ins.a, b = ins.b, c = ins.c;
+    const char *name = decode_op_name(ins.op);
+
+    switch (ins.op) {
+    case OP_CMOV:
+        snprintf(text, size, "%-6s r%u, r%u, r%u   ; if (r%u) r%u = r%u",
+                 name, a, b, c, c, a, b);
+        break;
+    case OP_SLOAD:
+        snprintf(text, size, "%-6s r%u, r%u, r%u   ; r%u = m[r%u][r%u]",
+                 name, a, b, c, a, b, c);
+        break;
+    case OP_SSTORE:
+        snprintf(text, size, "%-6s r%u, r%u, r%u   ; m[r%u][r%u] = r%u",
+                 name, a, b, c, a, b, c);
+        break;
+    case OP_ADD:
+    case OP_MUL:
+    case OP_DIV:
+        snprintf(text, size, "%-6s r%u, r%u, r%u   ; r%u = r%u %c r%u",
+                 name, a, b, c, a, b,
+                 ins.op == OP_ADD ? '+' : ins.op == OP_MUL ? '*' : '/', c);
+        break;
+    case OP_NAND:
+        snprintf(text, size, "%-6s r%u, r%u, r%u   ; r%u = ~(r%u & r%u)",
+                 name, a, b, c, a, b, c);
+        break;
+    case OP_HALT:
+        snprintf(text, size, "%s", name);
+        break;
+    case OP_MAP:
+        snprintf(text, size, "%-6s r%u, r%u       ; r%u = map(r%u words)",
+                 name, b, c, b, c);
+        break;
+    case OP_UNMAP:
+    case OP_OUT:
+        snprintf(text, size, "%-6s r%u", name, c);
+        break;
+    case OP_IN:
+        snprintf(text, size, "%-6s r%u           ; r%u = input", name, c, c);
+        break;
+    case OP_LOADP:
+        snprintf(text, size, "%-6s r%u, r%u       ; load m[r%u], goto r%u",
+                 name, b, c, b, c);
+        break;
+    case OP_LV:
+        if (ins.value >= ' ' && ins.value < 127) {
+            snprintf(text, size, "%-6s r%u, %-9u ; '%c'", name, a,
+                     ins.value, (int) ins.value);
+        }
+        else {
+            snprintf(text, size, "%-6s r%u, %u", name, a, ins.value);
+        }
+        break;
+    default:
+        snprintf(text, size, ".word  0x%08x", word);
+    }
+}
+
+/*  Function: decode_new
+    Purpose: creates an empty cache
+    Parameters: whether frequent sequences are to be fused
+    Returns: an allocated Decoded cache
+    Expectation: none
+*/
+Decoded decode_new(int fuse)
+{
+    Decoded cache = malloc(sizeof(struct Decoded));
+    assert(cache != NULL);
+
+    cache->instrs = NULL;
+    cache->length = 0;
+    cache->capacity = 0;
+    cache->fuse = fuse;
+
+    return cache;
+}
+
+/*  Function: decode_free
+    Purpose: frees the cache and its records, and sets the pointer to NULL
+    Parameters: a pointer to the cache to be freed
+    Returns: N/A
+    Expectation: the cache must not be NULL
+*/
+void decode_free(Decoded *cache)
+{
+    assert(cache != NULL && *cache != NULL);
+
+    free((*cache)->instrs);
+    free(*cache);
+    *cache = NULL;
+}
+
+/*  Function: decode_program
+    Purpose: decodes a whole segment 0, reusing the record array when it is
+    large enough. Called once per program load.
+    Parameters: the cache, the words of segment 0 and their count
+    Returns: the decoded records; record [length] is always OP_END
+    Expectation: code must not be NULL unless length is 0
+*/
+Instr *decode_program(Decoded cache, const uint32_t *code, uint32_t length)
+{
+    assert(cache != NULL);
+    assert(code != NULL || length == 0);
+
+    if (cache->capacity < (uint64_t) length + 1) {
+        free(cache->instrs);
+        cache->capacity = length + 1;
+        cache->instrs = malloc(cache->capacity * sizeof(Instr));
+        assert(cache->instrs != NULL);
+    }
+
+    for (uint32_t i = 0; i < length; i++) {
+        decode_word(&cache->instrs[i], code[i]);
+    }
+    cache->length = length;
+
+    /* running off the end of the program lands on this record */
+    Instr *end = &cache->instrs[length];
+    end->op = OP_END;
+    end->a = end->b = end->c = 0;
+    end->value = 0;
+
+    if (cache->fuse) {
+        for (uint32_t i = 0; i < length; i++) {
+            fuse(cache, i);
+        }
+    }
+
+    return cache->instrs;
+}
+
+/*  Function: decode_store
+    Purpose: re-decodes the one record a store into segment 0 changed, and
+    fuses again the records whose sequences may include it
+    Parameters: the cache, the index stored to, the word that was stored
+    Returns: N/A
+    Expectation: index is within the decoded program
+*/
+void decode_store(Decoded cache, uint32_t index, uint32_t word)
+{
+    assert(cache != NULL);
+    assert(index < cache->length);
+
+    Instr *ins = &cache->instrs[index];
+    unsigned old = ins->op;
+    decode_word(ins, word);
+
+    if (!cache->fuse) {
+        return;
+    }
+
+    /* fusion depends only on opcodes: if this one did not change, neither
+       did any fusion, and the record keeps the one it had */
+    if (decode_base(old) == ins->op) {
+        ins->op = old;
+        return;
+    }
+
+    uint32_t first = index >= MAX_FUSED - 1 ? index - (MAX_FUSED - 1) : 0;
+    for (uint32_t i = first; i <= index; i++) {
+        fuse(cache, i);
+    }
+}
@@ -0,0 +1,72 @@
+/**************************************************************
+ *                       decode.h
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Interface for our pre-decoded segment 0 cache
+ *
+ *     Purpose: Splits every word of segment 0 into its opcode,
+ * 				register indices and load value once, when the
+ * 				program is loaded, so the engine does not decode
+ * 				the same words millions of times. Frequent
+ * 				sequences of instructions are fused so they
+ * 				cost a single dispatch. Stores into segment 0
+ * 				re-decode only the word they change and the
+ * 				fusions that include it.
+ *
+ *     Success Output:
+ *              Every record matches the word it was decoded
+ * 				from, and one END record follows the last word
+ *
+ *     Failure output:
+ *              A Hanson checked runtime exception is raised if
+ *              memory for the cache cannot be allocated
+ *
+ **************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef DECODE_H
+#define DECODE_H
+
+/* opcodes as stored in a decoded record. Opcodes 14 and 15 are not part
+   of the UM and decode to OP_INVALID; OP_END marks the record that
+   follows the last word of segment 0 */
+enum um_op { OP_CMOV = 0, OP_SLOAD, OP_SSTORE, OP_ADD, OP_MUL, OP_DIV,
+    OP_NAND, OP_HALT, OP_MAP, OP_UNMAP, OP_OUT, OP_IN, OP_LOADP, OP_LV,
+    OP_INVALID, OP_END };
+
+/* fused opcodes. decode_program gives the first record of a frequent
+   sequence one of these; the records after it keep their own opcodes, so
+   a jump into the middle of the sequence still runs correctly. The set
+   was picked with ./um -f on midmark.um, sandmark.umz and codex.umz */
+enum fused_op { OP_LV_SLOAD = OP_END + 1, OP_LV_SSTORE, OP_LV_ADD,
+    OP_LV_NAND, OP_LV_LV, OP_LV_LOADP, OP_SLOAD_LV, OP_SSTORE_LV,
+    OP_ADD_LV, OP_NAND_NAND, OP_NAND_ADD, OP_LV_LV_LOADP, NUM_DECODED_OPS };
+
+/* one decoded instruction. For LV, a is the target register and value is
+   the 25 bit immediate; for every other opcode value is unused */
+typedef struct Instr {
+    uint8_t op;
+    uint8_t a;
+    uint8_t b;
+    uint8_t c;
+    uint32_t value;
+} Instr;
+
+typedef struct Decoded *Decoded;
+
+Decoded decode_new(int fuse);
+void decode_free(Decoded *cache);
+Instr *decode_program(Decoded cache, const uint32_t *code, uint32_t length);
+void decode_store(Decoded cache, uint32_t index, uint32_t word);
+const char *decode_op_name(unsigned op);
+void decode_text(uint32_t word, char *text, size_t size);
+unsigned decode_base(unsigned op);
+int decode_fusable(const unsigned *ops, int length);
+
+#endif
+/* DECODE_H */
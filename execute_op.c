@@ -26,6 +26,10 @@
 #include <stdint.h>
 #include "execute_op.h"
 #include "seg_mem.h"
+#include "snapshot.h"
+#include "session.h"
+#include "sample.h"
+#include "threaded.h"
 
 /* constant values for the register number and opcode instructions */
 enum registerNum { REGA = 0, REGB, REGC };
@@ -36,52 +40,131 @@ enum opcode { CMOV = 0, SLOAD, STORE, ADD, MUL, DIV,
 static const int CHAR_MAX = 255;
 static const int CHAR_MIN = 0;
 
-/* this struct holds four variables
+/* this struct holds eight variables
     1. An uint32_t array of the eight registers
     2. An uint32_t array of the register numbers a, b, and c
-    3. A struct MemSeg_T holding an implementation of the memory
-    4. The segment 0 with instructions of the file
-    5. A program counter that loops through instructions
+    3. A struct MemSeg_T holding an implementation of the memory, including
+       segment 0 with the instructions of the file
+    4. A program counter that loops through instructions
+    5. The console that input and output go through
+    6. The number of instructions started so far
+    7. The opcode of the instruction being run
+    8. How many times another segment has been loaded as segment 0
 */
 struct Um {
     uint32_t regs[8];
     uint32_t regNum[3];
     MemSeg_T memory_total;
-    UArray_T seg_0;
     int prog_ctr;
+    Console_T console;
+    uint64_t executed;
+    uint32_t op;
+    uint32_t generation;
 };
 
+/* the machine the sampling profiler looks at, NULL if it is off */
+static Um sampled = NULL;
+
+/*  Function: where
+    Purpose: tells the sampling profiler where the machine is. It runs in
+    a signal handler, between any two statements of the engine
+    Parameters: where to put the pc, opcode and segment 0 generation
+    Returns: 1, or 0 if no machine is being sampled
+*/
+static int where(struct Sample_point *point)
+{
+    const volatile struct Um *vals = sampled;
+    if (vals == NULL) {
+        return 0;
+    }
+    point->pc = vals->prog_ctr;
+    point->op = vals->op;
+    point->generation = vals->generation;
+    return 1;
+}
+
 /*  Function: execute
     Purpose: Executes all the opcodes in the program
-    Parameters: UArray_T of seg_0 (the program itself)
-    Returns:  Integer indicating succesful completion
+    Parameters: the memory, with the program loaded as segment 0, and the
+    console for input and output
+    Returns: 0 if the program halted, 1 if it ran off the end of segment 0,
+    RUN_LIMIT if it went over a memory limit
 */
-int execute(UArray_T seg_0)
+int execute(MemSeg_T memory_total, Console_T console)
+{
+    Um values = um_new(memory_total, console);
+
+    /* a machine restored from a snapshot starts where it was saved */
+    uint32_t start = 0;
+    snapshot_start(values->regs, &start);
+    values->prog_ctr = start;
+
+    if (sample_enabled()) {
+        sampled = values;
+        sample_start(where);
+    }
+
+    int result = um_run(values, RUN_UNLIMITED);
+    freeMem(values);
+    return result;
+}
+
+/*  Function: um_new
+    Purpose: sets up the machine for a program, before its first
+    instruction, so that it can be run a few instructions at a time
+    Parameters: the memory, with the program loaded as segment 0, and the
+    console for input and output
+    Returns: the machine, which freeMem frees along with the memory
+*/
+Um um_new(MemSeg_T memory_total, Console_T console)
 {
     /* allocate space for the struct for runtime */
     Um values = malloc(sizeof(struct Um));
     assert(values != NULL);
 
     /* set initial values of the struct */
-    values->seg_0 = seg_0;
-    values->memory_total = seg_new();
-    values->memory_total = seg_initial(values->memory_total, values->seg_0);
+    values->memory_total = memory_total;
+    values->console = console;
+    values->executed = 0;
+    values->op = 0;
+    values->generation = 0;
     for(int i = 0; i < 8; i++) {
         values->regs[i] = 0;
     }
     for(int i = 0; i < 3; i++) {
         values->regNum[i] = 0;
     }
+    values->prog_ctr = 0;
+
+    return values;
+}
 
+/*  Function: um_run
+    Purpose: Executes the opcodes of the program from where the last call
+    stopped
+    Parameters: the machine, how many instructions it may run
+    Returns: RUN_HALTED or RUN_FELL_OFF when the program stops, RUN_LIMIT
+    when a map or loadprogram would take it over a memory limit, RUN_BUDGET
+    once it has run budget instructions. A halted machine is left at its
+    HALT, and one over a limit at the instruction that went over.
+*/
+int um_run(Um values, uint64_t budget)
+{
     /* traverse through segment 0 and execute each instruction based on the
     opcode */
-    for (values->prog_ctr = 0; values->prog_ctr < UArray_length(values->seg_0);
-                                        values->prog_ctr++) {
+    for (uint64_t n = 0; n < budget; n++, values->prog_ctr++) {
+        if ((uint32_t) values->prog_ctr >=
+            seg_length(values->memory_total, 0)) {
+            return RUN_FELL_OFF;
+        }
+
         /* get instruction */
-        uint32_t instruction = * (uint32_t *) UArray_at(values->seg_0,
-                                                        values->prog_ctr);
+        uint32_t instruction = segment_load(values->memory_total, 0,
+                                            values->prog_ctr);
         /* get opcode from instruction */
         uint32_t op = Bitpack_getu(instruction, 4, 28);
+        values->op = op;
+        values->executed++;
 
         /* execute instruction based on opcode */
         if(op == CMOV) {
@@ -114,11 +197,13 @@ int execute(UArray_T seg_0)
         }
         else if (op == HALT) {
             halt(values);
-            return 0;
+            return RUN_HALTED;
         }
         else if (op == SEGMAP) {
             add_registers(values, instruction);
-            seg_map(values);
+            if (!seg_map(values)) {
+                return RUN_LIMIT;
+            }
         }
         else if (op == UNMAP) {
             add_registers(values, instruction);
@@ -134,7 +219,9 @@ int execute(UArray_T seg_0)
         }
         else if (op == LOADP) {
             add_registers(values, instruction);
-            loadprogram(values);
+            if (!loadprogram(values)) {
+                return RUN_LIMIT;
+            }
         }
         else if (op == LV) {
             loadvalue(values, instruction);
@@ -143,8 +230,22 @@ int execute(UArray_T seg_0)
             assert(0);
         }
     }
-    freeMem(values);
-    return 1;
+    return RUN_BUDGET;
+}
+
+/*  Function: um_state
+    Purpose: gives the registers and program counter of the machine
+    Parameters: the machine, where to put the eight registers and the pc
+    Returns: N/A
+*/
+void um_state(Um vals, uint32_t *regs, uint32_t *pc)
+{
+    assert(vals != NULL && regs != NULL && pc != NULL);
+
+    for (int i = 0; i < 8; i++) {
+        regs[i] = vals->regs[i];
+    }
+    *pc = vals->prog_ctr;
 }
 
 /*  Function: add_registers
@@ -168,6 +269,12 @@ void freeMem(Um vals)
     /* check for valid input */
     assert(vals != NULL);
 
+    /* the sampling profiler must not look at the machine once it is gone */
+    if (vals == sampled) {
+        sample_stop();
+        sampled = NULL;
+    }
+
     /* free memory_total and the struct */
     if(vals->memory_total != NULL) {
         seg_free(vals->memory_total);
@@ -287,19 +394,18 @@ void nand(Um vals)
 }
 
 /*  Function: halt
-    Purpose: Halts the program and frees memory
-    Parameters: UArray of seg_0 and struct of registers
+    Purpose: Halts the program. Its memory is freed by whoever runs it
+    Parameters: struct of registers
     Returns:  N/A
 */
 void halt(Um vals)
 {
     /* check for valid input */
     assert(vals != NULL);
-    freeMem(vals);
 }
 
 /*  Function: output
-    Purpose: To output an ASCII character to stdout.
+    Purpose: To output an ASCII character to the console.
     Parameters: struct of registers
     Returns:  N/A
     Expectatoins: A value from 0 to 255
@@ -314,11 +420,11 @@ void output(Um vals)
     int rc = vals->regs[vals->regNum[REGC]];
     assert(rc <= CHAR_MAX);
     assert(rc >= CHAR_MIN);
-    putchar(rc);
+    console_put(vals->console, rc);
 }
 
 /*  Function: input
-    Purpose: Receives a character from standard input.
+    Purpose: Receives a character from the console.
     Parameters: struct of registers
     Returns:  N/A
     Expectatoins: A value from 0 to 255
@@ -328,34 +434,41 @@ void input(Um vals)
     /* check for valid input */
     assert(vals != NULL);
 
-    /* get character and check with range, store it in REGC */
-    int rc = getchar();
-    assert(rc <= CHAR_MAX);
-    assert(rc >= CHAR_MIN || rc == EOF);
-
-    /* if character is EOF store it as the EOF value */
-    if(rc != EOF) {
-        vals->regs[vals->regNum[REGC]] = rc;
-    }
-    else {
-        vals->regs[vals->regNum[REGC]] = ~0;
+    /* the machine is about to wait for input: a snapshot taken now
+    resumes at this instruction */
+    if (console_waiting(vals->console)) {
+        snapshot_wait(vals->memory_total, vals->regs, vals->prog_ctr);
     }
+
+    /* get character and store it in REGC, the console gives the EOF
+    value ~0 once the input has ended */
+    uint32_t rc = session_active()
+                ? session_in(vals->console, vals->executed - 1)
+                : console_get(vals->console);
+    assert(rc <= (uint32_t) CHAR_MAX || rc == CONSOLE_EOF);
+    vals->regs[vals->regNum[REGC]] = rc;
 }
 
 /*  Function: seg_map
     Purpose: Loads the index of the newly mapped memory segment into
              register B.
     Parameters: struct of registers
-    Returns:  N/A
+    Returns:  1, or 0 if the segment would go over a memory limit, in which
+             case register B is unchanged
 */
-void seg_map(Um vals)
+int seg_map(Um vals)
 {
     /* check for valid input */
     assert(vals != NULL);
 
     /* map segment and store it onto register at register num B */
-    vals->regs[vals->regNum[REGB]] = map_segment(vals->memory_total,
-                                          vals->regs[vals->regNum[REGC]]);
+    uint32_t id = map_segment(vals->memory_total,
+                              vals->regs[vals->regNum[REGC]]);
+    if (id == 0) {
+        return 0;
+    }
+    vals->regs[vals->regNum[REGB]] = id;
+    return 1;
 }
 
 /*  Function: unmap_segment
@@ -377,30 +490,29 @@ void seg_unmap(Um vals)
     Purpose: Replaces the program being run with memory location ID from
     register B
     Parameters: A struct of registers, and the main program being run
-    Returns: N/A
+    Returns: 1, or 0 if the new program would go over a memory limit, in
+    which case nothing changes
     Expectation: the struct must not be NULL
 */
-void loadprogram(Um vals)
+int loadprogram(Um vals)
 {
     /* check for valid input */
     assert(vals != NULL);
 
+    /* segment 0 shares the source segment until either is written to */
     if (vals->regs[vals->regNum[REGB]] != 0) {
-
-        UArray_T segment = get_segment(vals->memory_total,
-                                vals->regs[vals->regNum[REGB]]);
-        UArray_T new_segment = UArray_new(UArray_length(segment),
-        sizeof(uint32_t));
-        for (int i = 0; i < UArray_length(segment); i++) {
-            uint32_t *ptr = UArray_at(new_segment, i);
-            *ptr = *(uint32_t *)UArray_at(segment, i);
+        uint32_t length;
+        if (seg_loadprogram(vals->memory_total,
+                            vals->regs[vals->regNum[REGB]],
+                            &length) == NULL) {
+            return 0;
         }
-        set_seg_0(vals->memory_total, new_segment);
-        vals->seg_0 = new_segment;
+        vals->generation++;
     }
 
     /* set program counter to register c value */
     vals->prog_ctr = vals->regs[vals->regNum[REGC]] - 1;
+    return 1;
 }
 
 /*  Function: load_value
@@ -28,16 +28,18 @@
 #include <assert.h>
 #include <bitpack.h>
 #include <stdint.h>
-#include "readfile.h"
-#include "seq.h"
-#include "uarray.h"
+#include "seg_mem.h"
+#include "console.h"
 
 #ifndef EXECUTE_OP_H
 #define EXECUTE_OP_H
 
 typedef struct Um *Um;
 
-int execute(UArray_T seg_0);
+int execute(MemSeg_T memory_total, Console_T console);
+Um um_new(MemSeg_T memory_total, Console_T console);
+int um_run(Um vals, uint64_t budget);
+void um_state(Um vals, uint32_t *regs, uint32_t *pc);
 
 void add_registers(Um vals, uint32_t instruction);
 void freeMem(Um vals);
@@ -53,9 +55,9 @@ void nand(Um vals);
 void halt(Um vals);
 void output(Um vals);
 void input(Um vals);
-void seg_map(Um vals);
+int seg_map(Um vals);
 void seg_unmap(Um vals);
-void loadprogram(Um vals);
+int loadprogram(Um vals);
 
 #endif
 /* EXECUTE_OP_H */
\ No newline at end of file
@@ -0,0 +1,375 @@
+/**************************************************************
+ *                        explore.c
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Implementation for our explore.h
+ *
+ *     Purpose: The warm-up runs a threaded engine on a memory
+ * 				console with no input, so it stops at the first
+ * 				IN, or with the instruction count as its budget.
+ * 				Every worker is a fork of that process: it feeds
+ * 				its input file to the console, ends the input and
+ * 				runs to the end, writing its output as it goes,
+ * 				output from the warm-up first. Workers record how
+ * 				their machine stopped in a page shared with the
+ * 				parent, which reaps them with wait4 for their
+ * 				times, peak RSS and page faults.
+ *
+ *     Success Output:
+ *              name.out for every input file name, holding the
+ *              whole output of the program given that input. A
+ *              line per worker and a summary are printed to
+ *              stderr.
+ *
+ *     Failure output:
+ *              An error message is printed and the program exits
+ *              if the list of inputs cannot be read or no worker
+ *              can be started. A worker that cannot read its
+ *              input or write its output, or whose machine
+ *              fails, is reported and the others carry on.
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "explore.h"
+#include "threaded.h"
+#include "console.h"
+
+/* instructions a worker runs between writes of its output */
+#define SLICE (1u << 24)
+
+/* bytes of an input file read at a time */
+#define READ_SIZE 65536
+
+/* this struct holds two variables, written by a worker into memory it
+   shares with the parent
+    1. The instructions it ran after the marker
+    2. How its machine stopped, a run_status, or -1 if it never finished
+*/
+struct Outcome {
+    uint64_t executed;
+    int status;
+};
+
+/* this struct holds three variables
+    1. The name of the input file
+    2. The worker's process, 0 before it starts and after it is reaped
+    3. When it started, in seconds
+*/
+struct Worker {
+    char *path;
+    pid_t pid;
+    double started;
+};
+
+/* this struct holds eight variables
+    1. The workers, and how many there are
+    2. Their outcomes, in the shared page
+    3. How many are running, and the most that may run at once
+    4. How many halted, ran off the end, or failed
+*/
+static struct {
+    struct Worker *workers;
+    size_t num_workers;
+    struct Outcome *outcomes;
+    long running;
+    long cores;
+    size_t halted;
+    size_t fell_off;
+    size_t failed;
+} explore;
+
+/*  Function: fail
+    Purpose: prints why the workers could not be run and exits
+    Parameters: what it was about, what went wrong
+    Returns: N/A
+*/
+static void fail(const char *what, const char *reason)
+{
+    fprintf(stderr, "um: %s: %s\n", what, reason);
+    exit(EXIT_FAILURE);
+}
+
+/*  Function: now
+    Purpose: reads a monotonic clock
+    Parameters: none
+    Returns: the time in seconds
+*/
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*  Function: read_list
+    Purpose: reads the names of the input files, one per line, skipping
+    empty lines, into a worker each
+    Parameters: the name of the list
+    Returns: N/A
+*/
+static void read_list(const char *list)
+{
+    FILE *file = fopen(list, "r");
+    if (file == NULL) {
+        fail(list, strerror(errno));
+    }
+
+    size_t cap = 16;
+    explore.workers = malloc(cap * sizeof(struct Worker));
+    assert(explore.workers != NULL);
+
+    char *line = NULL;
+    size_t line_cap = 0;
+    ssize_t length;
+    while ((length = getline(&line, &line_cap, file)) >= 0) {
+        if (length > 0 && line[length - 1] == '\n') {
+            line[--length] = '\0';
+        }
+        if (length == 0) {
+            continue;
+        }
+        if (explore.num_workers == cap) {
+            cap *= 2;
+            explore.workers = realloc(explore.workers,
+                                      cap * sizeof(struct Worker));
+            assert(explore.workers != NULL);
+        }
+        struct Worker *worker = &explore.workers[explore.num_workers++];
+        worker->path = strdup(line);
+        assert(worker->path != NULL);
+        worker->pid = 0;
+    }
+    free(line);
+    fclose(file);
+
+    if (explore.num_workers == 0) {
+        fail(list, "names no input files");
+    }
+}
+
+/*  Function: worker_fail
+    Purpose: reports why a worker could not finish and ends its process
+    Parameters: the file it was using, what went wrong
+    Returns: N/A
+*/
+static void worker_fail(const char *path, const char *reason)
+{
+    fprintf(stderr, "um: %s: %s\n", path, reason);
+    _exit(EXIT_FAILURE);
+}
+
+/*  Function: feed_input
+    Purpose: gives the machine everything in a worker's input file and
+    ends its input
+    Parameters: the console, the name of the file
+    Returns: N/A
+*/
+static void feed_input(Console_T console, const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        worker_fail(path, strerror(errno));
+    }
+
+    unsigned char buffer[READ_SIZE];
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        console_feed(console, buffer, got);
+    }
+    if (ferror(file)) {
+        worker_fail(path, strerror(errno));
+    }
+    fclose(file);
+    console_end_input(console);
+}
+
+/*  Function: run_worker
+    Purpose: the body of a forked worker: runs the warm machine on its own
+    input to the end, writing the output to name.out, and records how it
+    stopped
+    Parameters: the machine and its console, the worker, its outcome, the
+    instructions run before the marker
+    Returns: N/A, the process exits
+*/
+static void run_worker(Threaded_T machine, Console_T console,
+                       const struct Worker *worker, struct Outcome *outcome,
+                       uint64_t warm)
+{
+    feed_input(console, worker->path);
+
+    char *out_path = malloc(strlen(worker->path) + 5);
+    assert(out_path != NULL);
+    sprintf(out_path, "%s.out", worker->path);
+    FILE *out = fopen(out_path, "wb");
+    if (out == NULL) {
+        worker_fail(out_path, strerror(errno));
+    }
+
+    uint64_t executed = warm;
+    int status;
+    do {
+        status = threaded_run(machine, SLICE, &executed);
+
+        size_t count;
+        const unsigned char *bytes = console_pending(console, &count);
+        if (fwrite(bytes, 1, count, out) != count) {
+            worker_fail(out_path, strerror(errno));
+        }
+        console_consume(console, count);
+    } while (status == RUN_BUDGET);
+
+    if (fclose(out) != 0) {
+        worker_fail(out_path, strerror(errno));
+    }
+    outcome->executed = executed - warm;
+    outcome->status = status;
+    _exit(EXIT_SUCCESS);
+}
+
+/*  Function: reap
+    Purpose: waits for a worker to end and reports it
+    Parameters: none
+    Returns: N/A
+*/
+static void reap()
+{
+    int wait_status;
+    struct rusage usage;
+    pid_t pid = wait4(-1, &wait_status, 0, &usage);
+    assert(pid > 0);
+
+    size_t i = 0;
+    while (explore.workers[i].pid != pid) {
+        i++;
+    }
+    struct Worker *worker = &explore.workers[i];
+    const struct Outcome *outcome = &explore.outcomes[i];
+    worker->pid = 0;
+    explore.running--;
+
+    char how[64];
+    if (WIFSIGNALED(wait_status)) {
+        snprintf(how, sizeof(how), "was killed by signal %d",
+                 WTERMSIG(wait_status));
+        explore.failed++;
+    }
+    else if (WEXITSTATUS(wait_status) != 0 || outcome->status < 0) {
+        snprintf(how, sizeof(how), "failed");
+        explore.failed++;
+    }
+    else if (outcome->status == RUN_HALTED) {
+        snprintf(how, sizeof(how), "halted");
+        explore.halted++;
+    }
+    else if (outcome->status == RUN_FELL_OFF) {
+        snprintf(how, sizeof(how), "ran off the end");
+        explore.fell_off++;
+    }
+    else if (outcome->status == RUN_LIMIT) {
+        snprintf(how, sizeof(how), "went over a memory limit");
+        explore.failed++;
+    }
+    else {
+        snprintf(how, sizeof(how), "failed");
+        explore.failed++;
+    }
+
+    fprintf(stderr, "um: worker %zu (%s) %s after %llu instructions, "
+            "%.3f s, %ld KB peak rss, %ld minor faults\n", i + 1,
+            worker->path, how, (unsigned long long) outcome->executed,
+            now() - worker->started, usage.ru_maxrss, usage.ru_minflt);
+}
+
+/*  Function: explore_run
+    Purpose: runs a program up to a marker, then forks a worker for every
+    input file named in a list, at most one per core at a time
+    Parameters: the memory with the program loaded as segment 0, the name
+    of the list, and the instruction count to fork at or EXPLORE_AT_INPUT
+    Returns: 0 if every worker's machine halted or ran off the end, 1 if
+    any failed
+    Expectation: the memory holds only segment 0
+*/
+int explore_run(MemSeg_T memory_total, const char *list, uint64_t marker)
+{
+    read_list(list);
+    explore.cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (explore.cores < 1) {
+        explore.cores = 1;
+    }
+
+    /* the only memory the workers write that the parent sees */
+    size_t shared = explore.num_workers * sizeof(struct Outcome);
+    explore.outcomes = mmap(NULL, shared, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (explore.outcomes == MAP_FAILED) {
+        fail("explore", strerror(errno));
+    }
+    for (size_t i = 0; i < explore.num_workers; i++) {
+        explore.outcomes[i].status = -1;
+    }
+
+    /* with no input fed, the machine stops at the first IN */
+    double start = now();
+    Console_T console = console_new(CONSOLE_MEMORY, CONSOLE_MEMORY, 0);
+    Threaded_T machine = threaded_new(memory_total, console, 0);
+    uint64_t warm = 0;
+    int status = threaded_run(machine, marker, &warm);
+    if (status != RUN_WAITING && status != RUN_BUDGET) {
+        fail("explore", "the program stopped before the marker");
+    }
+    double warmed = now();
+
+    for (size_t i = 0; i < explore.num_workers; i++) {
+        if (explore.running == explore.cores) {
+            reap();
+        }
+
+        /* nothing buffered may be written twice */
+        fflush(NULL);
+        struct Worker *worker = &explore.workers[i];
+        worker->started = now();
+        worker->pid = fork();
+        if (worker->pid < 0) {
+            fail("explore", strerror(errno));
+        }
+        if (worker->pid == 0) {
+            run_worker(machine, console, worker, &explore.outcomes[i],
+                       warm);
+        }
+        explore.running++;
+    }
+    while (explore.running > 0) {
+        reap();
+    }
+
+    fprintf(stderr, "um: explore: %zu workers, at most %ld at once: %zu "
+            "halted, %zu ran off the end, %zu failed\n"
+            "um: explore: warm-up of %llu instructions took %.3f s, the "
+            "workers %.3f s\n", explore.num_workers, explore.cores,
+            explore.halted, explore.fell_off, explore.failed,
+            (unsigned long long) warm, warmed - start, now() - warmed);
+
+    int result = explore.failed == 0 ? 0 : 1;
+    threaded_free(&machine);
+    console_free(&console);
+    munmap(explore.outcomes, shared);
+    for (size_t i = 0; i < explore.num_workers; i++) {
+        free(explore.workers[i].path);
+    }
+    free(explore.workers);
+    memset(&explore, 0, sizeof(explore));
+    return result;
+}
@@ -0,0 +1,46 @@
+/**************************************************************
+ *                        explore.h
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Interface for running many inputs from one warmed-up machine
+ *
+ *     Purpose: Runs a program once up to a marker, its first IN
+ * 				or a given instruction count, and then forks one
+ * 				worker per input file from that state. Workers
+ * 				share the warm memory through the kernel's
+ * 				copy-on-write, so none of them repeats the start
+ * 				of the program; each reads its own input file and
+ * 				writes its own output file. At most one worker
+ * 				per core runs at a time.
+ *
+ *     Success Output:
+ *              name.out for every input file name, holding the
+ *              whole output of the program given that input. A
+ *              line per worker and a summary are printed to
+ *              stderr.
+ *
+ *     Failure output:
+ *              An error message is printed and the program exits
+ *              if the list of inputs cannot be read or no worker
+ *              can be started. A worker that cannot read its
+ *              input or write its output, or whose machine
+ *              fails, is reported and the others carry on.
+ *
+ **************************************************************/
+
+#include <stdint.h>
+#include "seg_mem.h"
+
+#ifndef EXPLORE_H
+#define EXPLORE_H
+
+/* a marker of no instruction count: the workers fork at the first IN */
+#define EXPLORE_AT_INPUT UINT64_MAX
+
+int explore_run(MemSeg_T memory_total, const char *list, uint64_t marker);
+
+#endif
+/* EXPLORE_H */
@@ -0,0 +1,1029 @@
+/**************************************************************
+ *                         jit.c
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Implementation for our jit.h
+ *
+ *     Purpose: Counts how often each jump target in segment 0
+ * 				is entered and, once one is hot, translates the
+ * 				basic block that starts there into x86-64 code.
+ * 				The UM registers live in host registers while
+ * 				compiled code runs, and blocks jump to each
+ * 				other through an entry table, or with a direct
+ * 				jmp when the target is a constant set earlier in
+ * 				the block. Memory, console and other operations
+ * 				are calls into seg_mem.c and console.c. A store
+ * 				into segment 0 drops every block covering the
+ * 				stored word, and a loadprogram drops all of
+ * 				them. The code buffer is writable only while a
+ * 				block is being compiled.
+ *
+ *     Success Output:
+ *              Compiled blocks leave the registers, memory and
+ * 				output exactly as the interpreter would
+ *
+ *     Failure output:
+ *              jit_new returns NULL when native code cannot be
+ * 				generated on this host, and the engine runs
+ * 				without it
+ *
+ **************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "jit.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+
+#include <stddef.h>
+#include <sys/mman.h>
+
+/* times a jump target is entered before its block is compiled */
+static const uint32_t HOT = 64;
+
+/* the most instructions translated into one block */
+static const uint32_t MAX_BLOCK = 256;
+
+/* an upper bound on the bytes of x86-64 emitted for one instruction */
+static const size_t MAX_INSN_BYTES = 192;
+
+/* size of the executable buffer; when it fills, all blocks are dropped */
+static const size_t CODE_SIZE = 16 * 1024 * 1024;
+
+/* host register holding each UM register. r0-r3 are in callee-saved
+   registers and survive helper calls; r4-r7 are spilled around them */
+static const uint8_t host[8] = { 12, 13, 14, 15, 8, 9, 10, 11 };
+
+/* host register numbers used as scratch and for helper arguments */
+enum { RAX = 0, RCX = 1, RDX = 2, RSI = 6 };
+
+/* the range of segment 0 that one compiled block was translated from,
+   including its final instruction, whether it is still in use, and
+   whether compiled code jumps straight into it rather than through the
+   entry table */
+struct Block {
+    uint32_t start;
+    uint32_t end;
+    int live;
+    int linked;
+};
+
+/* what the compiler knows of the UM registers at an instruction: which
+   hold a constant, set earlier in the block, and its value */
+struct Known {
+    int valid[8];
+    uint32_t value[8];
+};
+
+/* this struct holds fourteen variables
+    1. Set by compiled code when it leaves to a jump target that has no
+       block yet. Native code writes it at offset 0 of this struct.
+    2. The memory, console and decoded cache the helpers work on
+    3. The decoded segment 0 blocks are compiled from, and its length
+    4. The executable buffer, its used part, the shared exit code and the
+       entry trampoline
+    5. The compiled entry point of every pc, or NULL, which compiled code
+       reads to jump from block to block
+    6. How often every pc has been entered as a jump target
+    7. Whether every pc is part of a compiled block
+    8. Every compiled block, how many there are and the room for them
+*/
+struct Jit_T {
+    uint32_t jumped;
+    MemSeg_T memory_total;
+    Console_T console;
+    Decoded cache;
+    const Instr *prog;
+    uint32_t length;
+    uint8_t *code;
+    size_t code_used;
+    size_t code_start;
+    uint8_t *exit_stub;
+    uint8_t *enter;
+    void **entries;
+    uint32_t *counts;
+    uint8_t *covered;
+    struct Block *blocks;
+    uint32_t num_blocks;
+    uint32_t blocks_cap;
+};
+
+/*****************************************************************
+ *                    x86-64 instruction encoding
+ *****************************************************************/
+
+/*  Function: byte
+    Purpose: appends one byte of machine code
+    Parameters: the JIT, the byte
+    Returns: N/A
+*/
+static void byte(Jit_T jit, uint8_t b)
+{
+    jit->code[jit->code_used++] = b;
+}
+
+/*  Function: word32
+    Purpose: appends a 32 bit little-endian immediate
+    Parameters: the JIT, the value
+    Returns: N/A
+*/
+static void word32(Jit_T jit, uint32_t w)
+{
+    memcpy(jit->code + jit->code_used, &w, sizeof(w));
+    jit->code_used += sizeof(w);
+}
+
+/*  Function: word64
+    Purpose: appends a 64 bit little-endian immediate
+    Parameters: the JIT, the value
+    Returns: N/A
+*/
+static void word64(Jit_T jit, uint64_t w)
+{
+    memcpy(jit->code + jit->code_used, &w, sizeof(w));
+    jit->code_used += sizeof(w);
+}
+
+/*  Function: op_rr
+    Purpose: appends a 32 bit operation between two registers, with an
+    optional 0F escape, a REX prefix if either register is r8-r15, and a
+    register-direct ModRM byte
+    Parameters: the JIT, whether the opcode is two bytes (0F op), the
+    opcode, the ModRM reg field, the ModRM rm field
+    Returns: N/A
+*/
+static void op_rr(Jit_T jit, int escape, uint8_t op, int reg, int rm)
+{
+    uint8_t rex = 0x40 | ((reg >> 3) << 2) | (rm >> 3);
+
+    if (rex != 0x40) {
+        byte(jit, rex);
+    }
+    if (escape) {
+        byte(jit, 0x0F);
+    }
+    byte(jit, op);
+    byte(jit, 0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+/*  Function: mov_rr
+    Purpose: mov dst, src (32 bit)
+*/
+static void mov_rr(Jit_T jit, int dst, int src)
+{
+    op_rr(jit, 0, 0x89, src, dst);
+}
+
+/*  Function: spill
+    Purpose: mov [rbx + 4 * reg], host[reg] or the reverse, which moves a
+    UM register between its host register and the register array
+    Parameters: the JIT, the UM register, 1 to store or 0 to load
+    Returns: N/A
+*/
+static void spill(Jit_T jit, int reg, int store)
+{
+    int h = host[reg];
+
+    if (h >= 8) {
+        byte(jit, 0x44);
+    }
+    byte(jit, store ? 0x89 : 0x8B);
+    byte(jit, 0x40 | ((h & 7) << 3) | 3);
+    byte(jit, 4 * reg);
+}
+
+/*  Function: jump_to
+    Purpose: appends a jmp rel32 to an address in the buffer
+    Parameters: the JIT, the target
+    Returns: N/A
+*/
+static void jump_to(Jit_T jit, const uint8_t *target)
+{
+    byte(jit, 0xE9);
+    word32(jit, (uint32_t) (target - (jit->code + jit->code_used + 4)));
+}
+
+/*  Function: branch
+    Purpose: appends a short conditional jump whose target is not known
+    yet; land() fills it in
+    Parameters: the JIT, the jcc rel8 opcode
+    Returns: the offset of the displacement byte to patch
+*/
+static size_t branch(Jit_T jit, uint8_t jcc)
+{
+    byte(jit, jcc);
+    byte(jit, 0);
+    return jit->code_used - 1;
+}
+
+/*  Function: land
+    Purpose: points a short jump from branch() at the current position
+    Parameters: the JIT, the offset branch() returned
+    Returns: N/A
+*/
+static void land(Jit_T jit, size_t at)
+{
+    size_t distance = jit->code_used - (at + 1);
+    assert(distance < 128);
+    jit->code[at] = (uint8_t) distance;
+}
+
+/*  Function: op_rm
+    Purpose: appends a 32 bit operation between a register and memory at
+    [base + disp8], where base is one of rax-rdi
+    Parameters: the JIT, the opcode, the register, the base, the offset
+    Returns: N/A
+*/
+static void op_rm(Jit_T jit, uint8_t op, int reg, int base, size_t disp)
+{
+    assert(disp < 128);
+    if (reg >= 8) {
+        byte(jit, 0x44);
+    }
+    byte(jit, op);
+    byte(jit, 0x40 | ((reg & 7) << 3) | base);
+    byte(jit, (uint8_t) disp);
+}
+
+/*  Function: find_arena_segment
+    Purpose: appends the fast path's lookup of a segment of an arena
+    memory: rax points at the words of segment id, or the code branches to
+    the slow path if id is past the end of the arena or off is not in the
+    segment
+    Parameters: the JIT, the host registers holding the id and the offset,
+    and where to record the two branches to the slow path
+    Returns: N/A
+    Expectation: rcx holds memory_total
+*/
+static void find_arena_segment(Jit_T jit, int id, int off, size_t *slow)
+{
+    /* cmp id, [rcx + top]; jae slow */
+    op_rm(jit, 0x3B, id, RCX, offsetof(struct MemSeg_T, top));
+    slow[0] = branch(jit, 0x73);
+
+    /* mov rax, [rcx + arena]; mov edx, id; lea rax, [rax + rdx * 4] */
+    byte(jit, 0x48);
+    op_rm(jit, 0x8B, RAX, RCX, offsetof(struct MemSeg_T, arena));
+    mov_rr(jit, RDX, id);
+    byte(jit, 0x48); byte(jit, 0x8D); byte(jit, 0x04); byte(jit, 0x90);
+
+    /* test id, id; cmovz rax, [rcx + zero] */
+    op_rr(jit, 0, 0x85, id, id);
+    byte(jit, 0x48); byte(jit, 0x0F);
+    op_rm(jit, 0x44, RAX, RCX, offsetof(struct MemSeg_T, zero));
+
+    /* cmp off, [rax - 4]; jae slow */
+    if (off >= 8) {
+        byte(jit, 0x44);
+    }
+    byte(jit, 0x3B);
+    byte(jit, 0x40 | ((off & 7) << 3) | RAX);
+    byte(jit, 0xFC);
+    slow[1] = branch(jit, 0x73);
+}
+
+/*  Function: find_segment
+    Purpose: appends the fast path's lookup of a segment: rax points at
+    the descriptor of segment id, or the code branches to the slow path if
+    id is not in the table or off is not in the segment. In an arena
+    memory rax points at the words instead.
+    Parameters: the JIT, the host registers holding the id and the offset,
+    and where to record the two branches to the slow path
+    Returns: N/A
+*/
+static void find_segment(Jit_T jit, int id, int off, size_t *slow)
+{
+    /* mov rcx, memory_total */
+    byte(jit, 0x48); byte(jit, 0xB9);
+    word64(jit, (uintptr_t) jit->memory_total);
+    if (jit->memory_total->arena != NULL) {
+        find_arena_segment(jit, id, off, slow);
+        return;
+    }
+
+    /* cmp id, [rcx + num_segments]; jae slow */
+    op_rm(jit, 0x3B, id, RCX, offsetof(struct MemSeg_T, num_segments));
+    slow[0] = branch(jit, 0x73);
+
+    /* mov rax, [rcx + table]; mov edx, id; shl rdx, 4; add rax, rdx */
+    byte(jit, 0x48);
+    op_rm(jit, 0x8B, RAX, RCX, offsetof(struct MemSeg_T, table));
+    mov_rr(jit, RDX, id);
+    byte(jit, 0x48); byte(jit, 0xC1); byte(jit, 0xE2); byte(jit, 4);
+    byte(jit, 0x48); byte(jit, 0x01); byte(jit, 0xD0);
+
+    /* cmp off, [rax + length]; jae slow; mov rax, [rax + words] */
+    op_rm(jit, 0x3B, off, RAX, offsetof(struct Segment, length));
+    slow[1] = branch(jit, 0x73);
+    byte(jit, 0x48);
+    op_rm(jit, 0x8B, RAX, RAX, offsetof(struct Segment, words));
+}
+
+/*  Function: op_indexed
+    Purpose: appends a 32 bit move between a register and the word at
+    [rax + index * 4]
+    Parameters: the JIT, the opcode (8B to load, 89 to store), the
+    register, the host register holding the index
+    Returns: N/A
+    Expectation: the index's upper 32 bits are zero, which holds for every
+    host register because only 32 bit operations write them
+*/
+static void op_indexed(Jit_T jit, uint8_t op, int reg, int index)
+{
+    uint8_t rex = 0x40 | ((reg >> 3) << 2) | ((index >> 3) << 1);
+
+    if (rex != 0x40) {
+        byte(jit, rex);
+    }
+    byte(jit, op);
+    byte(jit, 0x04 | ((reg & 7) << 3));
+    byte(jit, 0x80 | ((index & 7) << 3));
+}
+
+/*  Function: leave_at
+    Purpose: mov eax, pc then jmp to the exit code: the block leaves and
+    the interpreter resumes at pc. Always 10 bytes long.
+    Parameters: the JIT, the pc to resume at
+    Returns: N/A
+*/
+static void leave_at(Jit_T jit, uint32_t pc)
+{
+    byte(jit, 0xB8);
+    word32(jit, pc);
+    jump_to(jit, jit->exit_stub);
+}
+
+/*****************************************************************
+ *                  helpers called by compiled code
+ *****************************************************************/
+
+/*  Function: helper_sload
+    Purpose: SLOAD from compiled code
+*/
+static uint32_t helper_sload(Jit_T jit, uint32_t b, uint32_t c)
+{
+    return segment_load(jit->memory_total, b, c);
+}
+
+/*  Function: helper_sstore
+    Purpose: SSTORE from compiled code. A store into segment 0 is decoded
+    and drops the blocks covering the word.
+    Returns: 1 if the word was part of a compiled block, which may be the
+    calling one, so it has to end. Programs that keep their data in
+    segment 0 store to it all the time, and a store to a word no block
+    was translated from changes no compiled code.
+*/
+static uint32_t helper_sstore(Jit_T jit, uint32_t a, uint32_t b, uint32_t c)
+{
+    segment_store(jit->memory_total, a, b, c);
+    if (a != 0) {
+        return 0;
+    }
+    int compiled = b < jit->length && jit->covered[b];
+    decode_store(jit->cache, b, c);
+    jit_invalidate(jit, b);
+    return compiled;
+}
+
+/*  Function: helper_map
+    Purpose: MAP from compiled code
+    Returns: the new ID, or 0 if it would go over a memory limit
+*/
+static uint32_t helper_map(Jit_T jit, uint32_t c)
+{
+    return map_segment(jit->memory_total, c);
+}
+
+/*  Function: helper_unmap
+    Purpose: UNMAP from compiled code
+*/
+static uint32_t helper_unmap(Jit_T jit, uint32_t c)
+{
+    unmap_segment(jit->memory_total, c);
+    return 0;
+}
+
+/*  Function: helper_out
+    Purpose: OUT from compiled code
+*/
+static uint32_t helper_out(Jit_T jit, uint32_t c)
+{
+    assert(c <= 255);
+    console_put(jit->console, c);
+    return 0;
+}
+
+/*  Function: call
+    Purpose: appends a call to a helper. r4-r7 are spilled to the register
+    array around it, the JIT is passed in rdi and up to three UM registers
+    in esi, edx and ecx; the result is left in eax.
+    Parameters: the JIT, the helper's address, the number of UM register
+    arguments and the registers themselves
+    Returns: N/A
+*/
+static void call(Jit_T jit, uintptr_t helper, int nargs, int a0, int a1,
+                 int a2)
+{
+    static const int arg_regs[3] = { RSI, RDX, RCX };
+    const int args[3] = { a0, a1, a2 };
+
+    for (int reg = 4; reg < 8; reg++) {
+        spill(jit, reg, 1);
+    }
+
+    /* mov rdi, rbp */
+    byte(jit, 0x48); byte(jit, 0x89); byte(jit, 0xEF);
+    for (int i = 0; i < nargs; i++) {
+        mov_rr(jit, arg_regs[i], host[args[i]]);
+    }
+
+    /* mov rax, helper; call rax */
+    byte(jit, 0x48); byte(jit, 0xB8); word64(jit, helper);
+    byte(jit, 0xFF); byte(jit, 0xD0);
+
+    for (int reg = 4; reg < 8; reg++) {
+        spill(jit, reg, 0);
+    }
+}
+
+/*****************************************************************
+ *                         block compiler
+ *****************************************************************/
+
+/*  Function: emit_stubs
+    Purpose: writes the two pieces of code every block shares. The entry
+    trampoline is called from C as enter(regs, jit, block): it saves the
+    callee-saved registers, keeps regs in rbx and the JIT in rbp, loads
+    the UM registers and jumps to the block. The exit code stores the UM
+    registers back and returns eax, the pc to resume at.
+    Parameters: the JIT
+    Returns: N/A
+*/
+static void emit_stubs(Jit_T jit)
+{
+    static const uint8_t prologue[] = {
+        0x53, 0x55, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57,
+        0x48, 0x83, 0xEC, 0x08,                 /* sub rsp, 8 (align) */
+        0x48, 0x89, 0xFB,                       /* mov rbx, rdi */
+        0x48, 0x89, 0xF5                        /* mov rbp, rsi */
+    };
+    static const uint8_t epilogue[] = {
+        0x48, 0x83, 0xC4, 0x08,                 /* add rsp, 8 */
+        0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5D, 0x5B,
+        0xC3
+    };
+
+    jit->enter = jit->code + jit->code_used;
+    memcpy(jit->code + jit->code_used, prologue, sizeof(prologue));
+    jit->code_used += sizeof(prologue);
+    for (int reg = 0; reg < 8; reg++) {
+        spill(jit, reg, 0);
+    }
+    byte(jit, 0xFF); byte(jit, 0xE2);           /* jmp rdx */
+
+    jit->exit_stub = jit->code + jit->code_used;
+    for (int reg = 0; reg < 8; reg++) {
+        spill(jit, reg, 1);
+    }
+    memcpy(jit->code + jit->code_used, epilogue, sizeof(epilogue));
+    jit->code_used += sizeof(epilogue);
+
+    jit->code_start = jit->code_used;
+}
+
+/*  Function: emit_chain
+    Purpose: appends a jump to a pc of segment 0 known when the block is
+    compiled. If the target has a block already, this is a direct jmp into
+    it, and the target block is marked as linked; otherwise the entry
+    table is read when the jump runs, and the code leaves with jumped set
+    if there is still no block.
+    Parameters: the JIT, the target
+    Returns: N/A
+*/
+static void emit_chain(Jit_T jit, uint32_t target)
+{
+    if (target >= jit->length) {
+        leave_at(jit, jit->length);
+        return;
+    }
+
+    if (jit->entries[target] != NULL) {
+        for (uint32_t i = 0; i < jit->num_blocks; i++) {
+            struct Block *block = &jit->blocks[i];
+            if (block->live && block->start == target) {
+                block->linked = 1;
+            }
+        }
+        jump_to(jit, jit->entries[target]);
+        return;
+    }
+
+    /* mov eax, target; mov rcx, &entries[target]; mov rcx, [rcx] */
+    byte(jit, 0xB8); word32(jit, target);
+    byte(jit, 0x48); byte(jit, 0xB9);
+    word64(jit, (uintptr_t) &jit->entries[target]);
+    byte(jit, 0x48); byte(jit, 0x8B); byte(jit, 0x09);
+
+    /* test rcx, rcx; jz +2; jmp rcx; mov dword [rbp], 1; jmp exit */
+    byte(jit, 0x48); byte(jit, 0x85); byte(jit, 0xC9);
+    byte(jit, 0x74); byte(jit, 2);
+    byte(jit, 0xFF); byte(jit, 0xE1);
+    byte(jit, 0xC7); byte(jit, 0x45); byte(jit, 0x00); word32(jit, 1);
+    jump_to(jit, jit->exit_stub);
+}
+
+/*  Function: emit_loadp
+    Purpose: translates LOADP. A jump to another segment leaves to the
+    interpreter at this instruction. A jump within segment 0 goes straight
+    to the target's block if it has one, and otherwise leaves with jumped
+    set so jit_run can count the target. A target set by an LV earlier in
+    the block is chained to with emit_chain.
+    Parameters: the JIT, the instruction, its pc, what is known of the
+    registers
+    Returns: N/A
+*/
+static void emit_loadp(Jit_T jit, const Instr *ins, uint32_t pc,
+                       const struct Known *known)
+{
+    /* a segment known to be another one is left to the interpreter */
+    if (known->valid[ins->b] && known->value[ins->b] != 0) {
+        leave_at(jit, pc);
+        return;
+    }
+
+    /* test rb, rb; jz +10; leave at this LOADP */
+    if (!known->valid[ins->b]) {
+        op_rr(jit, 0, 0x85, host[ins->b], host[ins->b]);
+        byte(jit, 0x74); byte(jit, 10);
+        leave_at(jit, pc);
+    }
+
+    if (known->valid[ins->c]) {
+        emit_chain(jit, known->value[ins->c]);
+        return;
+    }
+
+    /* mov eax, rc; cmp eax, length; jb +10; leave at the END record */
+    mov_rr(jit, RAX, host[ins->c]);
+    byte(jit, 0x3D); word32(jit, jit->length);
+    byte(jit, 0x72); byte(jit, 10);
+    leave_at(jit, jit->length);
+
+    /* mov rcx, entries; mov rcx, [rcx + rax * 8]; test rcx, rcx */
+    byte(jit, 0x48); byte(jit, 0xB9); word64(jit, (uintptr_t) jit->entries);
+    byte(jit, 0x48); byte(jit, 0x8B); byte(jit, 0x0C); byte(jit, 0xC1);
+    byte(jit, 0x48); byte(jit, 0x85); byte(jit, 0xC9);
+
+    /* jz +2; jmp rcx; mov dword [rbp], 1; jmp exit */
+    byte(jit, 0x74); byte(jit, 2);
+    byte(jit, 0xFF); byte(jit, 0xE1);
+    byte(jit, 0xC7); byte(jit, 0x45); byte(jit, 0x00); word32(jit, 1);
+    jump_to(jit, jit->exit_stub);
+}
+
+/*  Function: emit_sload
+    Purpose: translates SLOAD. A load in bounds is done inline; anything
+    else goes through segment_load, which reports the error.
+    Parameters: the JIT, the instruction
+    Returns: N/A
+*/
+static void emit_sload(Jit_T jit, const Instr *ins)
+{
+    size_t slow[2];
+
+    find_segment(jit, host[ins->b], host[ins->c], slow);
+    op_indexed(jit, 0x8B, host[ins->a], host[ins->c]);
+    size_t done = branch(jit, 0xEB);
+
+    land(jit, slow[0]);
+    land(jit, slow[1]);
+    call(jit, (uintptr_t) helper_sload, 2, ins->b, ins->c, 0);
+    mov_rr(jit, host[ins->a], RAX);
+    land(jit, done);
+}
+
+/*  Function: emit_sstore
+    Purpose: translates SSTORE. A store in bounds to a segment other than
+    segment 0 and the segment it shares words with is done inline;
+    anything else goes through segment_store. The block leaves right after
+    a store into segment 0 that changed compiled code, which may be the
+    rest of it.
+    Parameters: the JIT, the instruction, its pc
+    Returns: N/A
+*/
+static void emit_sstore(Jit_T jit, const Instr *ins, uint32_t pc)
+{
+    int a = host[ins->a];
+    size_t slow[4];
+
+    /* test ra, ra; jz slow; the alias check needs rcx from find_segment */
+    op_rr(jit, 0, 0x85, a, a);
+    slow[0] = branch(jit, 0x74);
+    find_segment(jit, a, host[ins->b], slow + 1);
+    op_rm(jit, 0x3B, a, RCX, offsetof(struct MemSeg_T, alias));
+    slow[3] = branch(jit, 0x74);
+    op_indexed(jit, 0x89, host[ins->c], host[ins->b]);
+    size_t done = branch(jit, 0xEB);
+
+    for (int i = 0; i < 4; i++) {
+        land(jit, slow[i]);
+    }
+    call(jit, (uintptr_t) helper_sstore, 3, ins->a, ins->b, ins->c);
+    op_rr(jit, 0, 0x85, RAX, RAX);
+    byte(jit, 0x74); byte(jit, 10);
+    leave_at(jit, pc + 1);
+    land(jit, done);
+}
+
+/*  Function: learn
+    Purpose: updates what is known of the registers after an instruction.
+    LV sets a constant and arithmetic on constants is folded; any other
+    write makes the register unknown.
+    Parameters: what is known, the instruction
+    Returns: N/A
+*/
+static void learn(struct Known *known, const Instr *ins)
+{
+    int a = ins->a, b = ins->b, c = ins->c;
+    int both = known->valid[b] && known->valid[c];
+    uint32_t vb = known->value[b], vc = known->value[c];
+
+    switch (decode_base(ins->op)) {
+    case OP_LV:
+        known->valid[a] = 1;
+        known->value[a] = ins->value;
+        break;
+    case OP_ADD:
+        known->valid[a] = both;
+        known->value[a] = vb + vc;
+        break;
+    case OP_MUL:
+        known->valid[a] = both;
+        known->value[a] = vb * vc;
+        break;
+    case OP_NAND:
+        known->valid[a] = both;
+        known->value[a] = ~(vb & vc);
+        break;
+    case OP_CMOV:
+        /* a move that is known not to happen leaves ra as it was */
+        if (!known->valid[c] || vc != 0) {
+            known->valid[a] = known->valid[c] && known->valid[b];
+            known->value[a] = vb;
+        }
+        break;
+    case OP_SLOAD:
+    case OP_DIV:
+        known->valid[a] = 0;
+        break;
+    case OP_MAP:
+        known->valid[b] = 0;
+        break;
+    default:
+        break;
+    }
+}
+
+/*  Function: emit_instr
+    Purpose: translates one instruction
+    Parameters: the JIT, the instruction, its pc, what is known of the
+    registers before it
+    Returns: 1 if the instruction ends the block, otherwise 0
+*/
+static int emit_instr(Jit_T jit, const Instr *ins, uint32_t pc,
+                      const struct Known *known)
+{
+    int a = host[ins->a];
+    int b = host[ins->b];
+    int c = host[ins->c];
+
+    switch (decode_base(ins->op)) {
+    case OP_CMOV:
+        op_rr(jit, 0, 0x85, c, c);              /* test rc, rc */
+        op_rr(jit, 1, 0x45, a, b);              /* cmovnz ra, rb */
+        return 0;
+    case OP_ADD:
+        mov_rr(jit, RAX, b);
+        op_rr(jit, 0, 0x01, c, RAX);            /* add eax, rc */
+        mov_rr(jit, a, RAX);
+        return 0;
+    case OP_MUL:
+        mov_rr(jit, RAX, b);
+        op_rr(jit, 1, 0xAF, RAX, c);            /* imul eax, rc */
+        mov_rr(jit, a, RAX);
+        return 0;
+    case OP_DIV:
+        mov_rr(jit, RAX, b);
+        op_rr(jit, 0, 0x31, RDX, RDX);          /* xor edx, edx */
+        op_rr(jit, 0, 0xF7, 6, c);              /* div rc */
+        mov_rr(jit, a, RAX);
+        return 0;
+    case OP_NAND:
+        mov_rr(jit, RAX, b);
+        op_rr(jit, 0, 0x21, c, RAX);            /* and eax, rc */
+        op_rr(jit, 0, 0xF7, 2, RAX);            /* not eax */
+        mov_rr(jit, a, RAX);
+        return 0;
+    case OP_LV:
+        if (a >= 8) {
+            byte(jit, 0x41);
+        }
+        byte(jit, 0xB8 + (a & 7));              /* mov ra, value */
+        word32(jit, ins->value);
+        return 0;
+    case OP_SLOAD:
+        emit_sload(jit, ins);
+        return 0;
+    case OP_SSTORE:
+        emit_sstore(jit, ins, pc);
+        return 0;
+    case OP_MAP:
+        /* a map over a memory limit leaves rB alone and leaves to the
+           interpreter at the MAP, which is refused again and stops */
+        call(jit, (uintptr_t) helper_map, 1, ins->c, 0, 0);
+        op_rr(jit, 0, 0x85, RAX, RAX);          /* test eax, eax */
+        byte(jit, 0x75); byte(jit, 10);         /* jnz +10 */
+        leave_at(jit, pc);
+        mov_rr(jit, b, RAX);
+        return 0;
+    case OP_UNMAP:
+        call(jit, (uintptr_t) helper_unmap, 1, ins->c, 0, 0);
+        return 0;
+    case OP_OUT:
+        call(jit, (uintptr_t) helper_out, 1, ins->c, 0, 0);
+        return 0;
+    case OP_LOADP:
+        emit_loadp(jit, ins, pc, known);
+        return 1;
+    default:
+        /* IN, HALT, invalid opcodes and the END record are left to the
+           interpreter, which takes snapshots at IN */
+        leave_at(jit, pc);
+        return 1;
+    }
+}
+
+/*  Function: flush
+    Purpose: drops every compiled block, keeping the shared stubs
+    Parameters: the JIT
+    Returns: N/A
+*/
+static void flush(Jit_T jit)
+{
+    jit->code_used = jit->code_start;
+    jit->num_blocks = 0;
+    if (jit->length != 0) {
+        memset(jit->entries, 0, jit->length * sizeof(void *));
+        memset(jit->covered, 0, jit->length);
+    }
+}
+
+/*  Function: compile
+    Purpose: translates the block starting at pc and records it
+    Parameters: the JIT, the first pc of the block
+    Returns: the block's entry point
+*/
+static void *compile(Jit_T jit, uint32_t start)
+{
+    if (CODE_SIZE - jit->code_used < MAX_BLOCK * MAX_INSN_BYTES) {
+        flush(jit);
+    }
+
+    /* the buffer is never writable and executable at once */
+    int status = mprotect(jit->code, CODE_SIZE, PROT_READ | PROT_WRITE);
+    assert(status == 0);
+
+    /* the entry is set first, so a loop back to the start of the block
+       is a direct jump */
+    uint8_t *entry = jit->code + jit->code_used;
+    jit->entries[start] = entry;
+    struct Known known;
+    memset(&known, 0, sizeof(known));
+    uint32_t pc = start;
+    uint32_t end;
+
+    for (;;) {
+        /* a block that is cut short carries on at the next pc */
+        if (pc - start == MAX_BLOCK) {
+            emit_chain(jit, pc);
+            end = pc;
+            break;
+        }
+        if (emit_instr(jit, &jit->prog[pc], pc, &known)) {
+            end = pc + 1;
+            break;
+        }
+        learn(&known, &jit->prog[pc]);
+        pc++;
+    }
+
+    if (end > jit->length) {
+        end = jit->length;
+    }
+    for (uint32_t i = start; i < end; i++) {
+        jit->covered[i] = 1;
+    }
+
+    if (jit->num_blocks == jit->blocks_cap) {
+        jit->blocks_cap = jit->blocks_cap == 0 ? 64 : 2 * jit->blocks_cap;
+        jit->blocks = realloc(jit->blocks,
+                              jit->blocks_cap * sizeof(struct Block));
+        assert(jit->blocks != NULL);
+    }
+    struct Block *block = &jit->blocks[jit->num_blocks++];
+    block->start = start;
+    block->end = end;
+    block->live = 1;
+    block->linked = 0;
+
+    status = mprotect(jit->code, CODE_SIZE, PROT_READ | PROT_EXEC);
+    assert(status == 0);
+    (void) status;
+    return entry;
+}
+
+/*****************************************************************
+ *                            interface
+ *****************************************************************/
+
+/*  Function: jit_new
+    Purpose: creates a JIT and its executable buffer
+    Parameters: the memory, console and decoded cache the program runs on
+    Returns: an allocated Jit_T, or NULL if executable memory is not
+    available
+    Expectation: jit_reset is called before jit_run
+*/
+Jit_T jit_new(MemSeg_T memory_total, Console_T console, Decoded cache)
+{
+    /* writable while code is emitted, executable while it runs */
+    void *code = mmap(NULL, CODE_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+        return NULL;
+    }
+
+    Jit_T jit = calloc(1, sizeof(struct Jit_T));
+    assert(jit != NULL);
+    jit->memory_total = memory_total;
+    jit->console = console;
+    jit->cache = cache;
+    jit->code = code;
+    emit_stubs(jit);
+    if (mprotect(code, CODE_SIZE, PROT_READ | PROT_EXEC) != 0) {
+        munmap(code, CODE_SIZE);
+        free(jit);
+        return NULL;
+    }
+
+    return jit;
+}
+
+/*  Function: jit_free
+    Purpose: frees a JIT and all of its code, and sets the pointer to NULL
+    Parameters: a pointer to the JIT
+    Returns: N/A
+*/
+void jit_free(Jit_T *jit)
+{
+    assert(jit != NULL && *jit != NULL);
+
+    munmap((*jit)->code, CODE_SIZE);
+    free((*jit)->entries);
+    free((*jit)->counts);
+    free((*jit)->covered);
+    free((*jit)->blocks);
+    free(*jit);
+    *jit = NULL;
+}
+
+/*  Function: jit_reset
+    Purpose: drops every block and starts over on a newly loaded segment 0
+    Parameters: the JIT, the decoded segment 0 and its length
+    Returns: N/A
+    Expectation: prog has an END record at prog[length]
+*/
+void jit_reset(Jit_T jit, const Instr *prog, uint32_t length)
+{
+    assert(jit != NULL && prog != NULL);
+
+    free(jit->entries);
+    free(jit->counts);
+    free(jit->covered);
+    jit->prog = prog;
+    jit->length = length;
+    jit->entries = calloc(length + 1, sizeof(void *));
+    jit->counts = calloc(length + 1, sizeof(uint32_t));
+    jit->covered = calloc(length + 1, 1);
+    assert(jit->entries != NULL && jit->counts != NULL);
+    assert(jit->covered != NULL);
+    flush(jit);
+}
+
+/*  Function: jit_invalidate
+    Purpose: drops every block that was translated from a word of segment
+    0 that has just been stored to. If other blocks jump straight into one
+    of them, every block is dropped, since those jumps cannot be undone.
+    Parameters: the JIT, the index of the word
+    Returns: N/A
+*/
+void jit_invalidate(Jit_T jit, uint32_t index)
+{
+    assert(jit != NULL);
+
+    if (index >= jit->length || !jit->covered[index]) {
+        return;
+    }
+
+    int linked = 0;
+    for (uint32_t i = 0; i < jit->num_blocks; i++) {
+        struct Block *block = &jit->blocks[i];
+        if (block->live && block->start <= index && index < block->end) {
+            block->live = 0;
+            linked |= block->linked;
+            jit->entries[block->start] = NULL;
+            jit->counts[block->start] = 0;
+        }
+    }
+
+    /* the code stays in the buffer until the next compile, so a block
+       calling this from a helper can still leave */
+    if (linked) {
+        flush(jit);
+    }
+}
+
+/*  Function: jit_run
+    Purpose: called by the interpreter at every jump target. Runs compiled
+    code from pc for as long as it can, compiling targets that become hot.
+    Parameters: the JIT, the UM registers, the jump target
+    Returns: the pc at which the interpreter resumes
+*/
+uint32_t jit_run(Jit_T jit, uint32_t *regs, uint32_t pc)
+{
+    uint32_t (*enter)(uint32_t *, Jit_T, void *);
+    memcpy(&enter, &jit->enter, sizeof(enter));
+
+    for (;;) {
+        if (pc >= jit->length) {
+            return pc;
+        }
+
+        void *entry = jit->entries[pc];
+        if (entry == NULL) {
+            if (++jit->counts[pc] < HOT) {
+                return pc;
+            }
+            entry = compile(jit, pc);
+        }
+
+        jit->jumped = 0;
+        pc = enter(regs, jit, entry);
+        if (!jit->jumped) {
+            return pc;
+        }
+    }
+}
+
+#else
+
+/* there is no code generator for this host: jit_new always fails, so the
+   engine never calls the rest */
+
+Jit_T jit_new(MemSeg_T memory_total, Console_T console, Decoded cache)
+{
+    (void) memory_total;
+    (void) console;
+    (void) cache;
+    return NULL;
+}
+
+void jit_free(Jit_T *jit)
+{
+    (void) jit;
+}
+
+void jit_reset(Jit_T jit, const Instr *prog, uint32_t length)
+{
+    (void) jit;
+    (void) prog;
+    (void) length;
+}
+
+void jit_invalidate(Jit_T jit, uint32_t index)
+{
+    (void) jit;
+    (void) index;
+}
+
+uint32_t jit_run(Jit_T jit, uint32_t *regs, uint32_t pc)
+{
+    (void) jit;
+    (void) regs;
+    return pc;
+}
+
+#endif
@@ -0,0 +1,49 @@
+/**************************************************************
+ *                         jit.h
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Interface for our x86-64 JIT compiler
+ *
+ *     Purpose: Counts how often each jump target in segment 0
+ * 				is entered and, once one is hot, translates the
+ * 				basic block that starts there into x86-64 code.
+ * 				The UM registers live in host registers while
+ * 				compiled code runs, and blocks jump straight to
+ * 				each other through an entry table. Memory,
+ * 				console and other operations are calls into
+ * 				seg_mem.c and console.c. A store into segment 0
+ * 				drops every block covering the stored word, and
+ * 				a loadprogram drops all of them.
+ *
+ *     Success Output:
+ *              Compiled blocks leave the registers, memory and
+ * 				output exactly as the interpreter would
+ *
+ *     Failure output:
+ *              jit_new returns NULL when native code cannot be
+ * 				generated on this host, and the engine runs
+ * 				without it
+ *
+ **************************************************************/
+
+#include <stdint.h>
+#include "seg_mem.h"
+#include "console.h"
+#include "decode.h"
+
+#ifndef JIT_H
+#define JIT_H
+
+typedef struct Jit_T *Jit_T;
+
+Jit_T jit_new(MemSeg_T memory_total, Console_T console, Decoded cache);
+void jit_free(Jit_T *jit);
+void jit_reset(Jit_T jit, const Instr *prog, uint32_t length);
+void jit_invalidate(Jit_T jit, uint32_t index);
+uint32_t jit_run(Jit_T jit, uint32_t *regs, uint32_t pc);
+
+#endif
+/* JIT_H */
@@ -0,0 +1,471 @@
+/**************************************************************
+ *                        lockstep.c
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Implementation for our lockstep.h
+ *
+ *     Purpose: Both engines read from and write to memory
+ * 				consoles. The whole input is read before the
+ * 				program starts and fed to both, and the output
+ * 				is only written once both engines have produced
+ * 				the same bytes. The threaded engine checks its
+ * 				budget at jumps, so a budget of one instruction
+ * 				stops it at the end of every block; the blocks
+ * 				are kept to list the last instructions run.
+ *
+ *     Success Output:
+ *              The program's output, once both engines have
+ *              agreed on it, and a line on stderr saying they
+ *              agreed and how the program stopped
+ *
+ *     Failure output:
+ *              The first divergence is reported to stderr and um
+ *              exits with LOCKSTEP_DIVERGED
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#include "lockstep.h"
+#include "execute_op.h"
+#include "threaded.h"
+#include "console.h"
+#include "decode.h"
+
+/* how many of the last instructions run a divergence is reported with */
+#define LAST_INSTRUCTIONS 16
+
+/* how many of the last blocks are kept to find them in */
+#define LAST_BLOCKS LAST_INSTRUCTIONS
+
+/* bytes of output compared at a time */
+#define CHUNK 4096
+
+/* the two engines, by their index in struct Lockstep */
+enum side { REFERENCE = 0, THREADED };
+
+/* one basic block the engines ran: the pc it began at and how many
+   instructions it had */
+struct Block {
+    uint32_t pc;
+    uint64_t count;
+};
+
+/* this struct holds four variables
+    1. The name the engine is reported by
+    2. Its run_status after the last run
+    3. Its registers and pc after the last run
+    4. Its memory and console
+*/
+struct Side {
+    const char *name;
+    int status;
+    uint32_t regs[8];
+    uint32_t pc;
+    MemSeg_T memory;
+    Console_T console;
+};
+
+/* this struct holds six variables
+    1. Both engines, indexed by enum side
+    2. The last blocks run, the nth at n % LAST_BLOCKS
+    3. How many blocks have run
+    4. How many instructions have run
+    5. How many had run at the last checkpoint the engines agreed at
+    6. How many bytes of output were agreed on and written
+*/
+struct Lockstep {
+    struct Side sides[2];
+    struct Block blocks[LAST_BLOCKS];
+    uint64_t num_blocks;
+    uint64_t executed;
+    uint64_t checked;
+    uint64_t written;
+};
+
+/*  Function: fail
+    Purpose: prints why lockstep could not run and exits
+    Parameters: what went wrong
+    Returns: N/A
+*/
+static void fail(const char *reason)
+{
+    fprintf(stderr, "um: lockstep: %s\n", reason);
+    exit(EXIT_FAILURE);
+}
+
+/*  Function: read_input
+    Purpose: reads everything there is on a descriptor
+    Parameters: the descriptor, where to put how many bytes were read
+    Returns: the bytes, to be freed by the caller
+*/
+static unsigned char *read_input(int fd, size_t *size)
+{
+    size_t cap = CHUNK;
+    unsigned char *bytes = malloc(cap);
+    assert(bytes != NULL);
+    *size = 0;
+
+    for (;;) {
+        if (*size == cap) {
+            cap *= 2;
+            bytes = realloc(bytes, cap);
+            assert(bytes != NULL);
+        }
+        ssize_t got = read(fd, bytes + *size, cap - *size);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0) {
+            fail(strerror(errno));
+        }
+        if (got == 0) {
+            return bytes;
+        }
+        *size += got;
+    }
+}
+
+/*  Function: write_all
+    Purpose: writes bytes of output that both engines agreed on
+    Parameters: the descriptor, the bytes, how many there are
+    Returns: N/A
+*/
+static void write_all(int fd, const unsigned char *bytes, size_t count)
+{
+    while (count > 0) {
+        ssize_t put = write(fd, bytes, count);
+        if (put < 0 && errno == EINTR) {
+            continue;
+        }
+        if (put < 0) {
+            fail(strerror(errno));
+        }
+        bytes += put;
+        count -= put;
+    }
+}
+
+/*  Function: status_name
+    Purpose: names a run_status for the report
+    Parameters: the status
+    Returns: its name
+*/
+static const char *status_name(int status)
+{
+    static const char *const names[] = {
+        [RUN_HALTED] = "halted", [RUN_FELL_OFF] = "ran off the end",
+        [RUN_BUDGET] = "running", [RUN_WAITING] = "waiting for input",
+        [RUN_VIOLATION] = "violated the spec",
+        [RUN_LIMIT] = "went over a memory limit"
+    };
+    return status >= 0 && status <= RUN_LIMIT && names[status] != NULL
+           ? names[status] : "unknown";
+}
+
+/*  Function: print_state
+    Purpose: prints the status, pc and registers of both engines side by
+    side, marking the ones that differ
+    Parameters: the lockstep
+    Returns: N/A
+*/
+static void print_state(const struct Lockstep *ls)
+{
+    const struct Side *ref = &ls->sides[REFERENCE];
+    const struct Side *opt = &ls->sides[THREADED];
+
+    fprintf(stderr, "            %-18s %s\n", ref->name, opt->name);
+    fprintf(stderr, "  status    %-18s %s%s\n", status_name(ref->status),
+            status_name(opt->status),
+            ref->status != opt->status ? "  <" : "");
+    fprintf(stderr, "  pc        %-18u %u%s\n", ref->pc, opt->pc,
+            ref->pc != opt->pc ? "  <" : "");
+    for (int i = 0; i < 8; i++) {
+        fprintf(stderr, "  r%d        0x%08x         0x%08x%s\n", i,
+                ref->regs[i], opt->regs[i],
+                ref->regs[i] != opt->regs[i] ? "  <" : "");
+    }
+}
+
+/*  Function: print_last
+    Purpose: lists the last instructions run, oldest first, as they are in
+    the reference engine's segment 0 now
+    Parameters: the lockstep
+    Returns: N/A
+*/
+static void print_last(const struct Lockstep *ls)
+{
+    uint32_t pcs[LAST_INSTRUCTIONS];
+    int num_pcs = 0;
+
+    /* walk back from the newest block, and within each block from its
+       last instruction, since a block runs straight through */
+    for (uint64_t n = ls->num_blocks; n > 0 && num_pcs < LAST_INSTRUCTIONS &&
+         ls->num_blocks - n < LAST_BLOCKS; n--) {
+        const struct Block *block = &ls->blocks[(n - 1) % LAST_BLOCKS];
+        for (uint64_t i = block->count; i > 0 &&
+             num_pcs < LAST_INSTRUCTIONS; i--) {
+            pcs[num_pcs++] = block->pc + (uint32_t) (i - 1);
+        }
+    }
+
+    MemSeg_T memory = ls->sides[REFERENCE].memory;
+    uint32_t length = seg_length(memory, 0);
+    fprintf(stderr, "  last instructions run:\n");
+    for (int i = num_pcs - 1; i >= 0; i--) {
+        if (pcs[i] >= length) {
+            fprintf(stderr, "    %10u  (past the end of segment 0)\n",
+                    pcs[i]);
+            continue;
+        }
+        char text[64];
+        uint32_t word = segment_load(memory, 0, pcs[i]);
+        decode_text(word, text, sizeof(text));
+        fprintf(stderr, "    %10u  %08x  %s\n", pcs[i], word, text);
+    }
+}
+
+/*  Function: diverge
+    Purpose: reports the first divergence with where it was found, the
+    state of both engines and the last instructions run
+    Parameters: the lockstep, whether it was found at a checkpoint rather
+    than at the end of a block, a printf format saying what differs and
+    its arguments
+    Returns: LOCKSTEP_DIVERGED
+*/
+static int diverge(const struct Lockstep *ls, int at_checkpoint,
+                   const char *format, ...)
+{
+    fprintf(stderr, "um: lockstep: the engines diverged: ");
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+
+    if (at_checkpoint) {
+        fprintf(stderr, "  between the checkpoints after %llu and %llu "
+                "instructions\n", (unsigned long long) ls->checked,
+                (unsigned long long) ls->executed);
+    }
+    else {
+        const struct Block *block =
+            &ls->blocks[(ls->num_blocks - 1) % LAST_BLOCKS];
+        fprintf(stderr, "  in the block of %llu instructions from pc %u to "
+                "pc %llu, after %llu instructions\n",
+                (unsigned long long) block->count, block->pc,
+                (unsigned long long) (block->pc + block->count - 1),
+                (unsigned long long) ls->executed);
+    }
+    print_state(ls);
+    print_last(ls);
+    return LOCKSTEP_DIVERGED;
+}
+
+/*  Function: check_state
+    Purpose: compares the status, registers and pc of both engines. The pc
+    is only compared while both are running, since a halted reference
+    engine stays at its HALT
+    Parameters: the lockstep
+    Returns: 0 if they agree, otherwise LOCKSTEP_DIVERGED
+*/
+static int check_state(const struct Lockstep *ls)
+{
+    const struct Side *ref = &ls->sides[REFERENCE];
+    const struct Side *opt = &ls->sides[THREADED];
+
+    if (ref->status != opt->status) {
+        return diverge(ls, 0, "the reference engine %s, the threaded "
+                       "engine %s", status_name(ref->status),
+                       status_name(opt->status));
+    }
+    if (ref->status == RUN_BUDGET && ref->pc != opt->pc) {
+        return diverge(ls, 0, "they jumped to different pcs");
+    }
+    for (int i = 0; i < 8; i++) {
+        if (ref->regs[i] != opt->regs[i]) {
+            return diverge(ls, 0, "r%d differs", i);
+        }
+    }
+    return 0;
+}
+
+/*  Function: check_segments
+    Purpose: compares every segment of both engines
+    Parameters: the lockstep
+    Returns: 0 if they agree, otherwise LOCKSTEP_DIVERGED
+*/
+static int check_segments(const struct Lockstep *ls)
+{
+    MemSeg_T ref = ls->sides[REFERENCE].memory;
+    MemSeg_T opt = ls->sides[THREADED].memory;
+    uint32_t num_ids = seg_id_limit(ref) > seg_id_limit(opt)
+                     ? seg_id_limit(ref) : seg_id_limit(opt);
+
+    for (uint32_t id = 0; id < num_ids; id++) {
+        int ref_mapped = seg_mapped(ref, id);
+        int opt_mapped = seg_mapped(opt, id);
+        if (ref_mapped != opt_mapped) {
+            return diverge(ls, 1, "segment %u is only mapped by the %s "
+                           "engine", id, ref_mapped ? "reference"
+                                                    : "threaded");
+        }
+        if (!ref_mapped) {
+            continue;
+        }
+
+        uint32_t ref_length, opt_length;
+        const uint32_t *ref_words = get_segment(ref, id, &ref_length);
+        const uint32_t *opt_words = get_segment(opt, id, &opt_length);
+        if (ref_length != opt_length) {
+            return diverge(ls, 1, "segment %u has %u words in the "
+                           "reference engine and %u in the threaded "
+                           "engine", id, ref_length, opt_length);
+        }
+        if (memcmp(ref_words, opt_words,
+                   (size_t) ref_length * sizeof(uint32_t)) == 0) {
+            continue;
+        }
+        uint32_t at = 0;
+        while (ref_words[at] == opt_words[at]) {
+            at++;
+        }
+        return diverge(ls, 1, "word %u of segment %u is 0x%08x in the "
+                       "reference engine and 0x%08x in the threaded "
+                       "engine", at, id, ref_words[at], opt_words[at]);
+    }
+    return 0;
+}
+
+/*  Function: check_output
+    Purpose: compares the output both engines wrote since the last check,
+    and writes it if it is the same
+    Parameters: the lockstep, the descriptor to write to
+    Returns: 0 if they agree, otherwise LOCKSTEP_DIVERGED
+*/
+static int check_output(struct Lockstep *ls, int out_fd)
+{
+    unsigned char ref_bytes[CHUNK], opt_bytes[CHUNK];
+
+    for (;;) {
+        size_t ref_count = console_drain(ls->sides[REFERENCE].console,
+                                         ref_bytes, CHUNK);
+        size_t opt_count = console_drain(ls->sides[THREADED].console,
+                                         opt_bytes,
+                                         ref_count > 0 ? ref_count : CHUNK);
+        if (ref_count == 0 && opt_count == 0) {
+            return 0;
+        }
+
+        size_t same = 0;
+        while (same < ref_count && same < opt_count &&
+               ref_bytes[same] == opt_bytes[same]) {
+            same++;
+        }
+        if (same < ref_count && same < opt_count) {
+            return diverge(ls, 1, "output byte %llu is %u from the "
+                           "reference engine and %u from the threaded "
+                           "engine", (unsigned long long) ls->written + same,
+                           ref_bytes[same], opt_bytes[same]);
+        }
+        if (same < ref_count || same < opt_count) {
+            return diverge(ls, 1, "only the %s engine wrote output byte "
+                           "%llu", same < ref_count ? "reference"
+                                                    : "threaded",
+                           (unsigned long long) ls->written + same);
+        }
+        write_all(out_fd, opt_bytes, opt_count);
+        ls->written += opt_count;
+    }
+}
+
+/*  Function: lockstep_run
+    Purpose: runs a program on the reference and threaded engines at once,
+    stopping at the first place they disagree
+    Parameters: the memory, with the program loaded as segment 0, the
+    descriptors the input is read from and the output written to
+    Returns: 0 if the program halted, 1 if it ran off the end of segment 0,
+    RUN_LIMIT if it went over a memory limit, all after a line saying the
+    engines agreed, or LOCKSTEP_DIVERGED if they disagreed
+    Expectation: the memory holds only segment 0
+*/
+int lockstep_run(MemSeg_T memory_total, int in_fd, int out_fd)
+{
+    struct Lockstep *ls = calloc(1, sizeof(struct Lockstep));
+    assert(ls != NULL);
+    struct Side *ref = &ls->sides[REFERENCE];
+    struct Side *opt = &ls->sides[THREADED];
+
+    size_t size;
+    unsigned char *input = read_input(in_fd, &size);
+    ref->name = "reference";
+    opt->name = "threaded";
+    ref->memory = seg_copy_program(memory_total);
+    opt->memory = memory_total;
+    for (int i = REFERENCE; i <= THREADED; i++) {
+        struct Side *side = &ls->sides[i];
+        side->console = console_new(CONSOLE_MEMORY, CONSOLE_MEMORY, 0);
+        console_feed(side->console, input, size);
+        console_end_input(side->console);
+        side->status = RUN_BUDGET;
+    }
+    free(input);
+
+    Um um = um_new(ref->memory, ref->console);
+    Threaded_T machine = threaded_new(opt->memory, opt->console, 0);
+
+    /* the threaded engine runs one block, then the reference engine runs
+       as many instructions */
+    int result = 0;
+    while (result == 0 && opt->status == RUN_BUDGET) {
+        struct Block *block = &ls->blocks[ls->num_blocks++ % LAST_BLOCKS];
+        block->pc = opt->pc;
+        block->count = 0;
+        opt->status = threaded_run(machine, 1, &block->count);
+        threaded_state(machine, opt->regs, &opt->pc);
+        ls->executed += block->count;
+
+        ref->status = um_run(um, block->count);
+        /* the reference engine only finds it ran off the end, or that a
+           map or loadprogram is over a memory limit, when it tries to run
+           one more */
+        if (ref->status == RUN_BUDGET && (opt->status == RUN_FELL_OFF ||
+                                          opt->status == RUN_LIMIT)) {
+            ref->status = um_run(um, 1);
+        }
+        um_state(um, ref->regs, &ref->pc);
+
+        result = check_state(ls);
+        if (result == 0 && (opt->status != RUN_BUDGET ||
+            ls->executed - ls->checked >= LOCKSTEP_CHECKPOINT)) {
+            result = check_segments(ls);
+            if (result == 0) {
+                result = check_output(ls, out_fd);
+            }
+            ls->checked = ls->executed;
+        }
+    }
+    if (result == 0) {
+        result = opt->status;
+
+        /* um exits with 1 both when a program runs off the end and when
+           it cannot load one, so agreement is said outright */
+        fprintf(stderr, "um: lockstep: the engines agreed on %llu "
+                "instructions: the program %s\n",
+                (unsigned long long) ls->executed, status_name(result));
+    }
+
+    freeMem(um);
+    threaded_free(&machine);
+    console_free(&ref->console);
+    console_free(&opt->console);
+    free(ls);
+    return result;
+}
@@ -0,0 +1,50 @@
+/**************************************************************
+ *                        lockstep.h
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Interface for running two engines in lockstep
+ *
+ *     Purpose: Runs the reference engine, execute_op.c, beside
+ * 				the threaded engine, each with its own copy of
+ * 				the machine and the same input. The threaded
+ * 				engine runs one basic block at a time and the
+ * 				reference engine then runs as many instructions,
+ * 				after which their registers, pc and status must
+ * 				agree. Every LOCKSTEP_CHECKPOINT instructions, and
+ * 				when the program stops, every segment and the
+ * 				output are compared as well. The first place the
+ * 				two disagree is reported with the state of both
+ * 				sides and the last instructions run, so a bug in
+ * 				a faster engine shows up where it happens rather
+ * 				than in the final output.
+ *
+ *     Success Output:
+ *              The program's output, once both engines have
+ *              agreed on it, and a line on stderr saying they
+ *              agreed and how the program stopped
+ *
+ *     Failure output:
+ *              The first divergence is reported to stderr and um
+ *              exits with LOCKSTEP_DIVERGED
+ *
+ **************************************************************/
+
+#include "seg_mem.h"
+
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+/* the exit status of um when the engines did not agree */
+#define LOCKSTEP_DIVERGED 7
+
+/* how many instructions run between two comparisons of every segment and
+   of the output */
+#define LOCKSTEP_CHECKPOINT (1u << 24)
+
+int lockstep_run(MemSeg_T memory_total, int in_fd, int out_fd);
+
+#endif
+/* LOCKSTEP_H */
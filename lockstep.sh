@@ -0,0 +1,72 @@
+#!/bin/bash
+#
+#                         lockstep.sh
+#
+#     Assignment: Homework 6 - Universal Machine
+#     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+#     Date: Nov 21, 2021
+#
+#     Runs every image with ./um -d, which runs the reference and
+#     threaded engines side by side, and prints whether they agreed
+#     on each. The report of the first divergence of an image is
+#     printed under it. By default the images are the unit tests
+#     listed in UMTESTS, midmark and sandmark, and every image
+#     reads input.txt as its input.
+#
+#     Usage: ./lockstep.sh [-u um] [-i "images"]
+#
+#     An image only passes if um says the engines agreed on it. It
+#     exits with failure if the engines diverged on any image, an
+#     image is missing, or um failed for any other reason.
+#
+
+UM=./um
+IMAGES="$(cat UMTESTS) midmark.um sandmark.umz"
+
+usage() {
+    echo "Usage: $0 [-u um] [-i \"images\"]" >&2
+    exit 1
+}
+
+while getopts "u:i:" opt; do
+    case $opt in
+        u) UM=$OPTARG ;;
+        i) IMAGES=$OPTARG ;;
+        *) usage ;;
+    esac
+done
+[ $OPTIND -gt $# ] || usage
+
+TMP=$(mktemp)
+trap 'rm -f "$TMP"' EXIT
+failed=0
+
+for image in $IMAGES; do
+    if [ ! -r "$image" ]; then
+        printf "%-20s %-10s\n" "$image" MISSING
+        failed=1
+        continue
+    fi
+
+    start=$(date +%s%N)
+    "$UM" -d "$image" < input.txt > /dev/null 2> "$TMP"
+    status=$?
+    end=$(date +%s%N)
+
+    # um exits with 1 both for a program that ran off the end and for one
+    # it could not load or a usage error, so only the line lockstep_run
+    # prints when the engines agree counts
+    if [ $status -eq 7 ]; then
+        result=DIVERGED
+    elif grep -q "^um: lockstep: the engines agreed" "$TMP"; then
+        result=agreed
+    else
+        result="FAILED (status $status)"
+    fi
+    [ "$result" = agreed ] || failed=1
+    printf "%-20s %-10s %8.2fs\n" "$image" "$result" \
+           "$(awk -v t=$((end - start)) 'BEGIN { print t / 1e9 }')"
+    [ "$result" = agreed ] || cat "$TMP"
+done
+
+exit $failed
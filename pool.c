@@ -0,0 +1,433 @@
+/**************************************************************
+ *                       pool.c
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Implementation for our pool.h
+ *
+ *     Purpose: Hands out the word storage of every segment.
+ * 				Small segments are carved out of large slabs,
+ * 				one free list per size class, so mapping and
+ * 				unmapping them does not call malloc or free.
+ * 				Large segments are malloc'd but kept for reuse
+ * 				once unmapped. Huge segments, of MMAP_MIN words
+ * 				or more, get their own anonymous mapping, whose
+ * 				pages the kernel zeroes only when they are first
+ * 				touched, and are unmapped as soon as they are
+ * 				released. Everything the pool ever handed out is
+ * 				released at once by pool_free.
+ *
+ *     Success Output:
+ *              Storage is handed out zeroed and recycled when
+ * 				released
+ *
+ *     Failure output:
+ *              A Hanson checked runtime exception is raised if
+ *              memory for a slab or segment cannot be allocated
+ *
+ **************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/mman.h>
+#include "pool.h"
+
+/* block sizes in words of the small size classes. Every size is even so
+   that a freed block can hold the pointer of its free list */
+#define NUM_CLASSES 18
+static const uint32_t class_words[NUM_CLASSES] = {
+    2, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768,
+    1024
+};
+
+/* segments longer than the largest class are large segments */
+static const uint32_t SMALL_MAX = 1024;
+
+/* bytes in one slab that small blocks are carved from */
+static const size_t SLAB_BYTES = 256 * 1024;
+
+/* the most unmapped large segments kept for reuse */
+static const uint32_t LARGE_CACHE = 32;
+
+/* segments of at least this many words (256 KB) are huge segments. A
+   program rarely touches every word of one, so zeroing them by hand
+   would cost more than the kernel's zero pages */
+static const uint32_t MMAP_MIN = 64 * 1024;
+
+/* header at the start of every slab, linking all slabs together */
+struct Slab {
+    struct Slab *next;
+    uint64_t pad;
+};
+
+/* header in front of every large and huge segment. all links every large
+   block the pool holds, or every huge one; free links the large ones that
+   are cached for reuse */
+struct Large {
+    struct Large *prev;
+    struct Large *next;
+    struct Large *free;
+    uint64_t capacity;
+};
+
+/* this struct holds thirteen variables
+    1. One free list of released blocks per size class
+    2. The list of slabs
+    3. The unused part of the newest slab
+    4. The end of the newest slab
+    5. Every large block held, live or cached
+    6. The large blocks cached for reuse
+    7. How many large blocks are cached
+    8. Every huge block, all of which are live
+    9. The number of allocations
+    10. How many allocations were served by recycled storage
+    11. How many were huge, each its own mapping
+    12. The bytes held from the system
+    13. The bytes currently handed out
+*/
+struct Pool_T {
+    void *free_lists[NUM_CLASSES];
+    struct Slab *slabs;
+    char *bump;
+    char *bump_end;
+    struct Large *large;
+    struct Large *large_free;
+    uint32_t num_large_free;
+    struct Large *huge;
+    uint64_t allocs;
+    uint64_t hits;
+    uint64_t mmaps;
+    uint64_t bytes_held;
+    uint64_t bytes_live;
+};
+
+/*  Function: size_class
+    Purpose: finds the smallest size class that fits a segment
+    Parameters: the length of the segment in words, at most SMALL_MAX
+    Returns: the index of the size class
+*/
+static int size_class(uint32_t length)
+{
+    if (length <= 8) {
+        return length <= 2 ? 0 : (int) (length - 1) / 2;
+    }
+    int class = 4;
+    while (class_words[class] < length) {
+        class++;
+    }
+    return class;
+}
+
+/*  Function: huge_bytes
+    Purpose: finds the size of the mapping of a huge block
+    Parameters: the length of the segment in words
+    Returns: the size in bytes, header included
+*/
+static size_t huge_bytes(uint64_t length)
+{
+    return sizeof(struct Large) + length * sizeof(uint32_t);
+}
+
+/*  Function: pool_new
+    Purpose: creates an empty pool
+    Parameters: none
+    Returns: an allocated Pool_T
+    Expectation: none
+*/
+Pool_T pool_new()
+{
+    Pool_T pool = calloc(1, sizeof(struct Pool_T));
+    assert(pool != NULL);
+
+    return pool;
+}
+
+/*  Function: pool_free
+    Purpose: releases every slab and large segment the pool holds, whether
+    or not it is still in use, and sets the pointer to NULL
+    Parameters: a pointer to the pool to be freed
+    Returns: N/A
+    Expectation: the pool must not be NULL
+*/
+void pool_free(Pool_T *pool)
+{
+    assert(pool != NULL && *pool != NULL);
+
+    struct Slab *slab = (*pool)->slabs;
+    while (slab != NULL) {
+        struct Slab *next = slab->next;
+        free(slab);
+        slab = next;
+    }
+
+    struct Large *large = (*pool)->large;
+    while (large != NULL) {
+        struct Large *next = large->next;
+        free(large);
+        large = next;
+    }
+
+    struct Large *huge = (*pool)->huge;
+    while (huge != NULL) {
+        struct Large *next = huge->next;
+        munmap(huge, huge_bytes(huge->capacity));
+        huge = next;
+    }
+
+    free(*pool);
+    *pool = NULL;
+}
+
+/*  Function: small_alloc
+    Purpose: takes a block of a size class from its free list, or carves a
+    new one out of the newest slab
+    Parameters: the pool, the size class
+    Returns: the block, not zeroed
+*/
+static uint32_t *small_alloc(Pool_T pool, int class)
+{
+    void *block = pool->free_lists[class];
+
+    if (block != NULL) {
+        memcpy(&pool->free_lists[class], block, sizeof(void *));
+        pool->hits++;
+        return block;
+    }
+
+    size_t bytes = class_words[class] * sizeof(uint32_t);
+    if ((size_t) (pool->bump_end - pool->bump) < bytes) {
+        struct Slab *slab = malloc(SLAB_BYTES);
+        assert(slab != NULL);
+        slab->next = pool->slabs;
+        pool->slabs = slab;
+        pool->bump = (char *) (slab + 1);
+        pool->bump_end = (char *) slab + SLAB_BYTES;
+        pool->bytes_held += SLAB_BYTES;
+    }
+
+    block = pool->bump;
+    pool->bump += bytes;
+    return block;
+}
+
+/*  Function: large_alloc
+    Purpose: reuses a cached large block that is big enough but at most
+    twice the length asked for, or mallocs a new one
+    Parameters: the pool, the length of the segment in words
+    Returns: the words of the block, not zeroed
+*/
+static uint32_t *large_alloc(Pool_T pool, uint32_t length)
+{
+    struct Large **link = &pool->large_free;
+
+    for (struct Large *large = *link; large != NULL; large = *link) {
+        if (large->capacity >= length && large->capacity / 2 <= length) {
+            *link = large->free;
+            pool->num_large_free--;
+            pool->hits++;
+            return (uint32_t *) (large + 1);
+        }
+        link = &large->free;
+    }
+
+    struct Large *large = malloc(sizeof(struct Large) +
+                                 (size_t) length * sizeof(uint32_t));
+    assert(large != NULL);
+    large->capacity = length;
+    large->prev = NULL;
+    large->next = pool->large;
+    if (pool->large != NULL) {
+        pool->large->prev = large;
+    }
+    pool->large = large;
+    pool->bytes_held += sizeof(struct Large) +
+                        (uint64_t) length * sizeof(uint32_t);
+
+    return (uint32_t *) (large + 1);
+}
+
+/*  Function: huge_alloc
+    Purpose: maps a new block of anonymous memory, which is already zero
+    Parameters: the pool, the length of the segment in words
+    Returns: the words of the block
+*/
+static uint32_t *huge_alloc(Pool_T pool, uint32_t length)
+{
+    struct Large *huge = mmap(NULL, huge_bytes(length),
+                              PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    assert(huge != MAP_FAILED);
+    huge->capacity = length;
+    huge->prev = NULL;
+    huge->next = pool->huge;
+    if (pool->huge != NULL) {
+        pool->huge->prev = huge;
+    }
+    pool->huge = huge;
+    pool->mmaps++;
+    pool->bytes_held += huge_bytes(length);
+
+    return (uint32_t *) (huge + 1);
+}
+
+/*  Function: raw_alloc
+    Purpose: hands out storage for a segment without initializing it
+    Parameters: the pool, the length of the segment in words
+    Returns: the words of the segment
+*/
+static uint32_t *raw_alloc(Pool_T pool, uint32_t length)
+{
+    pool->allocs++;
+    pool->bytes_live += (uint64_t) length * sizeof(uint32_t);
+
+    if (length <= SMALL_MAX) {
+        return small_alloc(pool, size_class(length));
+    }
+    if (length >= MMAP_MIN) {
+        return huge_alloc(pool, length);
+    }
+    return large_alloc(pool, length);
+}
+
+/*  Function: pool_alloc
+    Purpose: hands out zeroed storage for a segment
+    Parameters: the pool, the length of the segment in words
+    Returns: the words of the segment. A segment of length 0 still gets a
+    (non NULL) block of the smallest class
+    Expectation: the pool must not be NULL
+*/
+uint32_t *pool_alloc(Pool_T pool, uint32_t length)
+{
+    assert(pool != NULL);
+
+    uint32_t *words = raw_alloc(pool, length);
+    if (length < MMAP_MIN) {
+        memset(words, 0, (size_t) length * sizeof(uint32_t));
+    }
+
+    return words;
+}
+
+/*  Function: pool_reserve
+    Purpose: hands out storage for a segment without zeroing it, for a
+    caller that is about to fill in every word
+    Parameters: the pool, the length of the segment in words
+    Returns: the words of the segment
+    Expectation: the pool must not be NULL
+*/
+uint32_t *pool_reserve(Pool_T pool, uint32_t length)
+{
+    assert(pool != NULL);
+
+    return raw_alloc(pool, length);
+}
+
+/*  Function: pool_copy
+    Purpose: hands out storage for a segment holding a copy of some words
+    Parameters: the pool, the words to copy, how many there are
+    Returns: the words of the new segment
+    Expectation: the pool must not be NULL
+*/
+uint32_t *pool_copy(Pool_T pool, const uint32_t *words, uint32_t length)
+{
+    assert(pool != NULL);
+    assert(words != NULL || length == 0);
+
+    uint32_t *copy = raw_alloc(pool, length);
+    if (length != 0) {
+        memcpy(copy, words, (size_t) length * sizeof(uint32_t));
+    }
+
+    return copy;
+}
+
+/*  Function: pool_release
+    Purpose: gives a segment's storage back to the pool for reuse, or
+    straight back to the system if it is huge
+    Parameters: the pool, the words of the segment, its length in words
+    Returns: N/A
+    Expectation: words came from this pool with the same length
+*/
+void pool_release(Pool_T pool, uint32_t *words, uint32_t length)
+{
+    assert(pool != NULL && words != NULL);
+
+    pool->bytes_live -= (uint64_t) length * sizeof(uint32_t);
+
+    if (length <= SMALL_MAX) {
+        int class = size_class(length);
+        memcpy(words, &pool->free_lists[class], sizeof(void *));
+        pool->free_lists[class] = words;
+        return;
+    }
+
+    if (length >= MMAP_MIN) {
+        struct Large *huge = (struct Large *) words - 1;
+        if (huge->prev != NULL) {
+            huge->prev->next = huge->next;
+        }
+        else {
+            pool->huge = huge->next;
+        }
+        if (huge->next != NULL) {
+            huge->next->prev = huge->prev;
+        }
+        pool->bytes_held -= huge_bytes(length);
+        munmap(huge, huge_bytes(length));
+        return;
+    }
+
+    struct Large *large = (struct Large *) words - 1;
+    if (pool->num_large_free < LARGE_CACHE) {
+        large->free = pool->large_free;
+        pool->large_free = large;
+        pool->num_large_free++;
+        return;
+    }
+
+    /* the cache is full, so this one goes back to the system */
+    if (large->prev != NULL) {
+        large->prev->next = large->next;
+    }
+    else {
+        pool->large = large->next;
+    }
+    if (large->next != NULL) {
+        large->next->prev = large->prev;
+    }
+    pool->bytes_held -= sizeof(struct Large) +
+                        large->capacity * sizeof(uint32_t);
+    free(large);
+}
+
+/*  Function: pool_print_stats
+    Purpose: prints how often storage was recycled, how much the pool holds
+    and how much of that is not in use
+    Parameters: the pool, the stream to print to
+    Returns: N/A
+    Expectation: the pool and stream must not be NULL
+*/
+void pool_print_stats(Pool_T pool, FILE *out)
+{
+    assert(pool != NULL && out != NULL);
+
+    double hit_rate = pool->allocs == 0 ? 0.0
+                      : 100.0 * pool->hits / pool->allocs;
+    double fragmentation = pool->bytes_held == 0 ? 0.0
+                      : 100.0 * (1.0 - (double) pool->bytes_live
+                                       / pool->bytes_held);
+
+    fprintf(out, "pool allocations:           %lu\n",
+            (unsigned long) pool->allocs);
+    fprintf(out, "pool hit rate:              %.1f%%\n", hit_rate);
+    fprintf(out, "pool mmap'd segments:       %lu\n",
+            (unsigned long) pool->mmaps);
+    fprintf(out, "pool bytes held:            %lu\n",
+            (unsigned long) pool->bytes_held);
+    fprintf(out, "pool bytes in use:          %lu\n",
+            (unsigned long) pool->bytes_live);
+    fprintf(out, "pool fragmentation:         %.1f%%\n", fragmentation);
+}
@@ -0,0 +1,49 @@
+/**************************************************************
+ *                       pool.h
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Interface for our segment storage pool
+ *
+ *     Purpose: Hands out the word storage of every segment.
+ * 				Small segments are carved out of large slabs,
+ * 				one free list per size class, so mapping and
+ * 				unmapping them does not call malloc or free.
+ * 				Large segments are malloc'd but kept for reuse
+ * 				once unmapped. Huge segments come from their own
+ * 				anonymous mmap, so their pages are only zeroed
+ * 				and resident once the program touches them, and
+ * 				go back to the system as soon as they are
+ * 				unmapped. Everything the pool ever handed out is
+ * 				released at once by pool_free.
+ *
+ *     Success Output:
+ *              Storage is handed out zeroed and recycled when
+ * 				released
+ *
+ *     Failure output:
+ *              A Hanson checked runtime exception is raised if
+ *              memory for a slab or segment cannot be allocated
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+
+#ifndef POOL_H
+#define POOL_H
+
+typedef struct Pool_T *Pool_T;
+
+Pool_T pool_new();
+void pool_free(Pool_T *pool);
+uint32_t *pool_alloc(Pool_T pool, uint32_t length);
+uint32_t *pool_reserve(Pool_T pool, uint32_t length);
+uint32_t *pool_copy(Pool_T pool, const uint32_t *words, uint32_t length);
+void pool_release(Pool_T pool, uint32_t *words, uint32_t length);
+void pool_print_stats(Pool_T pool, FILE *out);
+
+#endif
+/* POOL_H */
@@ -0,0 +1,413 @@
+/**************************************************************
+ *                       profile.c
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Implementation for our profile.h
+ *
+ *     Purpose: Keeps the one profile of a run. When a version of
+ * 				segment 0 is replaced by loadprogram or the
+ * 				program halts, its hottest pcs are kept and its
+ * 				per-pc counts are dropped, so a long run with
+ * 				many versions does not keep a counter for every
+ * 				word of every one. profile_finish writes it all
+ * 				as JSON. With a dump prefix, the words of every
+ * 				version and all of its per-pc counts are also
+ * 				written out, for umdump.
+ *
+ *     Success Output:
+ *              A JSON file with every count and time, and a .um
+ *              and a .prof file for every version of segment 0 if
+ *              they were asked for
+ *
+ *     Failure output:
+ *              An error message is printed and the program exits
+ *              if the JSON file or a dump cannot be written
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "profile.h"
+
+/* how many of the hottest pcs are kept for every version of segment 0 */
+#define HOT_PCS 16
+
+/* one pc and how often it ran */
+struct Hot {
+    uint32_t pc;
+    uint8_t op;
+    uint64_t count;
+};
+
+/* this struct holds five variables
+    1. The length of the version of segment 0
+    2. How many instructions ran from it
+    3. Its hottest pcs, most frequent first, and how many there are
+    4. The next version, in the order they ran
+*/
+struct Version {
+    uint32_t length;
+    uint64_t instructions;
+    struct Hot hot[HOT_PCS];
+    int num_hot;
+    struct Version *next;
+};
+
+/* the phases of a run that are timed */
+enum phase { LOAD = 0, EXECUTE, TEARDOWN, NUM_PHASES };
+static const char *const phase_names[NUM_PHASES] = {
+    "load", "execute", "teardown"
+};
+
+/* this struct holds eleven variables
+    1. The file the JSON is written to, or NULL if it is not wanted
+    2. The prefix of the files every version of segment 0 is dumped to,
+       or NULL if it is not dumped, and the number of versions opened
+    3. The counters the engine keeps
+    3. The last of the finished versions, which are appended to
+    4. The loadprogram sharing and copying counters of the memory, four
+       of them
+    5. What the segments of the memory held
+    6. The time of every phase, in seconds
+*/
+static struct {
+    char *path;
+    char *dump;
+    int opened;
+    struct Profile_T counters;
+    struct Version *last;
+    uint64_t copies_avoided;
+    uint64_t words_shared;
+    uint64_t copies_made;
+    uint64_t words_copied;
+    struct Seg_usage usage;
+    double phases[NUM_PHASES];
+} profile;
+
+/*  Function: profile_set_output
+    Purpose: turns on profiling, with the results written to a file
+    Parameters: the name of the JSON file
+    Returns: N/A
+*/
+void profile_set_output(const char *path)
+{
+    assert(path != NULL);
+
+    free(profile.path);
+    profile.path = malloc(strlen(path) + 1);
+    assert(profile.path != NULL);
+    strcpy(profile.path, path);
+}
+
+/*  Function: profile_set_dump
+    Purpose: turns on profiling, with every version of segment 0 written
+    to prefix.N.um when it is loaded and its count for every pc that ran
+    written to prefix.N.prof when it stops, where N is the version
+    Parameters: the prefix of the file names
+    Returns: N/A
+*/
+void profile_set_dump(const char *prefix)
+{
+    assert(prefix != NULL);
+
+    free(profile.dump);
+    profile.dump = malloc(strlen(prefix) + 1);
+    assert(profile.dump != NULL);
+    strcpy(profile.dump, prefix);
+}
+
+/*  Function: profile_get
+    Purpose: hands the profiling engine the counters to keep
+    Parameters: none
+    Returns: the counters, or NULL if profiling is off
+*/
+Profile_T profile_get()
+{
+    return profile.path != NULL || profile.dump != NULL ? &profile.counters
+                                                        : NULL;
+}
+
+/*  Function: open_dump
+    Purpose: creates one of the files a version of segment 0 is dumped to
+    Parameters: the version, the extension of the file, where to put its
+    name, which the caller frees
+    Returns: the open file
+*/
+static FILE *open_dump(int version, const char *extension, char **name)
+{
+    size_t size = strlen(profile.dump) + strlen(extension) + 16;
+    *name = malloc(size);
+    assert(*name != NULL);
+    snprintf(*name, size, "%s.%d.%s", profile.dump, version, extension);
+
+    FILE *file = fopen(*name, "w");
+    if (file == NULL) {
+        fprintf(stderr, "um: %s: %s\n", *name, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    return file;
+}
+
+/*  Function: close_dump
+    Purpose: closes a file a version of segment 0 was dumped to
+    Parameters: the file, its name, which is freed
+    Returns: N/A
+*/
+static void close_dump(FILE *file, char *name)
+{
+    if (ferror(file) || fclose(file) != 0) {
+        fprintf(stderr, "um: %s: %s\n", name, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    free(name);
+}
+
+/*  Function: profile_open_version
+    Purpose: starts counting the pcs of a new version of segment 0, and
+    dumps its words as a .um file if a dump prefix was set
+    Parameters: the counters, the words of segment 0 and their number
+    Returns: N/A
+    Expectation: the version before it, if any, has been closed
+*/
+void profile_open_version(Profile_T prof, const uint32_t *code,
+                          uint32_t length)
+{
+    assert(prof != NULL && prof->pcs == NULL);
+    assert(code != NULL || length == 0);
+
+    if (profile.dump != NULL) {
+        char *name;
+        FILE *file = open_dump(profile.opened, "um", &name);
+        for (uint32_t pc = 0; pc < length; pc++) {
+            unsigned char bytes[4] = { code[pc] >> 24, code[pc] >> 16,
+                                       code[pc] >> 8, code[pc] };
+            fwrite(bytes, 1, sizeof(bytes), file);
+        }
+        close_dump(file, name);
+    }
+    profile.opened++;
+
+    /* one more counter for the END record */
+    prof->pcs = calloc((size_t) length + 1, sizeof(uint64_t));
+    assert(prof->pcs != NULL);
+    prof->length = length;
+}
+
+/*  Function: profile_close_version
+    Purpose: keeps the hottest pcs of the version of segment 0 that has
+    just stopped running, and drops its other counts
+    Parameters: the counters, the decoded version, for the opcode of each
+    hot pc
+    Returns: N/A
+*/
+void profile_close_version(Profile_T prof, const Instr *prog)
+{
+    assert(prof != NULL && prof->pcs != NULL && prog != NULL);
+
+    struct Version *version = calloc(1, sizeof(struct Version));
+    assert(version != NULL);
+    version->length = prof->length;
+
+    for (uint32_t pc = 0; pc < prof->length; pc++) {
+        uint64_t count = prof->pcs[pc];
+        version->instructions += count;
+        if (count == 0 || (version->num_hot == HOT_PCS &&
+                           count <= version->hot[HOT_PCS - 1].count)) {
+            continue;
+        }
+
+        /* insert it in order, dropping the coolest if the list is full */
+        int i = version->num_hot < HOT_PCS ? version->num_hot++
+                                           : HOT_PCS - 1;
+        while (i > 0 && version->hot[i - 1].count < count) {
+            version->hot[i] = version->hot[i - 1];
+            i--;
+        }
+        version->hot[i].pc = pc;
+        version->hot[i].op = decode_base(prog[pc].op);
+        version->hot[i].count = count;
+    }
+
+    if (profile.last == NULL) {
+        prof->versions = version;
+    }
+    else {
+        profile.last->next = version;
+    }
+    profile.last = version;
+
+    if (profile.dump != NULL) {
+        char *name;
+        FILE *file = open_dump(profile.opened - 1, "prof", &name);
+        fprintf(file, "# pc count, for the %u words of version %d\n",
+                prof->length, profile.opened - 1);
+        for (uint32_t pc = 0; pc < prof->length; pc++) {
+            if (prof->pcs[pc] != 0) {
+                fprintf(file, "%u %llu\n", pc,
+                        (unsigned long long) prof->pcs[pc]);
+            }
+        }
+        close_dump(file, name);
+    }
+
+    free(prof->pcs);
+    prof->pcs = NULL;
+    prof->length = 0;
+}
+
+/*  Function: profile_memory
+    Purpose: records the loadprogram sharing and copying counters and the
+    usage of the memory before it is freed
+    Parameters: the counters, the memory
+    Returns: N/A
+*/
+void profile_memory(Profile_T prof, MemSeg_T memory_total)
+{
+    assert(prof != NULL && memory_total != NULL);
+
+    profile.copies_avoided = memory_total->copies_avoided;
+    profile.words_shared = memory_total->words_shared;
+    profile.copies_made = memory_total->copies_made;
+    profile.words_copied = memory_total->words_copied;
+    profile.usage = memory_total->usage;
+}
+
+/*  Function: profile_phase
+    Purpose: records the wall time of one phase of the run
+    Parameters: "load", "execute" or "teardown", and its time in seconds
+    Returns: N/A
+*/
+void profile_phase(const char *phase, double seconds)
+{
+    for (int i = 0; i < NUM_PHASES; i++) {
+        if (strcmp(phase, phase_names[i]) == 0) {
+            profile.phases[i] = seconds;
+            return;
+        }
+    }
+    assert(0);
+}
+
+/*  Function: profile_now
+    Purpose: reads a monotonic clock, for timing phases
+    Parameters: none
+    Returns: the time in seconds
+*/
+double profile_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*  Function: write_json
+    Purpose: writes the whole profile as one JSON object
+    Parameters: the file to write to
+    Returns: N/A
+*/
+static void write_json(FILE *out)
+{
+    const struct Profile_T *prof = &profile.counters;
+    uint64_t total = 0;
+    for (int op = 0; op < OP_INVALID; op++) {
+        total += prof->ops[op];
+    }
+
+    fprintf(out, "{\n  \"instructions\": %llu,\n",
+            (unsigned long long) total);
+
+    fprintf(out, "  \"seconds\": {");
+    for (int i = 0; i < NUM_PHASES; i++) {
+        fprintf(out, "%s\"%s\": %.6f", i ? ", " : " ", phase_names[i],
+                profile.phases[i]);
+    }
+    fprintf(out, " },\n");
+
+    fprintf(out, "  \"opcodes\": {");
+    for (int op = 0; op < OP_INVALID; op++) {
+        fprintf(out, "%s\n    \"%s\": %llu", op ? "," : "",
+                decode_op_name(op), (unsigned long long) prof->ops[op]);
+    }
+    fprintf(out, "\n  },\n");
+
+    fprintf(out, "  \"loadprogram\": {\n"
+            "    \"loads\": %llu,\n    \"jumps\": %llu,\n"
+            "    \"copies_avoided\": %llu,\n    \"words_shared\": %llu,\n"
+            "    \"copies_made\": %llu,\n    \"words_copied\": %llu\n  },\n",
+            (unsigned long long) prof->loadprograms,
+            (unsigned long long) prof->jumps,
+            (unsigned long long) profile.copies_avoided,
+            (unsigned long long) profile.words_shared,
+            (unsigned long long) profile.copies_made,
+            (unsigned long long) profile.words_copied);
+
+    const struct Seg_usage *usage = &profile.usage;
+    fprintf(out, "  \"memory\": {\n"
+            "    \"words\": %llu,\n    \"peak_words\": %llu,\n"
+            "    \"segments\": %u,\n    \"peak_segments\": %u,\n"
+            "    \"longest\": %u,\n    \"map_sizes\": [",
+            (unsigned long long) usage->words,
+            (unsigned long long) usage->peak_words, usage->segments,
+            usage->peak_segments, usage->longest);
+    for (int i = 0; i < SEG_SIZE_BUCKETS; i++) {
+        fprintf(out, "%s%llu", i ? ", " : "",
+                (unsigned long long) usage->map_sizes[i]);
+    }
+    fprintf(out, "]\n  },\n");
+
+    fprintf(out, "  \"segment0_versions\": [");
+    int n = 0;
+    for (const struct Version *v = prof->versions; v != NULL; v = v->next) {
+        fprintf(out, "%s\n    { \"version\": %d, \"length\": %u, "
+                "\"instructions\": %llu,\n      \"hot_pcs\": [",
+                n ? "," : "", n, v->length,
+                (unsigned long long) v->instructions);
+        for (int i = 0; i < v->num_hot; i++) {
+            fprintf(out, "%s\n        { \"pc\": %u, \"op\": \"%s\", "
+                    "\"count\": %llu }", i ? "," : "", v->hot[i].pc,
+                    decode_op_name(v->hot[i].op),
+                    (unsigned long long) v->hot[i].count);
+        }
+        fprintf(out, "\n      ] }");
+        n++;
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+/*  Function: profile_finish
+    Purpose: writes the profile as JSON, if it was asked for, and frees it
+    Parameters: none
+    Returns: N/A
+*/
+void profile_finish()
+{
+    if (profile.path != NULL) {
+        FILE *out = fopen(profile.path, "w");
+        if (out == NULL) {
+            fprintf(stderr, "um: %s: %s\n", profile.path, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        write_json(out);
+        if (fclose(out) != 0) {
+            fprintf(stderr, "um: %s: %s\n", profile.path, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    struct Version *v = profile.counters.versions;
+    while (v != NULL) {
+        struct Version *next = v->next;
+        free(v);
+        v = next;
+    }
+    free(profile.counters.pcs);
+    free(profile.path);
+    free(profile.dump);
+    memset(&profile, 0, sizeof(profile));
+}
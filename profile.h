@@ -0,0 +1,73 @@
+/**************************************************************
+ *                       profile.h
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Interface for our execution profiler
+ *
+ *     Purpose: Holds what the profiling engine records while a
+ * 				program runs: a count for every opcode, how often
+ * 				every pc of each version of segment 0 ran, the
+ * 				loadprogram calls and the words they shared or
+ * 				copied, the peak words and segments mapped with
+ * 				a histogram of map sizes, and the wall time of
+ * 				the load, execute and teardown phases. The results are written as
+ * 				JSON at exit, and every version of segment 0
+ * 				can be dumped with its counts for umdump. Only
+ * 				the engine built from
+ * 				threaded.c with UM_PROFILE counts anything, so
+ * 				the other engines pay nothing for it.
+ *
+ *     Success Output:
+ *              A JSON file with every count and time, and the
+ *              dumps if they were asked for
+ *
+ *     Failure output:
+ *              An error message is printed and the program exits
+ *              if the JSON file cannot be written
+ *
+ **************************************************************/
+
+#include <stdint.h>
+#include "seg_mem.h"
+#include "decode.h"
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+typedef struct Profile_T *Profile_T;
+
+/* this struct holds six variables
+    1. How many times every opcode of enum um_op ran
+    2. How many loadprogram instructions loaded another segment, and how
+       many only jumped within segment 0
+    3. How many times every pc of the current segment 0 ran, and its length
+    4. Every version of segment 0 that has finished running, kept by
+       profile.c
+
+   The counters are public so the profiling engine can bump them inline.
+*/
+struct Profile_T {
+    uint64_t ops[16];
+    uint64_t loadprograms;
+    uint64_t jumps;
+    uint64_t *pcs;
+    uint32_t length;
+    struct Version *versions;
+};
+
+void profile_set_output(const char *path);
+Profile_T profile_get();
+void profile_set_dump(const char *prefix);
+void profile_open_version(Profile_T prof, const uint32_t *code,
+                          uint32_t length);
+void profile_close_version(Profile_T prof, const Instr *prog);
+void profile_memory(Profile_T prof, MemSeg_T memory_total);
+void profile_phase(const char *phase, double seconds);
+double profile_now();
+void profile_finish();
+
+#endif
+/* PROFILE_H */
@@ -1,84 +1,269 @@
 /**************************************************************
  *                     readfile.c
- * 
+ *
  *     Assignment: Homework 6 - Universal Machine
  *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
  *     Date: Nov 21, 2021
  *
- *     implementation for our readfile.h 
+ *     implementation for our readfile.h
+ *
+ *     Purpose: Used to read in a um program from a file, a pipe
+ *              or stdin and store it as segment 0 of the memory
+ *              that is then passed to an engine for execution.
+ *              Regular files are memory-mapped, anything else is
+ *              read in large blocks, and the big-endian words are
+ *              byte-swapped with SIMD instructions when the CPU
+ *              has them
+ *
+ *     Success Output:
+ *              Segment 0 holds every word of the program
  *
- *     Purpose: Used to read in input from a um file passed in 
- *              as a parameter and then store that input and 
- *              pass it as a parameter to another file for 
- *              execution
- *     
- *     Success Output: 
- *              There is valid input with an EOF character at the
- *              end of the file 
- *        
  *     Failure output:
- *              A Hanson checked runtime exception is raised if 
- *              there is a problem reading in the input file
- *                  
+ *              An error message is printed and the program exits
+ *              if the file cannot be read or its length is not a
+ *              multiple of four bytes, and the program exits with
+ *              SEG_LIMIT_EXCEEDED if it is over a memory limit
+ *
  **************************************************************/
 
-#include <bitpack.h>
 #include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "readfile.h"
-#include "execute_op.h"
 
-static const unsigned BYTESIZE = 8; 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+/* bytes in one instruction */
+static const size_t WORDSIZE = 4;
+
+/* size of each read() when the program does not come from a regular file */
+static const size_t READ_BLOCK = 1 << 20;
+
+/*  Function: fail
+    Purpose: prints why the program could not be loaded and exits
+    Parameters: the name of the file, what went wrong
+    Returns: N/A
+*/
+static void fail(const char *file_name, const char *reason)
+{
+    fprintf(stderr, "um: %s: %s\n", file_name, reason);
+    exit(EXIT_FAILURE);
+}
+
+/*  Function: swap_scalar
+    Purpose: builds words from big-endian bytes, one word at a time
+    Parameters: where to put the words, the bytes, the number of words
+    Returns: N/A
+*/
+static void swap_scalar(uint32_t *words, const unsigned char *bytes,
+                        size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        const unsigned char *b = bytes + i * WORDSIZE;
+        words[i] = (uint32_t) b[0] << 24 | (uint32_t) b[1] << 16 |
+                   (uint32_t) b[2] << 8 | (uint32_t) b[3];
+    }
+}
+
+#ifdef HAVE_X86_SIMD
+
+/*  Function: swap_avx2
+    Purpose: builds words from big-endian bytes, eight words at a time
+    Parameters: where to put the words, the bytes, the number of words
+    Returns: N/A
+*/
+__attribute__((target("avx2")))
+static void swap_avx2(uint32_t *words, const unsigned char *bytes,
+                      size_t count)
+{
+    const __m256i reverse = _mm256_setr_epi8(
+                3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)
+                                       (bytes + i * WORDSIZE));
+        _mm256_storeu_si256((__m256i *) (words + i),
+                            _mm256_shuffle_epi8(v, reverse));
+    }
+    swap_scalar(words + i, bytes + i * WORDSIZE, count - i);
+}
+
+/*  Function: swap_ssse3
+    Purpose: builds words from big-endian bytes, four words at a time
+    Parameters: where to put the words, the bytes, the number of words
+    Returns: N/A
+*/
+__attribute__((target("ssse3")))
+static void swap_ssse3(uint32_t *words, const unsigned char *bytes,
+                       size_t count)
+{
+    const __m128i reverse = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+                                          11, 10, 9, 8, 15, 14, 13, 12);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (bytes + i * WORDSIZE));
+        _mm_storeu_si128((__m128i *) (words + i),
+                         _mm_shuffle_epi8(v, reverse));
+    }
+    swap_scalar(words + i, bytes + i * WORDSIZE, count - i);
+}
+
+#endif
+
+/*  Function: swap_words
+    Purpose: builds words from big-endian bytes with the widest kernel the
+    CPU supports
+    Parameters: where to put the words, the bytes, the number of words
+    Returns: N/A
+*/
+static void swap_words(uint32_t *words, const unsigned char *bytes,
+                       size_t count)
+{
+#ifdef HAVE_X86_SIMD
+    if (__builtin_cpu_supports("avx2")) {
+        swap_avx2(words, bytes, count);
+        return;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        swap_ssse3(words, bytes, count);
+        return;
+    }
+#endif
+    swap_scalar(words, bytes, count);
+}
+
+/*  Function: read_all
+    Purpose: reads everything from a descriptor that cannot be mapped,
+    such as a pipe, in large blocks
+    Parameters: the file name (for errors), the descriptor, where to put
+    the number of bytes read
+    Returns: a malloc'd buffer with the bytes
+*/
+static unsigned char *read_all(const char *file_name, int fd, size_t *size)
+{
+    size_t capacity = READ_BLOCK;
+    unsigned char *buffer = malloc(capacity);
+    assert(buffer != NULL);
+    *size = 0;
+
+    for (;;) {
+        if (capacity - *size < READ_BLOCK) {
+            capacity *= 2;
+            buffer = realloc(buffer, capacity);
+            assert(buffer != NULL);
+        }
+        ssize_t got = read(fd, buffer + *size, capacity - *size);
+        if (got == 0) {
+            return buffer;
+        }
+        if (got < 0) {
+            fail(file_name, strerror(errno));
+        }
+        *size += got;
+    }
+}
 
-/*  Function: read_file
-    Purpose: this function reads in a file and stores each instruction in 
-    a Uarray of uint32_t
-    Parameters: a filename and the total length of the program 
-    Returns: a Uarray with all the 32-bit instructions 
-    Expectation: a valid filename entered by the user 
+/*  Function: load_image
+    Purpose: stores a um program that is already in memory, as the bytes
+    of a .um file, as segment 0 of a memory
+    Parameters: the bytes, how many there are, and the memory to load them
+    into
+    Returns: the number of words in the program
+    Expectation: a whole number of words and a memory with no segments yet
 */
-UArray_T read_file(char* file_name, int length)
+uint32_t load_image(const void *bytes, size_t size, MemSeg_T memory_total)
 {
-    /* check for a valid filename input */ 
+    assert(bytes != NULL || size == 0);
+    assert(size % WORDSIZE == 0 && size / WORDSIZE <= UINT32_MAX);
+    assert(memory_total != NULL);
+
+    /* byte-swap straight into segment 0 */
+    uint32_t length = size / WORDSIZE;
+    uint32_t *seg_0 = seg_initial(memory_total, length);
+
+    /* only um sets limits before loading, and seg_mem.h has reported it */
+    if (seg_0 == NULL) {
+        exit(SEG_LIMIT_EXCEEDED);
+    }
+    swap_words(seg_0, bytes, length);
+
+    return length;
+}
+
+/*  Function: load_program
+    Purpose: reads a um program and stores it as segment 0 of a memory.
+    Regular files are memory-mapped; pipes and stdin ("-") are read in
+    large blocks.
+    Parameters: the name of the file, or "-" for stdin, and the memory to
+    load it into
+    Returns: the number of words in the program
+    Expectation: a valid filename entered by the user and a memory with
+    no segments yet
+*/
+uint32_t load_program(const char *file_name, MemSeg_T memory_total)
+{
+    /* check for a valid filename input */
     assert(file_name != NULL);
-    
-    /* declare File pointer to hold opened file */ 
-    FILE *file;
-        
-    /* try opening the file */
-    file = fopen(file_name, "rb");
-    assert(file != NULL);
-
-    /* Create a UArray to hold the segment 0 with instructions */
-    UArray_T seg_0 = UArray_new(length, sizeof(uint32_t));
-
-    /* input taken in one byte at a time, and one instruction is four bytes */
-    int byte = 0;  
-    byte = fgetc(file);
-
-    /* iterator to set words in the Uarray */
-    int word_index = 0;
-
-    /* get a byte, store it, and continue this process until there is an 
-    EOF read in as input */
-    while(byte != EOF) {  
-        /* initialise word to be initially 0 */
-        uint32_t word = 0;
-        
-        /* for loop used ot get one instruction and store it in word */
-        for (int i = 3 * BYTESIZE; i >= 0; i = i - BYTESIZE) {
-            word = (uint32_t) Bitpack_newu((uint64_t) word, BYTESIZE, i, 
-                                            (uint64_t) byte);  
-            byte = fgetc(file);
+    assert(memory_total != NULL);
+
+    int fd = strcmp(file_name, "-") == 0 ? STDIN_FILENO
+                                         : open(file_name, O_RDONLY);
+    if (fd < 0) {
+        fail(file_name, strerror(errno));
+    }
+
+    struct stat stats;
+    if (fstat(fd, &stats) < 0) {
+        fail(file_name, strerror(errno));
+    }
+
+    const unsigned char *bytes = NULL;
+    unsigned char *buffer = NULL;
+    size_t size;
+
+    if (S_ISREG(stats.st_mode)) {
+        size = stats.st_size;
+        if (size != 0) {
+            void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map == MAP_FAILED) {
+                fail(file_name, strerror(errno));
+            }
+            madvise(map, size, MADV_SEQUENTIAL);
+            bytes = map;
         }
-        
-        /* word stored in sequence */
-        uint32_t *temp = (uint32_t *) UArray_at(seg_0, word_index);
-        *temp = word;  
-        assert(temp != NULL);
-
-        /* increment index of word */
-        word_index++;
-    }    
-
-    return seg_0;
-}
\ No newline at end of file
+    }
+    else {
+        buffer = read_all(file_name, fd, &size);
+        bytes = buffer;
+    }
+
+    if (size % WORDSIZE != 0) {
+        fail(file_name, "length is not a multiple of four bytes");
+    }
+    if (size / WORDSIZE > UINT32_MAX) {
+        fail(file_name, "too many instructions");
+    }
+
+    uint32_t length = load_image(bytes, size, memory_total);
+
+    if (buffer != NULL) {
+        free(buffer);
+    }
+    else if (bytes != NULL) {
+        munmap((void *) bytes, size);
+    }
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
+
+    return length;
+}
@@ -1,37 +1,39 @@
 /**************************************************************
  *                     readfile.h
- * 
+ *
  *     Assignment: Homework 6 - Universal Machine
  *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
  *     Date: Nov 21, 2021
  *
- *     interface for our readfile 
+ *     interface for our readfile
+ *
+ *     Purpose: Used to read in a um program from a file, a pipe,
+ *              stdin or a buffer in memory and store it as segment
+ *              0 of the memory that is then passed to an engine
+ *              for execution
+ *
+ *     Success Output:
+ *              Segment 0 holds every word of the program
  *
- *     Purpose: Used to read in input from a um file passed in 
- *              as a parameter and then store that input and 
- *              pass it as a parameter to another file for 
- *              execution
- *     
- *     Success Output: 
- *              There is valid input with an EOF character at the
- *              end of the file 
- *        
  *     Failure output:
- *              A Hanson checked runtime exception is raised if 
- *              there is a problem reading in the input file
- *                  
+ *              An error message is printed and the program exits
+ *              if the file cannot be read or its length is not a
+ *              multiple of four bytes
+ *
  **************************************************************/
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <assert.h> 
-#include "uarray.h"
+#include <assert.h>
+#include <errno.h>
+#include "seg_mem.h"
 
 /* File defination READFILE_H */
 #ifndef READFILE_H
 #define READFILE_H
 
-UArray_T read_file(char* file_name, int size);
+uint32_t load_program(const char *file_name, MemSeg_T memory_total);
+uint32_t load_image(const void *bytes, size_t size, MemSeg_T memory_total);
 
 #endif
 /* READFILE_H */
\ No newline at end of file
@@ -0,0 +1,246 @@
+/**************************************************************
+ *                        sample.c
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Implementation for our sample.h
+ *
+ *     Purpose: Counts the samples in an open addressed table
+ * 				that is allocated before the timer starts, so the
+ * 				signal handler never allocates, locks or makes a
+ * 				system call. A place that finds the table full is
+ * 				counted as lost rather than recorded.
+ *
+ *     Success Output:
+ *              The folded stacks file
+ *
+ *     Failure output:
+ *              An error message is printed and the program exits
+ *              if the file cannot be written
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <signal.h>
+#include <sys/time.h>
+#include "sample.h"
+#include "decode.h"
+
+/* slots in the table of places sampled. A power of two */
+#define SAMPLE_SLOTS (1u << 16)
+
+/* how many slots a tick looks at before giving up on a place */
+#define SAMPLE_PROBES 32
+
+/* one place the machine was sampled at, and how many times. A count of
+   0 is an empty slot */
+struct Slot {
+    struct Sample_point point;
+    uint64_t count;
+};
+
+/* this struct holds six variables
+    1. The file the folded stacks are written to, NULL if sampling is off
+    2. The engine's function that says where it is, NULL when the timer
+       is not running
+    3. The table of places sampled
+    4. How many ticks there were
+    5. How many came while no program was running
+    6. How many places were lost to a full table
+*/
+static struct {
+    char *path;
+    Sample_where where;
+    struct Slot *slots;
+    uint64_t ticks;
+    uint64_t idle;
+    uint64_t lost;
+} sampler;
+
+/*  Function: fail
+    Purpose: prints why the samples could not be written and exits
+    Parameters: the name of the file, what went wrong
+    Returns: N/A
+*/
+static void fail(const char *path, const char *reason)
+{
+    fprintf(stderr, "um: %s: %s\n", path, reason);
+    exit(EXIT_FAILURE);
+}
+
+/*  Function: sample_set_output
+    Purpose: turns on sampling, with the folded stacks written to a file
+    Parameters: the name of the file
+    Returns: N/A
+*/
+void sample_set_output(const char *path)
+{
+    assert(path != NULL);
+
+    free(sampler.path);
+    sampler.path = malloc(strlen(path) + 1);
+    assert(sampler.path != NULL);
+    strcpy(sampler.path, path);
+}
+
+/*  Function: sample_enabled
+    Purpose: says whether sampling was turned on
+    Parameters: none
+    Returns: 1 if it was, otherwise 0
+*/
+int sample_enabled()
+{
+    return sampler.path != NULL;
+}
+
+/*  Function: tick
+    Purpose: the SIGPROF handler, which counts the place the machine is at
+    Parameters: the signal
+    Returns: N/A
+*/
+static void tick(int signum)
+{
+    (void) signum;
+    sampler.ticks++;
+
+    struct Sample_point point;
+    if (sampler.where == NULL || !sampler.where(&point)) {
+        sampler.idle++;
+        return;
+    }
+
+    uint32_t hash = point.pc * 2654435761u ^ point.generation * 40503u ^
+                    point.op;
+    for (uint32_t i = 0; i < SAMPLE_PROBES; i++) {
+        struct Slot *slot = &sampler.slots[(hash + i) & (SAMPLE_SLOTS - 1)];
+        if (slot->count == 0) {
+            slot->point = point;
+            slot->count = 1;
+            return;
+        }
+        if (slot->point.pc == point.pc && slot->point.op == point.op &&
+            slot->point.generation == point.generation) {
+            slot->count++;
+            return;
+        }
+    }
+    sampler.lost++;
+}
+
+/*  Function: set_timer
+    Purpose: starts or stops the SIGPROF timer
+    Parameters: the microseconds of CPU time between ticks, 0 to stop it
+    Returns: N/A
+*/
+static void set_timer(long usec)
+{
+    struct itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = usec;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+        fail(sampler.path, strerror(errno));
+    }
+}
+
+/*  Function: sample_start
+    Purpose: starts sampling an engine. Interrupted system calls are
+    restarted, so the engine's I/O does not see the signal
+    Parameters: the engine's function that says where it is
+    Returns: N/A
+    Expectation: sampling is turned on
+*/
+void sample_start(Sample_where where)
+{
+    assert(sample_enabled() && where != NULL);
+
+    if (sampler.slots == NULL) {
+        sampler.slots = calloc(SAMPLE_SLOTS, sizeof(struct Slot));
+        assert(sampler.slots != NULL);
+    }
+    sampler.where = where;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = tick;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, NULL) != 0) {
+        fail(sampler.path, strerror(errno));
+    }
+    set_timer(SAMPLE_USEC);
+}
+
+/*  Function: sample_stop
+    Purpose: stops the timer, before the engine frees what its function
+    looks at
+    Parameters: none
+    Returns: N/A
+*/
+void sample_stop()
+{
+    if (sampler.where != NULL) {
+        set_timer(0);
+        sampler.where = NULL;
+    }
+}
+
+/*  Function: by_count
+    Purpose: orders slots by descending count, empty ones last
+    Parameters: two struct Slot
+    Returns: negative, zero or positive, as qsort expects
+*/
+static int by_count(const void *x, const void *y)
+{
+    const struct Slot *a = x, *b = y;
+    return a->count < b->count ? 1 : a->count > b->count ? -1 : 0;
+}
+
+/*  Function: sample_finish
+    Purpose: stops sampling and writes the folded stacks, most sampled
+    first, if sampling was turned on
+    Parameters: none
+    Returns: N/A
+*/
+void sample_finish()
+{
+    sample_stop();
+    if (!sample_enabled()) {
+        return;
+    }
+
+    FILE *out = fopen(sampler.path, "w");
+    if (out == NULL) {
+        fail(sampler.path, strerror(errno));
+    }
+    if (sampler.slots != NULL) {
+        qsort(sampler.slots, SAMPLE_SLOTS, sizeof(struct Slot), by_count);
+        for (uint32_t i = 0; i < SAMPLE_SLOTS; i++) {
+            const struct Slot *slot = &sampler.slots[i];
+            if (slot->count == 0) {
+                break;
+            }
+            fprintf(out, "v%u;%u;%s %llu\n", slot->point.generation,
+                    slot->point.pc, decode_op_name(slot->point.op),
+                    (unsigned long long) slot->count);
+        }
+    }
+    if (fclose(out) != 0) {
+        fail(sampler.path, strerror(errno));
+    }
+    if (sampler.lost != 0) {
+        fprintf(stderr, "um: %s: %llu of %llu samples lost, too many "
+                "places\n", sampler.path, (unsigned long long) sampler.lost,
+                (unsigned long long) sampler.ticks);
+    }
+
+    free(sampler.slots);
+    free(sampler.path);
+    memset(&sampler, 0, sizeof(sampler));
+}
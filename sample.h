@@ -0,0 +1,62 @@
+/**************************************************************
+ *                        sample.h
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Interface for our sampling profiler
+ *
+ *     Purpose: Finds where a program spends host time, rather
+ * 				than how often each instruction runs. A SIGPROF
+ * 				timer interrupts the machine every SAMPLE_USEC of
+ * 				CPU time, and each tick counts the pc, opcode and
+ * 				segment 0 generation the engine is at. At exit
+ * 				the counts are written as folded stacks, one
+ * 				"vGENERATION;PC;OPCODE COUNT" line per place,
+ * 				which flamegraph.pl and speedscope read as they
+ * 				are. The reference engine publishes every
+ * 				instruction, the threaded engines the block
+ * 				they jumped to, and a tick costs about a
+ * 				microsecond, so sampling can be left on.
+ *
+ *     Success Output:
+ *              The folded stacks file
+ *
+ *     Failure output:
+ *              An error message is printed and the program exits
+ *              if the file cannot be written
+ *
+ **************************************************************/
+
+#include <stdint.h>
+
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+/* the CPU time between two samples, in microseconds */
+#define SAMPLE_USEC 1000
+
+/* this struct holds three variables
+    1. The pc of the instruction being run
+    2. Its opcode
+    3. How many times another segment has been loaded as segment 0
+*/
+struct Sample_point {
+    uint32_t pc;
+    uint32_t op;
+    uint32_t generation;
+};
+
+/* fills in where the machine is from inside the signal handler, or
+   returns 0 if it is not running a program */
+typedef int (*Sample_where)(struct Sample_point *point);
+
+void sample_set_output(const char *path);
+int sample_enabled();
+void sample_start(Sample_where where);
+void sample_stop();
+void sample_finish();
+
+#endif
+/* SAMPLE_H */
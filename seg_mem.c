@@ -9,7 +9,13 @@
  *
  *     Purpose: Used to access, map, unmap memory segments through
  * 				the program, and the functions in this file are
- * 				called by the execute_op file
+ * 				called by the execute_op file. The usage counters
+ * 				are a few adds per map and unmap, so they are
+ * 				always on. An arena is one reservation of address
+ * 				space, made accessible a chunk at a time as it
+ * 				fills; freed blocks go on a free list for their
+ * 				size class, and the pages of huge ones go back
+ * 				to the system.
  *
  *     Success Output:
  *              Memory is successfully allocated and deallocated
@@ -19,42 +25,86 @@
  *     Failure output:
  *              A Hanson checked runtime exception is raised if
  *              there is a problem with accessing any memory
- * 				segment
+ * 				segment. A program that goes over a memory limit
+ * 				is reported to stderr and the map or loadprogram
+ * 				fails, for the engine to stop the program.
  *
  **************************************************************/
 
-#include "uarray.h"
+#include <string.h>
+#include <stdarg.h>
+#include <sys/mman.h>
 #include "seg_mem.h"
 
-/* inital size of sequence */
-static const int NEWSEQ = 0;
+/* inital number of descriptors in the segment table */
+static const uint32_t NEWTABLE = 16;
 
-/* this struct holds two variables
-    1. A sequence of UArrays holding memory
-    2. A sequence of unmapped IDs to be used by the program
-*/
-struct MemSeg_T
-{
-    Seq_T heap;
-    Seq_T unmapped_IDs;
-};
+/* words of address space reserved for an arena, which IDs must be able to
+   count up to (16 GB), and how many of them are made accessible at a time
+   (4 MB) */
+static const uint64_t ARENA_WORDS = (1ull << 32) - (1u << 20);
+static const uint32_t ARENA_CHUNK = 1u << 20;
+
+/* blocks of at least this many words (256 KB) give their pages back to
+   the system when they are freed, as the pool unmaps its huge segments */
+static const uint64_t ARENA_RETURN_MIN = 64 * 1024;
+
+/* bytes in a page of the host */
+static const uint64_t PAGE_BYTES = 4096;
+
+/* whether every new memory uses an arena rather than the table */
+static int default_arena = 0;
+
+/* stream the memory statistics are printed to by seg_free, if any */
+static FILE *report = NULL;
+
+/* the limits every new memory starts with, none unless um sets them */
+static struct Seg_limits default_limits = { UINT64_MAX, UINT32_MAX,
+                                            UINT32_MAX };
 
 /*  Function: seg_new
     Purpose: this function creates a new struct of the memory segment
-    with a MemSeg_T of memory and MemSeg_T of unmapped_IDs
+    with an empty segment table and an empty stack of unmapped IDs
     Parameters: none
     Returns: an allocated MemSeg_T
     Expectation: none
 */
 MemSeg_T seg_new()
 {
-    /* malloc space for segment */
-    MemSeg_T segment = malloc(sizeof(struct MemSeg_T));
+    /* calloc space for segment, which leaves it without an arena */
+    MemSeg_T segment = calloc(1, sizeof(struct MemSeg_T));
     assert(segment != NULL);
 
-    /* initialise sequences of MemSeg_T */
-    segment->heap = Seq_new(NEWSEQ);
-    segment->unmapped_IDs = Seq_new(NEWSEQ);
+    /* the table and the free-ID stack always have the same capacity, since
+    there can never be more unmapped IDs than IDs */
+    segment->capacity = NEWTABLE;
+    segment->table = malloc(NEWTABLE * sizeof(struct Segment));
+    segment->free_ids = malloc(NEWTABLE * sizeof(uint32_t));
+    assert(segment->table != NULL && segment->free_ids != NULL);
+    segment->num_segments = 0;
+    segment->num_free = 0;
+
+    segment->alias = 0;
+    segment->copies_avoided = 0;
+    segment->copies_made = 0;
+    segment->words_shared = 0;
+    segment->words_copied = 0;
+    segment->pool = pool_new();
+    memset(&segment->usage, 0, sizeof(segment->usage));
+    segment->limits = default_limits;
+
+    /* an arena and its bitmap of IDs are only reserved here; nothing in
+    them can be touched until arena_grow makes it accessible */
+    if (default_arena) {
+        segment->arena = mmap(NULL, ARENA_WORDS * sizeof(uint32_t),
+                              PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS |
+                              MAP_NORESERVE, -1, 0);
+        segment->starts = mmap(NULL, ARENA_WORDS / 8, PROT_NONE,
+                               MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                               -1, 0);
+        assert(segment->arena != MAP_FAILED &&
+               segment->starts != MAP_FAILED);
+    }
 
     /* return MemSeg_T */
     return segment;
@@ -71,131 +121,355 @@ void seg_free(MemSeg_T memory_total)
     /* check for memory_total not being NULL */
     assert(memory_total != NULL);
 
-    if(memory_total->heap != NULL) {
-        /* free memory associated with the memory segment */
-        int heap_length = Seq_length(memory_total->heap);
-        for(int i = 0; i < heap_length; i++) {
-            UArray_T temp =  (UArray_T) Seq_get(memory_total->heap, i);
-            if(temp != NULL) {
-                UArray_free(&temp);
-            }
-        }
-        Seq_free(&(memory_total->heap));
-    }
-
-    if(memory_total->unmapped_IDs != NULL) {
-        /* free memory associated with the unmapped IDs */
-        int ids_length = Seq_length(memory_total->unmapped_IDs);
-        for(int i = 0; i < ids_length; i++) {
-            uint32_t *temp =  (uint32_t *)
-                                    Seq_get(memory_total->unmapped_IDs, i);
-            if (temp != NULL) {
-                free(temp);
-            }
-        }
-        Seq_free(&(memory_total->unmapped_IDs));
+    if (report != NULL) {
+        seg_print_stats(memory_total, report);
     }
 
-    /* free the struct MemSeg_T */
+    /* every segment's words go back to the system with the pool, or the
+    arena, at once */
+    pool_free(&memory_total->pool);
+    if (memory_total->arena != NULL) {
+        munmap(memory_total->arena, ARENA_WORDS * sizeof(uint32_t));
+        munmap(memory_total->starts, ARENA_WORDS / 8);
+    }
+
+    /* free the table, the ID stack and the struct MemSeg_T */
+    free(memory_total->table);
+    free(memory_total->free_ids);
     free(memory_total);
 }
 
-/*  Function: seg_initial
-    Purpose: creates segment 0 of the program and adds the set of instructions
-    to it
-    Parameters: A MemSeg_T to add Segment 0 to and the set of instructions
-    Returns: A MemSeg_T with the values
-    Expectation: the struct and instruction UArray must not be NULL
+/*  Function: over_limit
+    Purpose: reports a program that went over a memory limit, the first
+    time it does
+    Parameters: A MemSeg_T, a printf format saying what the program asked
+    for, and its arguments
+    Returns: 0, for the caller to return as its failure
 */
-MemSeg_T seg_initial(MemSeg_T memory_total, UArray_T codewords)
+static int over_limit(MemSeg_T memory_total, const char *format, ...)
 {
-    /* check for valid input */
-    assert(codewords != NULL);
-    assert(memory_total != NULL);
+    if (memory_total->exceeded) {
+        return 0;
+    }
+    memory_total->exceeded = 1;
+
+    fprintf(stderr, "um: memory limit exceeded: ");
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+    return 0;
+}
+
+/*  Function: add_words
+    Purpose: counts words a segment is about to hold, checking them against
+    the limit on all words
+    Parameters: A MemSeg_T, how many words
+    Returns: 1, or 0 if they would go over the limit, in which case they
+    are not counted
+*/
+static inline int add_words(MemSeg_T memory_total, uint32_t words)
+{
+    struct Seg_usage *usage = &memory_total->usage;
 
-    /* add segment 0 with instructions */
-    Seq_addhi(memory_total->heap, codewords);
+    if (usage->words + words > memory_total->limits.words) {
+        return over_limit(memory_total,
+                          "%llu more words would make %llu, the limit is "
+                          "%llu", (unsigned long long) words,
+                          (unsigned long long) (usage->words + words),
+                          (unsigned long long) memory_total->limits.words);
+    }
+    usage->words += words;
+    if (usage->words > usage->peak_words) {
+        usage->peak_words = usage->words;
+    }
+    return 1;
+}
+
+/*  Function: add_segment
+    Purpose: counts a segment that is about to be mapped, checking it
+    against every limit
+    Parameters: A MemSeg_T, the length of the segment
+    Returns: 1, or 0 if it would go over a limit, in which case it is not
+    counted
+*/
+static inline int add_segment(MemSeg_T memory_total, uint32_t length)
+{
+    struct Seg_usage *usage = &memory_total->usage;
 
-    /* return the MemSeg_T */
-    return memory_total;
+    if (length > memory_total->limits.length) {
+        return over_limit(memory_total, "a segment of %u words is longer "
+                          "than the limit of %u", length,
+                          memory_total->limits.length);
+    }
+    if (usage->segments == memory_total->limits.segments) {
+        return over_limit(memory_total, "segment %u would go over the limit "
+                          "of %u segments", usage->segments + 1,
+                          memory_total->limits.segments);
+    }
+    if (!add_words(memory_total, length)) {
+        return 0;
+    }
+
+    usage->segments++;
+    if (usage->segments > usage->peak_segments) {
+        usage->peak_segments = usage->segments;
+    }
+    if (length > usage->longest) {
+        usage->longest = length;
+    }
+    return 1;
 }
 
-/*  Function: segment_load
-    Purpose: Value of at m[regB][regC] is extracted and returned
-    Parameters: A MemSeg_T to access memory from, two registers
-    Returns: A MemSeg_T with the values
-    Expectation: the struct must not be NULL
+/*  Function: arena_class
+    Purpose: finds the smallest size class of an arena that fits a segment
+    Parameters: the length of the segment in words
+    Returns: the index of the size class
 */
-uint32_t segment_load(MemSeg_T memory_total, uint32_t regB, uint32_t regC)
+static int arena_class(uint32_t length)
 {
-     /* check for valid input */
-    assert(memory_total != NULL);
+    if (length <= 2) {
+        return 0;
+    }
+    int log = 31 - __builtin_clz(length - 1);
+    return length <= 3u << (log - 1) ? 2 * log - 1 : 2 * log;
+}
+
+/*  Function: arena_capacity
+    Purpose: gives the number of words in a block of an arena
+    Parameters: the index of the size class
+    Returns: the words of the block, headers not included
+*/
+static uint64_t arena_capacity(int class)
+{
+    return class % 2 == 1 ? 3ull << (class - 1) / 2 : 2ull << class / 2;
+}
+
+/*  Function: arena_grow
+    Purpose: makes more of an arena, and of its bitmap of IDs, accessible
+    so that it reaches at least a given number of words. The new words are
+    zero, and the arena does not move.
+    Parameters: A MemSeg_T that uses an arena, how many words it needs
+    Returns: N/A
+    Expectation: end is at most ARENA_WORDS
+*/
+static void arena_grow(MemSeg_T memory_total, uint64_t end)
+{
+    uint64_t from = memory_total->committed;
+    uint64_t to = (end + ARENA_CHUNK - 1) / ARENA_CHUNK * ARENA_CHUNK;
+    if (to > ARENA_WORDS) {
+        to = ARENA_WORDS;
+    }
+
+    int made = mprotect(memory_total->arena + from,
+                        (to - from) * sizeof(uint32_t),
+                        PROT_READ | PROT_WRITE) == 0 &&
+               mprotect(memory_total->starts + from / 64, (to - from) / 8,
+                        PROT_READ | PROT_WRITE) == 0;
+    assert(made);
+    (void) made;
+    memory_total->committed = to;
+}
 
-    /* get value at register */
-    UArray_T temp = (UArray_T) Seq_get(memory_total->heap, regB);
-    assert(temp != NULL);
+/*  Function: arena_alloc
+    Purpose: takes a block from the free list of its size class, or carves
+    a new one off the end of the arena
+    Parameters: A MemSeg_T that uses an arena, the length of the segment,
+    whether its words must be zeroed
+    Returns: the offset of the block's words, which is its ID if it is
+    mapped as a segment, or 0 if the arena has no room for it
+*/
+static uint32_t arena_alloc(MemSeg_T memory_total, uint32_t length,
+                            int zeroed)
+{
+    int class = arena_class(length);
+    uint64_t capacity = arena_capacity(class);
+    uint32_t *arena = memory_total->arena;
+    uint32_t id = memory_total->free_blocks[class];
 
-    /* set value in memory */
-    uint32_t val = * (uint32_t *) UArray_at(temp, regC);
+    if (id != 0) {
+        /* a huge block was cleaned when it was freed */
+        memory_total->free_blocks[class] = arena[id - 1];
+        if (zeroed && capacity < ARENA_RETURN_MIN) {
+            memset(arena + id, 0, (size_t) length * sizeof(uint32_t));
+        }
+    }
+    else {
+        uint64_t end = (uint64_t) memory_total->top + 2 + capacity;
+        if (end > ARENA_WORDS) {
+            return over_limit(memory_total, "the arena has no room for a "
+                              "segment of %u words, %u words are in use",
+                              length, memory_total->top);
+        }
+        if (end > memory_total->committed) {
+            arena_grow(memory_total, end);
+        }
+        id = memory_total->top + 2;
+        arena[id - 2] = class;
+        memory_total->top = end;
+    }
 
-    /* return value */
-    return val;
+    arena[id - 1] = length;
+    return id;
 }
 
-/*  Function: segment_store
-    Purpose: Stores the value of register C into memory location m[regA][regB]
-    Parameters: A MemSeg_T to access memory from, three registers
+/*  Function: arena_release
+    Purpose: puts a block back on the free list of its size class. A huge
+    block gives the pages under its words back to the system, which hands
+    them out zeroed when they are next touched, and the words on either
+    side of those pages are zeroed by hand.
+    Parameters: A MemSeg_T that uses an arena, the offset of the block's
+    words
     Returns: N/A
-    Expectation: the struct and instruction UArray must not be NULL
 */
-void segment_store(MemSeg_T memory_total, uint32_t regA, uint32_t regB,
-                      uint32_t regC)
+static void arena_release(MemSeg_T memory_total, uint32_t id)
+{
+    uint32_t *arena = memory_total->arena;
+    int class = arena[id - 2];
+    uint64_t capacity = arena_capacity(class);
+
+    if (capacity >= ARENA_RETURN_MIN) {
+        const uint64_t page = PAGE_BYTES / sizeof(uint32_t);
+        uint64_t first = ((uint64_t) id + page - 1) / page * page;
+        uint64_t last = ((uint64_t) id + capacity) / page * page;
+        uint64_t used = (uint64_t) id + arena[id - 1];
+
+        memset(arena + id, 0, (first - id) * sizeof(uint32_t));
+        if (used > last) {
+            memset(arena + last, 0, (used - last) * sizeof(uint32_t));
+        }
+        madvise(arena + first, (last - first) * sizeof(uint32_t),
+                MADV_DONTNEED);
+        memory_total->words_returned += last - first;
+    }
+
+    arena[id - 1] = memory_total->free_blocks[class];
+    memory_total->free_blocks[class] = id;
+}
+
+/*  Function: new_id
+    Purpose: hands out an ID for a new segment, reusing the most recently
+    unmapped one if there is one and growing the table otherwise
+    Parameters: A MemSeg_T to take the ID from
+    Returns: the new ID
+*/
+static uint32_t new_id(MemSeg_T memory_total)
+{
+    if (memory_total->num_free != 0) {
+        return memory_total->free_ids[--memory_total->num_free];
+    }
+
+    if (memory_total->num_segments == memory_total->capacity) {
+        memory_total->capacity *= 2;
+        memory_total->table = realloc(memory_total->table,
+                        memory_total->capacity * sizeof(struct Segment));
+        memory_total->free_ids = realloc(memory_total->free_ids,
+                        memory_total->capacity * sizeof(uint32_t));
+        assert(memory_total->table != NULL);
+        assert(memory_total->free_ids != NULL);
+    }
+
+    return memory_total->num_segments++;
+}
+
+/*  Function: seg_initial
+    Purpose: creates segment 0 of the program, for the loader to fill in
+    with the set of instructions
+    Parameters: A MemSeg_T to add Segment 0 to and the number of
+    instructions
+    Returns: the words of segment 0, not yet initialized, or NULL if the
+    program is over a memory limit
+    Expectation: the struct must not be NULL and must have no segments
+*/
+uint32_t *seg_initial(MemSeg_T memory_total, uint32_t length)
 {
-     /* check for valid input */
+    /* check for valid input */
     assert(memory_total != NULL);
+    assert(memory_total->num_segments == 0 && memory_total->zero == NULL);
 
-    /* get value at register A */
-    UArray_T temp = (UArray_T) Seq_get(memory_total->heap, regA);
+    /* add segment 0 */
+    if (!add_segment(memory_total, length)) {
+        return NULL;
+    }
+    if (memory_total->arena != NULL) {
+        uint32_t id = arena_alloc(memory_total, length, 0);
+        if (id == 0) {
+            return NULL;
+        }
+        memory_total->zero = memory_total->arena + id;
+        return memory_total->zero;
+    }
+    struct Segment *segment = &memory_total->table[new_id(memory_total)];
+    segment->length = length;
+    segment->words = pool_reserve(memory_total->pool, length);
 
-    /* store value onto register B */
-    uint32_t *ptr = (uint32_t *)UArray_at(temp, regB);
-    *ptr = regC;
+    /* return its words */
+    return segment->words;
+}
+
+/*  Function: seg_copy_program
+    Purpose: makes a new memory holding a copy of the segment 0 of another,
+    so one loaded program can start any number of machines
+    Parameters: A MemSeg_T to copy segment 0 from
+    Returns: an allocated MemSeg_T with only segment 0
+    Expectation: the struct must not be NULL, and segment 0 must fit the
+    default limits, as it did to be loaded
+*/
+MemSeg_T seg_copy_program(MemSeg_T memory_total)
+{
+    uint32_t length;
+    const uint32_t *words = get_segment(memory_total, 0, &length);
+
+    MemSeg_T copy = seg_new();
+    uint32_t *copy_words = seg_initial(copy, length);
+    assert(copy_words != NULL);
+    memcpy(copy_words, words, (size_t) length * sizeof(uint32_t));
+    return copy;
 }
 
 /*  Function: map_segment
     Purpose: Allocates memory of size requested by the user
     Parameters: A MemSeg_T to access memory from, size of requested memory
-    Returns: uint32_t
-    Expectation: the struct must not be NULL, length must be greater than 0
+    Returns: the ID of the new segment, or 0, which is never a new ID, if
+    it would take the program over a memory limit. Nothing is mapped then.
+    Expectation: the struct must not be NULL. Any length is valid, up to
+    2^32 - 1 words; one over a limit is refused like any other
 */
-uint32_t map_segment(MemSeg_T memory_total, int length)
+uint32_t map_segment(MemSeg_T memory_total, uint32_t length)
 {
     /* check for valid input */
-    assert(Seq_length(memory_total->heap) != 0);
-
-    /* create new UArray to map segemnt */
-    UArray_T temp = UArray_new(length, sizeof(uint32_t));
+    assert(memory_total->num_segments != 0 || memory_total->zero != NULL);
 
-    /* set each element in the Uarray to 0 */
-    for (int i = 0; i < UArray_length(temp); i++) {
-        uint32_t *ptr = UArray_at(temp, i);
-        *ptr = 0;
-    }
-
-    /* Add the UArray onto memory based on whether there is space.
-    If there are no unmapped ids add to end of sequence, otherwise,
-    add to the first index of unmapped IDs */
-    if (Seq_length(memory_total->unmapped_IDs) == 0)  {
-        Seq_addhi(memory_total->heap, temp);
-        return Seq_length(memory_total->heap) - 1;
+    /* in an arena the offset of the words is the ID. The block is taken
+    first, since the arena running out of room is a limit too */
+    uint32_t id;
+    if (memory_total->arena != NULL) {
+        id = arena_alloc(memory_total, length, 1);
+        if (id == 0) {
+            return 0;
+        }
+        if (!add_segment(memory_total, length)) {
+            arena_release(memory_total, id);
+            return 0;
+        }
+        memory_total->starts[id / 64] |= 1ull << (id % 64);
     }
     else {
-        uint32_t *index = (uint32_t *) Seq_remhi (memory_total->unmapped_IDs);
-        uint32_t ind = *index;
-        free(index);
-        Seq_put(memory_total->heap, ind, temp);
-        return ind;
+        if (!add_segment(memory_total, length)) {
+            return 0;
+        }
+
+        /* take zeroed words from the pool and give them an ID */
+        id = new_id(memory_total);
+        struct Segment *segment = &memory_total->table[id];
+        segment->words = pool_alloc(memory_total->pool, length);
+        segment->length = length;
     }
+
+    memory_total->usage.map_sizes[length == 0 ? 0
+                                  : 32 - __builtin_clz(length)]++;
+    return id;
 }
 
 /*  Function: unmap_segment
@@ -207,50 +481,337 @@ uint32_t map_segment(MemSeg_T memory_total, int length)
 */
 void unmap_segment(MemSeg_T memory_total, uint32_t id)
 {
-    /* Get segment at index and free it */
-    UArray_T temp = Seq_get(memory_total->heap, id);
-    if(temp != NULL) {
-        UArray_free(&temp);
+    /* the block of an arena ID can hold a new segment, which may get the
+    same ID, as soon as it is off the bitmap */
+    if (memory_total->arena != NULL) {
+        assert(id != 0 && seg_mapped(memory_total, id));
+        memory_total->usage.words -= memory_total->arena[id - 1];
+        memory_total->usage.segments--;
+        memory_total->starts[id / 64] &= ~(1ull << (id % 64));
+        arena_release(memory_total, id);
+        return;
+    }
+    assert(id < memory_total->num_segments);
+
+    /* give the words back to the pool, unless segment 0 still uses them */
+    struct Segment *segment = &memory_total->table[id];
+    assert(segment->words != NULL);
+    if (id == memory_total->alias) {
+        memory_total->alias = 0;
+    }
+    else {
+        pool_release(memory_total->pool, segment->words, segment->length);
     }
 
-    /* malloc space for the id to add it onto unmapped ids */
-    uint32_t *addid = malloc(sizeof(uint32_t));
-    assert(addid != NULL);
-    *addid = id;
+    memory_total->usage.words -= segment->length;
+    memory_total->usage.segments--;
 
-    /* add the id to unmapped ids and add NULL to the corresponding place
-    in Memory */
-    Seq_addhi(memory_total->unmapped_IDs, addid);
-    Seq_put(memory_total->heap, id, NULL);
+    /* clear the descriptor and push the id onto the unmapped IDs */
+    segment->words = NULL;
+    segment->length = 0;
+    memory_total->free_ids[memory_total->num_free++] = id;
 }
 
 /*  Function: get_segment
-    Purpose: gets a memory segment and returns to the client
-    Parameters: A MemSeg_T to access memory from, id of block to be returned
-    Returns: A UArray_T with memory
-    Expectation: the struct must not be NULL, id must be greater than 0
+    Purpose: gets the words of a memory segment and returns them to the
+    client
+    Parameters: A MemSeg_T to access memory from, id of block to be returned,
+    where to put the length of the segment
+    Returns: the words of the segment
+    Expectation: the struct must not be NULL, id must be mapped
 */
-UArray_T get_segment(MemSeg_T memory_total, int id)
+uint32_t *get_segment(MemSeg_T memory_total, uint32_t id, uint32_t *length)
 {
-    /* get map segment at the id passed and test for it not being NULL */
-    UArray_T temp = Seq_get(memory_total->heap, id);
-    assert(temp != NULL);
+    /* get map segment at the id passed and test for it being mapped */
+    assert(memory_total != NULL && length != NULL);
+    if (memory_total->arena != NULL) {
+        assert(seg_mapped(memory_total, id));
+        uint32_t *words = seg_arena_words(memory_total, id);
+        *length = words[-1];
+        return words;
+    }
+    assert(id < memory_total->num_segments);
+    struct Segment *segment = &memory_total->table[id];
+    assert(segment->words != NULL);
 
     /* return it the segment */
-    return temp;
+    *length = segment->length;
+    return segment->words;
+}
+
+/*  Function: arena_loadprogram
+    Purpose: replaces segment 0 of an arena memory with a copy of segment
+    id
+    Parameters: A MemSeg_T that uses an arena, id of the new program,
+    where to put the length of the new segment 0
+    Returns: the words now holding segment 0, the same as before the call
+    if id is 0, or NULL if the copy would go over a memory limit
+    Expectation: id must be mapped
+*/
+static const uint32_t *arena_loadprogram(MemSeg_T memory_total, uint32_t id,
+                                         uint32_t *length)
+{
+    uint32_t *zero = memory_total->zero;
+    const uint32_t *words = get_segment(memory_total, id, length);
+
+    if (id != 0) {
+        /* the old segment 0 is only given up once the copy has room */
+        uint32_t copy = arena_alloc(memory_total, *length, 0);
+        if (copy == 0) {
+            return NULL;
+        }
+        memory_total->usage.words -= zero[-1];
+        if (!add_words(memory_total, *length)) {
+            memory_total->usage.words += zero[-1];
+            arena_release(memory_total, copy);
+            return NULL;
+        }
+
+        memcpy(memory_total->arena + copy, words,
+               (size_t) *length * sizeof(uint32_t));
+        arena_release(memory_total, zero - memory_total->arena);
+        memory_total->zero = memory_total->arena + copy;
+        memory_total->copies_made++;
+        memory_total->words_copied += *length;
+    }
+
+    return memory_total->zero;
+}
+
+/*  Function: seg_loadprogram
+    Purpose: makes segment id the new segment 0 without copying it. Both
+    IDs share one set of words until either of them is written to. An
+    arena memory copies the segment instead, since the words of an arena ID
+    cannot move away from it.
+    Parameters: A MemSeg_T to access memory from, id of the new program,
+    where to put the length of the new segment 0
+    Returns: the words now holding segment 0. They are the same words as
+    before the call if segment id was already shared with segment 0. NULL
+    if the new segment 0 would take the program over a memory limit, in
+    which case segment 0 is unchanged.
+    Expectation: the struct must not be NULL, id must be mapped
+*/
+const uint32_t *seg_loadprogram(MemSeg_T memory_total, uint32_t id,
+                                uint32_t *length)
+{
+    assert(memory_total != NULL);
+
+    if (memory_total->arena != NULL) {
+        return arena_loadprogram(memory_total, id, length);
+    }
+
+    struct Segment *seg_0 = &memory_total->table[0];
+    uint32_t *words = get_segment(memory_total, id, length);
+
+    if (id != 0 && id != memory_total->alias) {
+        /* the program now holds the new segment 0 as well as the segment
+        it was loaded from */
+        memory_total->usage.words -= seg_0->length;
+        if (!add_words(memory_total, *length)) {
+            memory_total->usage.words += seg_0->length;
+            return NULL;
+        }
+
+        /* the old segment 0 is only released if no other segment shares
+        it */
+        if (memory_total->alias == 0) {
+            pool_release(memory_total->pool, seg_0->words, seg_0->length);
+        }
+        seg_0->words = words;
+        seg_0->length = *length;
+        memory_total->alias = id;
+    }
+    if (id != 0) {
+        memory_total->copies_avoided++;
+        memory_total->words_shared += *length;
+    }
+
+    return words;
+}
+
+/*  Function: seg_unshare
+    Purpose: ends the sharing between segment 0 and its alias by giving the
+    alias its own copy. Segment 0 keeps the original words, so pointers
+    into segment 0 held by the engines stay valid.
+    Parameters: A MemSeg_T to access memory from
+    Returns: N/A
+    Expectation: the struct must not be NULL, segment 0 must be shared
+*/
+void seg_unshare(MemSeg_T memory_total)
+{
+    assert(memory_total != NULL);
+    assert(memory_total->alias != 0);
+
+    struct Segment *shared = &memory_total->table[0];
+    memory_total->table[memory_total->alias].words =
+            pool_copy(memory_total->pool, shared->words, shared->length);
+    memory_total->alias = 0;
+    memory_total->copies_made++;
+    memory_total->words_copied += shared->length;
+}
+
+/*  Function: seg_restore_table
+    Purpose: sets up the segment table of a machine being restored from a
+    snapshot. Every ID starts out unmapped until seg_restore_segment
+    gives it words; the unmapped IDs are handed out in the order given.
+    Parameters: A MemSeg_T with no segments, the number of IDs, the stack
+    of unmapped IDs and its depth
+    Returns: N/A
+    Expectation: every ID in free_ids is below num_segments, and the
+    memory uses the table
+*/
+void seg_restore_table(MemSeg_T memory_total, uint32_t num_segments,
+                       const uint32_t *free_ids, uint32_t num_free)
+{
+    assert(memory_total != NULL && memory_total->arena == NULL);
+    assert(memory_total->num_segments == 0);
+    assert(num_free <= num_segments);
+
+    while (memory_total->capacity < num_segments) {
+        memory_total->capacity *= 2;
+    }
+    memory_total->table = realloc(memory_total->table,
+                    memory_total->capacity * sizeof(struct Segment));
+    memory_total->free_ids = realloc(memory_total->free_ids,
+                    memory_total->capacity * sizeof(uint32_t));
+    assert(memory_total->table != NULL);
+    assert(memory_total->free_ids != NULL);
+
+    for (uint32_t id = 0; id < num_segments; id++) {
+        memory_total->table[id].words = NULL;
+        memory_total->table[id].length = 0;
+    }
+    for (uint32_t i = 0; i < num_free; i++) {
+        assert(free_ids[i] < num_segments);
+        memory_total->free_ids[i] = free_ids[i];
+    }
+    memory_total->num_segments = num_segments;
+    memory_total->num_free = num_free;
+}
+
+/*  Function: seg_restore_segment
+    Purpose: gives an ID of a machine being restored its words
+    Parameters: A MemSeg_T set up by seg_restore_table, the ID, the length
+    of the segment
+    Returns: the words of the segment, not yet initialized, or NULL if the
+    machine is over a memory limit
+    Expectation: the ID has no words yet
+*/
+uint32_t *seg_restore_segment(MemSeg_T memory_total, uint32_t id,
+                              uint32_t length)
+{
+    assert(memory_total != NULL);
+    assert(id < memory_total->num_segments);
+
+    struct Segment *segment = &memory_total->table[id];
+    assert(segment->words == NULL);
+    if (!add_segment(memory_total, length)) {
+        return NULL;
+    }
+    segment->words = pool_reserve(memory_total->pool, length);
+    segment->length = length;
+
+    return segment->words;
+}
+
+/*  Function: seg_id_limit
+    Purpose: gives a bound on the mapped IDs of a memory, for a caller that
+    looks at every one of them with seg_mapped
+    Parameters: A MemSeg_T
+    Returns: a number greater than every mapped ID
+    Expectation: the struct must not be NULL
+*/
+uint32_t seg_id_limit(MemSeg_T memory_total)
+{
+    assert(memory_total != NULL);
+
+    return memory_total->arena != NULL ? memory_total->top
+                                       : memory_total->num_segments;
+}
+
+/*  Function: seg_set_report
+    Purpose: asks seg_free to print the statistics of every memory it frees
+    Parameters: the stream to print to, or NULL to stop reporting
+    Returns: N/A
+*/
+void seg_set_report(FILE *out)
+{
+    report = out;
 }
 
-/*  Function: set_seg_0
-    Purpose: sets segment 0 and replaces the old set of codewords
-    Parameters: A MemSeg_T to access memory from, id of block to be returned
+/*  Function: seg_set_default_arena
+    Purpose: sets whether every memory created afterwards keeps its
+    segments in an arena rather than the table
+    Parameters: 1 for an arena, 0 for the table
     Returns: N/A
-    Expectation: the struct & UArrray must not be NULL
 */
-void set_seg_0(MemSeg_T memory_total, UArray_T segment)
+void seg_set_default_arena(int arena)
 {
-    assert (memory_total != NULL);
+    default_arena = arena;
+}
+
+/*  Function: seg_set_default_limits
+    Purpose: sets the limits every memory created afterwards starts with
+    Parameters: the limits
+    Returns: N/A
+*/
+void seg_set_default_limits(struct Seg_limits limits)
+{
+    default_limits = limits;
+}
+
+/*  Function: seg_set_limits
+    Purpose: sets the limits of one memory. What it already holds is not
+    checked against them; the next segment mapped is
+    Parameters: A MemSeg_T, the limits
+    Returns: N/A
+    Expectation: the struct must not be NULL
+*/
+void seg_set_limits(MemSeg_T memory_total, struct Seg_limits limits)
+{
+    assert(memory_total != NULL);
 
-    UArray_T seg_0 = (UArray_T)Seq_get(memory_total->heap, 0);
-    UArray_free(&seg_0);
-    Seq_put(memory_total->heap, 0, segment);
-}
\ No newline at end of file
+    memory_total->limits = limits;
+}
+
+/*  Function: seg_print_stats
+    Purpose: prints the usage, copy-on-write counters and pool statistics
+    of a memory
+    Parameters: A MemSeg_T to read the counters from, the stream to print to
+    Returns: N/A
+    Expectation: the struct and stream must not be NULL
+*/
+void seg_print_stats(MemSeg_T memory_total, FILE *out)
+{
+    assert(memory_total != NULL);
+    assert(out != NULL);
+
+    const struct Seg_usage *usage = &memory_total->usage;
+    fprintf(out, "peak words mapped:          %llu\n",
+            (unsigned long long) usage->peak_words);
+    fprintf(out, "peak segments mapped:       %u\n", usage->peak_segments);
+    fprintf(out, "longest segment:            %u words\n", usage->longest);
+    fprintf(out, "maps by size (words):      ");
+    for (int i = 0; i < SEG_SIZE_BUCKETS; i++) {
+        if (usage->map_sizes[i] != 0) {
+            fprintf(out, " <%llu:%llu", 1ull << i,
+                    (unsigned long long) usage->map_sizes[i]);
+        }
+    }
+    fprintf(out, "\n");
+    fprintf(out, "loadprogram copies avoided: %lu (%lu words)\n",
+            (unsigned long) memory_total->copies_avoided,
+            (unsigned long) memory_total->words_shared);
+    fprintf(out, "loadprogram copies made:    %lu (%lu words)\n",
+            (unsigned long) memory_total->copies_made,
+            (unsigned long) memory_total->words_copied);
+    if (memory_total->arena == NULL) {
+        pool_print_stats(memory_total->pool, out);
+        return;
+    }
+    fprintf(out, "arena words used:           %u\n", memory_total->top);
+    fprintf(out, "arena words accessible:     %u\n",
+            memory_total->committed);
+    fprintf(out, "arena words returned:       %llu\n",
+            (unsigned long long) memory_total->words_returned);
+}
@@ -9,7 +9,15 @@
  *
  *     Purpose: Used to access, map, unmap memory segments through
  * 				the program, and the functions in this file are
- * 				called by the execute_op file
+ * 				called by the execute_op file. Every memory keeps
+ * 				count of the words and segments it holds, and
+ * 				refuses a map or loadprogram that would take it
+ * 				over its limits, so the engine can stop the
+ * 				program.
+ * 				A memory keeps its segments either in a table of
+ * 				descriptors indexed by ID (the default) or in one
+ * 				arena, where an ID is the offset of the segment's
+ * 				words and needs no table to be found.
  *
  *     Success Output:
  *              Memory is successfully allocated and deallocated
@@ -19,7 +27,9 @@
  *     Failure output:
  *              A Hanson checked runtime exception is raised if
  *              there is a problem with accessing any memory
- * 				segment
+ * 				segment. A program that goes over a memory limit
+ * 				is reported to stderr and its engine stops with
+ * 				RUN_LIMIT, which um exits with.
  *
  **************************************************************/
 
@@ -28,25 +38,263 @@
 #include <assert.h>
 #include <bitpack.h>
 #include <stdint.h>
-#include "execute_op.h"
-#include "seq.h"
-#include "uarray.h"
+#include "pool.h"
 
 #ifndef SEG_MEM_H
 #define SEG_MEM_H
 
 typedef struct MemSeg_T *MemSeg_T;
 
+/* the exit status of um when a program went over a memory limit, which is
+   also the run_status of an engine stopped by one */
+#define SEG_LIMIT_EXCEEDED 6
+
+/* buckets of the histogram of map sizes: bucket 0 counts empty segments
+   and bucket n those of 2^(n-1) to 2^n - 1 words */
+#define SEG_SIZE_BUCKETS 33
+
+/* this struct holds three variables
+    1. The most words all mapped segments may hold together
+    2. The most words any one segment may hold
+    3. The most segments that may be mapped at once, segment 0 included
+   A limit of UINT64_MAX or UINT32_MAX is no limit at all */
+struct Seg_limits
+{
+    uint64_t words;
+    uint32_t length;
+    uint32_t segments;
+};
+
+/* this struct holds six variables
+    1. The words held by all mapped segments, as the program sees them,
+       so a segment shared with segment 0 counts twice
+    2. The most words they ever held at once
+    3. The number of mapped segments, segment 0 included
+    4. The most segments ever mapped at once
+    5. The length of the longest segment ever mapped
+    6. How many segments of each SEG_SIZE_BUCKETS size were mapped
+*/
+struct Seg_usage
+{
+    uint64_t words;
+    uint64_t peak_words;
+    uint32_t segments;
+    uint32_t peak_segments;
+    uint32_t longest;
+    uint64_t map_sizes[SEG_SIZE_BUCKETS];
+};
+
+/* size classes of the blocks of an arena: 2, 3, 4, 6, 8, 12, ... words,
+   up to 2^32 */
+#define SEG_ARENA_CLASSES 63
+
+/* one entry of the segment table: the words of the segment, which come
+   from the pool, and how many there are. An unmapped ID has NULL words
+   and a length of 0 */
+struct Segment
+{
+    uint32_t *words;
+    uint32_t length;
+};
+
+/* this struct holds twenty-one variables
+    1. A growable table of segment descriptors indexed by segment ID
+    2. The number of IDs handed out so far (the used part of the table)
+    3. The number of descriptors the table has room for
+    4. A stack of unmapped IDs to be reused, with room for capacity IDs so
+       pushing never allocates
+    5. The number of IDs on that stack
+    6. The ID of the segment that shares its words with segment 0 after a
+       loadprogram, or 0 if segment 0 is not shared
+    7. The number of loadprogram copies avoided by sharing, and the words
+       they would have copied
+    8. The number of copies made when a shared segment was written to, and
+       the words they copied
+    9. The pool every segment's words come from
+    10. The arena, or NULL if the memory uses the table. Every block in
+        it is the number of its size class, the length of its segment
+        (the next free block while it is free), then the words, and the
+        ID of a segment is the offset of its words
+    11. The words of segment 0, which has no ID of its own in the arena
+    12. A bitmap of the arena offsets that are mapped IDs
+    13. The words of the arena handed out so far, headers included
+    14. The words of the arena that can be touched, the rest being
+        reserved address space only
+    15. One list of free blocks per size class, linked through their
+        length words and ended by 0
+    16. The words given back to the system when huge blocks were freed
+    17. What the segments hold, and the limits on it
+    18. Whether the program has been refused for going over a limit, so
+        that it is reported once even if the engine asks again
+
+   The table, the stack of unmapped IDs, the alias and the pool are unused
+   by an arena memory. The fields the JIT reads come first, within a one
+   byte displacement of the start.
+
+   It is defined here, rather than in seg_mem.c, so that segment_load and
+   segment_store can be inlined into the engines.
+*/
+struct MemSeg_T
+{
+    struct Segment *table;
+    uint32_t num_segments;
+    uint32_t capacity;
+    uint32_t *free_ids;
+    uint32_t num_free;
+    uint32_t alias;
+    uint64_t copies_avoided;
+    uint64_t words_shared;
+    uint64_t copies_made;
+    uint64_t words_copied;
+    Pool_T pool;
+    uint32_t *arena;
+    uint32_t *zero;
+    uint64_t *starts;
+    uint32_t top;
+    uint32_t committed;
+    uint32_t free_blocks[SEG_ARENA_CLASSES];
+    uint64_t words_returned;
+    struct Seg_usage usage;
+    struct Seg_limits limits;
+    int exceeded;
+};
+
 MemSeg_T seg_new();
 void seg_free(MemSeg_T memory_total);
-MemSeg_T seg_initial(MemSeg_T memory_total, UArray_T codewords);
-uint32_t segment_load(MemSeg_T memory_total, uint32_t regB, uint32_t regC);
-void segment_store(MemSeg_T memory_total, uint32_t regA, uint32_t regB,
-                      uint32_t regC);
-uint32_t map_segment(MemSeg_T memory_total, int length);
+uint32_t *seg_initial(MemSeg_T memory_total, uint32_t length);
+MemSeg_T seg_copy_program(MemSeg_T memory_total);
+uint32_t map_segment(MemSeg_T memory_total, uint32_t length);
 void unmap_segment(MemSeg_T memory_total, uint32_t id);
-UArray_T get_segment(MemSeg_T memory_total, int id);
-void set_seg_0(MemSeg_T memory_total, UArray_T segment);
+uint32_t *get_segment(MemSeg_T memory_total, uint32_t id, uint32_t *length);
+const uint32_t *seg_loadprogram(MemSeg_T memory_total, uint32_t id,
+                                uint32_t *length);
+void seg_unshare(MemSeg_T memory_total);
+void seg_restore_table(MemSeg_T memory_total, uint32_t num_segments,
+                       const uint32_t *free_ids, uint32_t num_free);
+uint32_t *seg_restore_segment(MemSeg_T memory_total, uint32_t id,
+                              uint32_t length);
+uint32_t seg_id_limit(MemSeg_T memory_total);
+void seg_set_report(FILE *out);
+void seg_set_default_arena(int arena);
+void seg_set_default_limits(struct Seg_limits limits);
+void seg_set_limits(MemSeg_T memory_total, struct Seg_limits limits);
+void seg_print_stats(MemSeg_T memory_total, FILE *out);
+
+/*  Function: seg_arena_words
+    Purpose: finds the words of a segment of an arena memory with a single
+    addition, or segment 0 wherever it was last loaded
+    Parameters: A MemSeg_T that uses an arena, the segment ID
+    Returns: the words, preceded by their length
+    Expectation: id is mapped
+*/
+static inline uint32_t *seg_arena_words(MemSeg_T memory_total, uint32_t id)
+{
+    return id == 0 ? memory_total->zero : memory_total->arena + id;
+}
+
+/*  Function: seg_mapped
+    Purpose: says whether a segment ID is mapped
+    Parameters: A MemSeg_T to access memory from, the segment ID
+    Returns: 1 if it is mapped, otherwise 0
+    Expectation: the struct must not be NULL
+*/
+static inline int seg_mapped(MemSeg_T memory_total, uint32_t id)
+{
+    assert(memory_total != NULL);
+
+    if (memory_total->arena != NULL) {
+        return id == 0 ||
+               (id < memory_total->top &&
+                (memory_total->starts[id / 64] >> (id % 64) & 1) != 0);
+    }
+    return id < memory_total->num_segments &&
+           memory_total->table[id].words != NULL;
+}
+
+/*  Function: seg_length
+    Purpose: gives the length of a segment
+    Parameters: A MemSeg_T to access memory from, the segment ID
+    Returns: the number of words in the segment, 0 if it is not mapped
+    Expectation: the struct must not be NULL and id must have been mapped
+*/
+static inline uint32_t seg_length(MemSeg_T memory_total, uint32_t id)
+{
+    assert(memory_total != NULL);
+
+    if (memory_total->arena != NULL) {
+        return seg_mapped(memory_total, id)
+               ? seg_arena_words(memory_total, id)[-1] : 0;
+    }
+    assert(id < memory_total->num_segments);
+
+    return memory_total->table[id].length;
+}
+
+/*  Function: segment_load
+    Purpose: Value of at m[regB][regC] is extracted and returned
+    Parameters: A MemSeg_T to access memory from, two registers
+    Returns: the word stored at m[regB][regC]
+    Expectation: the struct must not be NULL, regB must be mapped and
+    regC must be in bounds
+*/
+static inline uint32_t segment_load(MemSeg_T memory_total, uint32_t regB,
+                                    uint32_t regC)
+{
+    /* check for valid input */
+    assert(memory_total != NULL);
+
+    /* an arena memory has no IDs in the table, so the bounds check the
+    table needs anyway is all it takes to tell the two apart */
+    if (regB < memory_total->num_segments) {
+        struct Segment *segment = &memory_total->table[regB];
+        assert(regC < segment->length);
+
+        return segment->words[regC];
+    }
+
+    assert(memory_total->arena != NULL && regB < memory_total->top);
+    const uint32_t *words = seg_arena_words(memory_total, regB);
+    assert(regC < words[-1]);
+
+    return words[regC];
+}
+
+/*  Function: segment_store
+    Purpose: Stores the value of register C into memory location m[regA][regB]
+    Parameters: A MemSeg_T to access memory from, three registers
+    Returns: N/A
+    Expectation: the struct must not be NULL, regA must be mapped and
+    regB must be in bounds
+*/
+static inline void segment_store(MemSeg_T memory_total, uint32_t regA,
+                                 uint32_t regB, uint32_t regC)
+{
+    /* check for valid input */
+    assert(memory_total != NULL);
+
+    /* as in segment_load, an ID outside the table is in the arena, which
+    never shares segment 0 */
+    if (regA < memory_total->num_segments) {
+        /* writing to either side of a shared segment gives the other
+        segment its own copy first */
+        if (memory_total->alias != 0 &&
+            (regA == 0 || regA == memory_total->alias)) {
+            seg_unshare(memory_total);
+        }
+
+        struct Segment *segment = &memory_total->table[regA];
+        assert(regB < segment->length);
+
+        segment->words[regB] = regC;
+        return;
+    }
+
+    assert(memory_total->arena != NULL && regA < memory_total->top);
+    uint32_t *words = seg_arena_words(memory_total, regA);
+    assert(regB < words[-1]);
+
+    words[regB] = regC;
+}
 
 #endif
 /* SEG_MEM_H */
\ No newline at end of file
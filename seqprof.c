@@ -0,0 +1,218 @@
+/**************************************************************
+ *                       seqprof.c
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Implementation for our seqprof.h
+ *
+ *     Purpose: Counts the pairs and triples of opcodes that are
+ * 				executed back to back from consecutive words of
+ * 				segment 0, and prints the most frequent ones.
+ * 				A sequence is only counted if no jump lands in
+ * 				its middle, since only those can be fused.
+ *
+ *     Success Output:
+ *              A table of the most frequent pairs and triples
+ *
+ *     Failure output:
+ *              A Hanson checked runtime exception is raised if
+ *              memory for the counters cannot be allocated
+ *
+ **************************************************************/
+
+#include <stdlib.h>
+#include <assert.h>
+#include "seqprof.h"
+#include "decode.h"
+
+/* the opcodes that are counted; invalid and END records end a sequence */
+#define NUM_OPS OP_INVALID
+
+/* how many pairs and how many triples are printed */
+static const int TOP = 12;
+
+/* this struct holds six variables
+    1. The number of instructions counted
+    2. How often every pair and every triple of opcodes ran in sequence
+    3. The pc of the previous instruction and the two opcodes before this
+       one, and how many of them are part of the current sequence
+*/
+struct Seqprof_T {
+    uint64_t total;
+    uint64_t pairs[NUM_OPS][NUM_OPS];
+    uint64_t triples[NUM_OPS][NUM_OPS][NUM_OPS];
+    uint32_t last_pc;
+    unsigned prev[2];
+    int run;
+};
+
+/* where the profile is printed, or NULL if sequences are not counted */
+static FILE *output = NULL;
+
+/* one line of the printed table */
+struct Entry {
+    uint64_t count;
+    unsigned ops[3];
+};
+
+/*  Function: seqprof_set_output
+    Purpose: makes the profiling engine count sequences and print them
+    Parameters: where to print them, or NULL to stop counting
+    Returns: N/A
+*/
+void seqprof_set_output(FILE *out)
+{
+    output = out;
+}
+
+/*  Function: seqprof_output
+    Purpose: says where sequences are printed
+    Parameters: none
+    Returns: the stream set by seqprof_set_output, or NULL
+*/
+FILE *seqprof_output()
+{
+    return output;
+}
+
+/*  Function: seqprof_new
+    Purpose: creates a profiler with every counter at zero
+    Parameters: none
+    Returns: an allocated Seqprof_T
+    Expectation: none
+*/
+Seqprof_T seqprof_new()
+{
+    Seqprof_T prof = calloc(1, sizeof(struct Seqprof_T));
+    assert(prof != NULL);
+    return prof;
+}
+
+/*  Function: seqprof_free
+    Purpose: frees a profiler and sets the pointer to NULL
+    Parameters: a pointer to the profiler
+    Returns: N/A
+    Expectation: the profiler must not be NULL
+*/
+void seqprof_free(Seqprof_T *prof)
+{
+    assert(prof != NULL && *prof != NULL);
+    free(*prof);
+    *prof = NULL;
+}
+
+/*  Function: seqprof_count
+    Purpose: counts one executed instruction, along with the pair and
+    triple it ends if the instructions before it ran from the words just
+    before it
+    Parameters: the profiler, the pc of the instruction, its opcode
+    Returns: N/A
+*/
+void seqprof_count(Seqprof_T prof, uint32_t pc, unsigned op)
+{
+    assert(prof != NULL);
+
+    if (op >= NUM_OPS) {
+        prof->run = 0;
+        return;
+    }
+    prof->total++;
+
+    if (prof->run > 0 && pc == prof->last_pc + 1) {
+        prof->pairs[prof->prev[1]][op]++;
+        if (prof->run > 1) {
+            prof->triples[prof->prev[0]][prof->prev[1]][op]++;
+        }
+        prof->run++;
+    }
+    else {
+        prof->run = 1;
+    }
+
+    prof->prev[0] = prof->prev[1];
+    prof->prev[1] = op;
+    prof->last_pc = pc;
+}
+
+/*  Function: by_count
+    Purpose: qsort comparison putting the most frequent entries first
+*/
+static int by_count(const void *x, const void *y)
+{
+    const struct Entry *a = x;
+    const struct Entry *b = y;
+    return (a->count < b->count) - (a->count > b->count);
+}
+
+/*  Function: print_top
+    Purpose: sorts a set of sequences and prints the most frequent
+    Parameters: the output, the title, the sequences, how many there are,
+    how long each is, and the number of instructions counted
+    Returns: N/A
+*/
+static void print_top(FILE *out, const char *title, struct Entry *entries,
+                      int count, int length, uint64_t total)
+{
+    qsort(entries, count, sizeof(struct Entry), by_count);
+
+    fprintf(out, "%s:\n", title);
+    for (int i = 0; i < TOP && i < count && entries[i].count > 0; i++) {
+        fprintf(out, "  %6.2f%% %14llu ",
+                100.0 * entries[i].count / (total ? total : 1),
+                (unsigned long long) entries[i].count);
+        for (int k = 0; k < length; k++) {
+            fprintf(out, " %-6s", decode_op_name(entries[i].ops[k]));
+        }
+        if (decode_fusable(entries[i].ops, length)) {
+            fprintf(out, " (fused)");
+        }
+        fprintf(out, "\n");
+    }
+}
+
+/*  Function: seqprof_print
+    Purpose: prints the most frequent pairs and triples, each with its
+    share of all instructions, marking the ones decode.c fuses
+    Parameters: the profiler, the output
+    Returns: N/A
+*/
+void seqprof_print(Seqprof_T prof, FILE *out)
+{
+    assert(prof != NULL && out != NULL);
+
+    struct Entry *entries = malloc(NUM_OPS * NUM_OPS * NUM_OPS *
+                                   sizeof(struct Entry));
+    assert(entries != NULL);
+
+    fprintf(out, "instruction sequences: %llu instructions\n",
+            (unsigned long long) prof->total);
+
+    int n = 0;
+    for (unsigned a = 0; a < NUM_OPS; a++) {
+        for (unsigned b = 0; b < NUM_OPS; b++) {
+            entries[n].count = prof->pairs[a][b];
+            entries[n].ops[0] = a;
+            entries[n].ops[1] = b;
+            n++;
+        }
+    }
+    print_top(out, "pairs", entries, n, 2, prof->total);
+
+    n = 0;
+    for (unsigned a = 0; a < NUM_OPS; a++) {
+        for (unsigned b = 0; b < NUM_OPS; b++) {
+            for (unsigned c = 0; c < NUM_OPS; c++) {
+                entries[n].count = prof->triples[a][b][c];
+                entries[n].ops[0] = a;
+                entries[n].ops[1] = b;
+                entries[n].ops[2] = c;
+                n++;
+            }
+        }
+    }
+    print_top(out, "triples", entries, n, 3, prof->total);
+
+    free(entries);
+}
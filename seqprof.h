@@ -0,0 +1,43 @@
+/**************************************************************
+ *                       seqprof.h
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Interface for our instruction sequence profiler
+ *
+ *     Purpose: Counts the pairs and triples of opcodes that are
+ * 				executed back to back from consecutive words of
+ * 				segment 0, and prints the most frequent ones.
+ * 				These are the candidates for the fused handlers
+ * 				in decode.h, which can be tuned against
+ * 				midmark.um, sandmark.umz and codex.umz with
+ * 				./um -f program.um
+ *
+ *     Success Output:
+ *              A table of the most frequent pairs and triples
+ *
+ *     Failure output:
+ *              A Hanson checked runtime exception is raised if
+ *              memory for the counters cannot be allocated
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+
+#ifndef SEQPROF_H
+#define SEQPROF_H
+
+typedef struct Seqprof_T *Seqprof_T;
+
+void seqprof_set_output(FILE *out);
+FILE *seqprof_output();
+Seqprof_T seqprof_new();
+void seqprof_free(Seqprof_T *prof);
+void seqprof_count(Seqprof_T prof, uint32_t pc, unsigned op);
+void seqprof_print(Seqprof_T prof, FILE *out);
+
+#endif
+/* SEQPROF_H */
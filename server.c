@@ -0,0 +1,593 @@
+/**************************************************************
+ *                        server.c
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Implementation for our server.h
+ *
+ *     Purpose: One epoll loop watches the listening socket and
+ * 				every connection, level triggered. Each session
+ * 				is a copy of segment 0, a memory console and a
+ * 				threaded engine, run SLICE instructions at a time
+ * 				from a queue of runnable sessions. A session
+ * 				leaves the queue when its machine waits for
+ * 				input or has OUTPUT_HIGH bytes its client has not
+ * 				taken, and comes back when epoll says the
+ * 				connection is readable or writable. Output is
+ * 				sent straight from the console's buffer, and a
+ * 				connection is not read while its machine has
+ * 				INPUT_HIGH bytes of input it has not taken.
+ *
+ *     Success Output:
+ *              Every client gets the output of its own machine.
+ *              A line per session and a summary are printed to
+ *              stderr.
+ *
+ *     Failure output:
+ *              An error message is printed and the program exits
+ *              if the socket cannot be made
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/resource.h>
+#include "server.h"
+#include "threaded.h"
+#include "console.h"
+
+/* instructions a machine runs before the next runnable one gets a turn */
+#define SLICE (1u << 20)
+
+/* bytes of output a machine may have waiting for its client before it is
+   parked */
+#define OUTPUT_HIGH (1u << 20)
+
+/* bytes of input a machine may have waiting for it before its client is
+   no longer read from */
+#define INPUT_HIGH (1u << 20)
+
+/* bytes read from a client at a time */
+#define READ_SIZE 4096
+
+/* events taken from epoll at a time */
+#define MAX_EVENTS 64
+
+/* where a session is: in the run queue, parked until its client sends
+   input, parked until its client takes output, or finished and sending
+   the last of its output */
+enum state { RUNNABLE, WAITING, BLOCKED, FINISHED };
+
+/* this struct holds fifteen variables
+    1. The connection, and the number the session is reported by
+    2. The machine: its memory, console and engine
+    3. How many instructions it has run, and how its run ended
+    4. Its enum state
+    5. Whether the client's input has ended, whether the connection is
+       not read because the machine has INPUT_HIGH bytes of input waiting,
+       and whether it is watched for room to write
+    6. The next session in the run queue, and whether it is in the queue
+    7. The sessions before and after it in the list of all sessions
+*/
+struct Session {
+    int fd;
+    uint64_t number;
+    MemSeg_T memory;
+    Console_T console;
+    Threaded_T machine;
+    uint64_t instructions;
+    int status;
+    enum state state;
+    int input_ended;
+    int full;
+    int writing;
+    struct Session *run_next;
+    int queued;
+    struct Session *prev;
+    struct Session *next;
+};
+
+/* this struct holds nine variables
+    1. The listening socket and the epoll instance
+    2. The program every session starts from
+    3. The run queue, first and last
+    4. Every open session
+    5. How many sessions were opened, how many are open, and the most
+       that were open at once
+*/
+static struct {
+    int listener;
+    int epoll;
+    MemSeg_T program;
+    struct Session *head;
+    struct Session *tail;
+    struct Session *all;
+    uint64_t opened;
+    uint64_t open;
+    uint64_t peak_open;
+} server;
+
+/* set by SIGINT and SIGTERM to stop the server */
+static volatile sig_atomic_t stopping = 0;
+
+/*  Function: fail
+    Purpose: prints why the server could not run and exits
+    Parameters: what went wrong
+    Returns: N/A
+*/
+static void fail(const char *reason)
+{
+    fprintf(stderr, "um: server: %s\n", reason);
+    exit(EXIT_FAILURE);
+}
+
+/*  Function: stop
+    Purpose: asks the event loop to stop, from a signal handler
+    Parameters: the signal
+    Returns: N/A
+*/
+static void stop(int signum)
+{
+    (void) signum;
+    stopping = 1;
+}
+
+/*  Function: listen_on
+    Purpose: makes the listening socket, replacing a stale socket left at
+    the path by an earlier server but no other kind of file
+    Parameters: the path of the socket
+    Returns: the socket, non-blocking
+*/
+static int listen_on(const char *path)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fail("the socket path is too long");
+    }
+    strcpy(address.sun_path, path);
+
+    struct stat stats;
+    if (lstat(path, &stats) == 0 && S_ISSOCK(stats.st_mode)) {
+        unlink(path);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0 ||
+        bind(fd, (struct sockaddr *) &address, sizeof(address)) != 0 ||
+        listen(fd, SOMAXCONN) != 0) {
+        fail(strerror(errno));
+    }
+    return fd;
+}
+
+/*  Function: enqueue
+    Purpose: puts a session at the back of the run queue
+    Parameters: the session
+    Returns: N/A
+*/
+static void enqueue(struct Session *session)
+{
+    session->state = RUNNABLE;
+    if (session->queued) {
+        return;
+    }
+    session->queued = 1;
+    session->run_next = NULL;
+    if (server.tail != NULL) {
+        server.tail->run_next = session;
+    }
+    else {
+        server.head = session;
+    }
+    server.tail = session;
+}
+
+/*  Function: dequeue
+    Purpose: takes the session at the front of the run queue
+    Parameters: none
+    Returns: the session, or NULL if the queue is empty
+*/
+static struct Session *dequeue()
+{
+    struct Session *session = server.head;
+    if (session != NULL) {
+        server.head = session->run_next;
+        if (server.head == NULL) {
+            server.tail = NULL;
+        }
+        session->queued = 0;
+    }
+    return session;
+}
+
+/*  Function: watch
+    Purpose: sets what epoll watches a connection for: input until the
+    client has ended it, unless the machine has too much of it waiting,
+    and room to write while output is waiting
+    Parameters: the session
+    Returns: N/A
+*/
+static void watch(struct Session *session)
+{
+    struct epoll_event event;
+    event.events = (session->input_ended || session->full ? 0 : EPOLLIN) |
+                   (session->writing ? EPOLLOUT : 0);
+    event.data.ptr = session;
+    epoll_ctl(server.epoll, EPOLL_CTL_MOD, session->fd, &event);
+}
+
+/*  Function: pending
+    Purpose: says how much output a session has that its client has not
+    taken
+    Parameters: the session
+    Returns: the number of bytes
+*/
+static size_t pending(struct Session *session)
+{
+    size_t count;
+    console_pending(session->console, &count);
+    return count;
+}
+
+/*  Function: unread
+    Purpose: says how much input a session's machine has not taken
+    Parameters: the session
+    Returns: the number of bytes
+*/
+static size_t unread(struct Session *session)
+{
+    return session->console->in_len - session->console->in_pos;
+}
+
+/*  Function: close_session
+    Purpose: reports a session and frees it, closing its connection.
+    Output its client has not taken is lost.
+    Parameters: the session, why it ended
+    Returns: N/A
+    Expectation: the session is not in the run queue
+*/
+static void close_session(struct Session *session, const char *why)
+{
+    fprintf(stderr, "um: session %llu %s after %llu instructions, peak "
+            "%llu words in %u segments\n",
+            (unsigned long long) session->number, why,
+            (unsigned long long) session->instructions,
+            (unsigned long long) session->memory->usage.peak_words,
+            session->memory->usage.peak_segments);
+
+    if (session->prev != NULL) {
+        session->prev->next = session->next;
+    }
+    else {
+        server.all = session->next;
+    }
+    if (session->next != NULL) {
+        session->next->prev = session->prev;
+    }
+    server.open--;
+
+    /* closing the descriptor takes it out of the epoll set; the engine
+       frees the memory */
+    close(session->fd);
+    threaded_free(&session->machine);
+    console_free(&session->console);
+    free(session);
+}
+
+/*  Function: end_reason
+    Purpose: names how a finished session's machine stopped
+    Parameters: the session
+    Returns: the name
+*/
+static const char *end_reason(struct Session *session)
+{
+    return session->status == RUN_HALTED   ? "halted"
+         : session->status == RUN_FELL_OFF ? "ran off the end"
+                                           : "went over a memory limit";
+}
+
+/*  Function: send_output
+    Purpose: sends as much of a session's output as its client will take
+    without blocking, and watches for room to send the rest
+    Parameters: the session
+    Returns: 0, or -1 if the client has gone
+*/
+static int send_output(struct Session *session)
+{
+    size_t count, sent = 0;
+    const unsigned char *bytes = console_pending(session->console, &count);
+
+    while (sent < count) {
+        ssize_t put = send(session->fd, bytes + sent, count - sent,
+                           MSG_NOSIGNAL);
+        if (put < 0 && errno == EINTR) {
+            continue;
+        }
+        if (put < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (put < 0) {
+            return -1;
+        }
+        sent += put;
+    }
+    console_consume(session->console, sent);
+
+    int writing = sent < count;
+    if (writing != session->writing) {
+        session->writing = writing;
+        watch(session);
+    }
+    return 0;
+}
+
+/*  Function: receive_input
+    Purpose: feeds a session's machine what its client has sent, until
+    it has INPUT_HIGH bytes waiting, and ends its input once the client
+    has closed its side
+    Parameters: the session
+    Returns: 0, or -1 if the connection failed
+*/
+static int receive_input(struct Session *session)
+{
+    unsigned char buffer[READ_SIZE];
+
+    while (!session->input_ended && !session->full) {
+        ssize_t got = recv(session->fd, buffer, sizeof(buffer), 0);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (got < 0) {
+            return -1;
+        }
+        if (got == 0) {
+            console_end_input(session->console);
+            session->input_ended = 1;
+            watch(session);
+            break;
+        }
+        console_feed(session->console, buffer, got);
+
+        /* the rest stays in the socket, and the client blocks, until the
+           machine has read some of it */
+        if (unread(session) >= INPUT_HIGH) {
+            session->full = 1;
+            watch(session);
+        }
+    }
+    return 0;
+}
+
+/*  Function: accept_sessions
+    Purpose: opens a session for every connection waiting to be accepted,
+    each with its own copy of the program, ready to run
+    Parameters: none
+    Returns: N/A
+*/
+static void accept_sessions()
+{
+    for (;;) {
+        int fd = accept(server.listener, NULL, NULL);
+        if (fd < 0) {
+            /* EAGAIN once there are none left, and a connection that
+               failed before it was accepted is simply dropped */
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return;
+        }
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+        struct Session *session = calloc(1, sizeof(struct Session));
+        assert(session != NULL);
+        session->fd = fd;
+        session->number = ++server.opened;
+        session->memory = seg_copy_program(server.program);
+        session->console = console_new(CONSOLE_MEMORY, CONSOLE_MEMORY, 0);
+        session->machine = threaded_new(session->memory, session->console,
+                                        0);
+
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = session;
+        if (epoll_ctl(server.epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+            fail(strerror(errno));
+        }
+
+        session->next = server.all;
+        if (server.all != NULL) {
+            server.all->prev = session;
+        }
+        server.all = session;
+        if (++server.open > server.peak_open) {
+            server.peak_open = server.open;
+        }
+        enqueue(session);
+    }
+}
+
+/*  Function: handle
+    Purpose: acts on what epoll reported for a connection: input is fed to
+    the machine, room to write takes more output, and a session parked on
+    either can run again
+    Parameters: the session, the events
+    Returns: N/A
+*/
+static void handle(struct Session *session, uint32_t events)
+{
+    if ((events & EPOLLERR) ||
+        ((events & EPOLLIN) && receive_input(session) < 0) ||
+        ((events & EPOLLOUT) && send_output(session) < 0)) {
+        session->state = FINISHED;
+        if (!session->queued) {
+            close_session(session, "lost its client");
+        }
+        return;
+    }
+
+    if (session->state == WAITING &&
+        !console_waiting(session->console)) {
+        enqueue(session);
+    }
+    else if (session->state == BLOCKED && pending(session) < OUTPUT_HIGH) {
+        enqueue(session);
+    }
+    else if (session->state == FINISHED && pending(session) == 0) {
+        close_session(session, end_reason(session));
+    }
+    else if ((events & EPOLLHUP) && session->state != RUNNABLE) {
+        /* the client has closed both sides, so nothing will wake it */
+        close_session(session, "lost its client");
+    }
+}
+
+/*  Function: run_slice
+    Purpose: runs the machine of a session for a slice, sends its output,
+    and puts the session where it belongs next
+    Parameters: the session
+    Returns: N/A
+    Expectation: the session has just left the run queue
+*/
+static void run_slice(struct Session *session)
+{
+    /* a session whose client went while it was queued */
+    if (session->state == FINISHED) {
+        close_session(session, "lost its client");
+        return;
+    }
+
+    session->status = threaded_run(session->machine, SLICE,
+                                   &session->instructions);
+    if (send_output(session) < 0) {
+        close_session(session, "lost its client");
+        return;
+    }
+    if (session->full && unread(session) < INPUT_HIGH) {
+        session->full = 0;
+        watch(session);
+    }
+
+    switch (session->status) {
+    case RUN_BUDGET:
+        if (pending(session) < OUTPUT_HIGH) {
+            enqueue(session);
+        }
+        else {
+            session->state = BLOCKED;
+        }
+        break;
+    case RUN_WAITING:
+        session->state = WAITING;
+        break;
+    default:
+        session->state = FINISHED;
+        if (pending(session) == 0) {
+            close_session(session, end_reason(session));
+        }
+    }
+}
+
+/*  Function: server_run
+    Purpose: serves a program on a UNIX socket until SIGINT or SIGTERM:
+    every connection gets its own machine, started from a copy of segment
+    0, whose input is what the client sends and whose output is sent back
+    Parameters: the path of the socket, the memory with the program loaded
+    as segment 0
+    Returns: 0 once the server has stopped
+    Expectation: the memory holds only segment 0
+*/
+int server_run(const char *path, MemSeg_T memory_total)
+{
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    server.listener = listen_on(path);
+    server.epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (server.epoll < 0) {
+        fail(strerror(errno));
+    }
+    server.program = memory_total;
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    if (epoll_ctl(server.epoll, EPOLL_CTL_ADD, server.listener,
+                  &event) != 0) {
+        fail(strerror(errno));
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    long idle_rss = usage.ru_maxrss;
+
+    struct epoll_event events[MAX_EVENTS];
+    while (!stopping) {
+        /* only sleep when no machine can run */
+        int count = epoll_wait(server.epoll, events, MAX_EVENTS,
+                               server.head == NULL ? -1 : 0);
+        if (count < 0 && errno != EINTR) {
+            fail(strerror(errno));
+        }
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.ptr == NULL) {
+                accept_sessions();
+            }
+            else {
+                handle(events[i].data.ptr, events[i].events);
+            }
+        }
+
+        /* every session that was runnable gets one slice; those that stay
+           runnable go behind the last of them */
+        struct Session *last = server.tail;
+        struct Session *session;
+        while (last != NULL && (session = dequeue()) != NULL) {
+            int was_last = session == last;
+            run_slice(session);
+            if (was_last) {
+                break;
+            }
+        }
+    }
+
+    /* what the sessions cost is the growth of the peak rss over what the
+       server held before the first of them */
+    getrusage(RUSAGE_SELF, &usage);
+    long per_session = server.peak_open == 0 ? 0
+                     : (usage.ru_maxrss - idle_rss) / (long) server.peak_open;
+    fprintf(stderr, "um: server: %llu sessions, at most %llu at once, "
+            "peak rss %ld KB, %ld KB per session\n",
+            (unsigned long long) server.opened,
+            (unsigned long long) server.peak_open, usage.ru_maxrss,
+            per_session);
+
+    while (server.all != NULL) {
+        close_session(server.all, "was stopped");
+    }
+    close(server.listener);
+    close(server.epoll);
+    unlink(path);
+    seg_free(memory_total);
+    return 0;
+}
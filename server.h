@@ -0,0 +1,39 @@
+/**************************************************************
+ *                        server.h
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Interface for serving a program over a UNIX socket
+ *
+ *     Purpose: Runs one machine per connection to a UNIX domain
+ * 				socket, all started from the same loaded program
+ * 				and all in one thread. Whatever a client sends is
+ * 				the machine's input, and its output is sent back
+ * 				as it is written. A machine waiting for input, or
+ * 				whose client is not reading its output, is
+ * 				parked until its connection is ready again, and
+ * 				the others run a slice of instructions at a time
+ * 				in turn.
+ *
+ *     Success Output:
+ *              Every client gets the output of its own machine.
+ *              A line per session and a summary are printed to
+ *              stderr.
+ *
+ *     Failure output:
+ *              An error message is printed and the program exits
+ *              if the socket cannot be made
+ *
+ **************************************************************/
+
+#include "seg_mem.h"
+
+#ifndef SERVER_H
+#define SERVER_H
+
+int server_run(const char *path, MemSeg_T memory_total);
+
+#endif
+/* SERVER_H */
@@ -0,0 +1,321 @@
+/**************************************************************
+ *                        session.c
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Implementation for our session.h
+ *
+ *     Purpose: A session file is SESSION_MAGIC followed by one
+ * 				record per IN ('I', the instructions run before
+ * 				it as 8 bytes, the value as 4) and one per block
+ * 				of output written ('O', the count as 4 bytes,
+ * 				the bytes), in the order they happened and in the
+ * 				byte order of the machine that wrote them. A
+ * 				replay reads the whole file first, so no input
+ * 				ever waits on a descriptor.
+ *
+ *     Success Output:
+ *              The session file when recording; nothing when a
+ *              replay matches the recording
+ *
+ *     Failure output:
+ *              An error message is printed and the program exits
+ *              if the session file cannot be read or written. A
+ *              replay that diverges is reported to stderr.
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <assert.h>
+#include "session.h"
+
+/* the first bytes of every session file */
+#define SESSION_MAGIC "UMSESS1\n"
+
+/* one IN of a recording: how many instructions ran before it, and the
+   value it got */
+struct Input {
+    uint64_t executed;
+    uint32_t value;
+};
+
+/* this struct holds nine variables
+    1. The session file, NULL if sessions are off
+    2. The file being recorded to, NULL unless recording
+    3. The recorded inputs, how many there are and the next to replay
+    4. The recorded output, its length and how much of it has been
+       checked
+    5. Whether the replay has diverged from the recording
+*/
+static struct {
+    char *path;
+    FILE *record;
+    struct Input *inputs;
+    size_t num_inputs;
+    size_t next_input;
+    unsigned char *output;
+    size_t output_len;
+    size_t output_pos;
+    int diverged;
+} session;
+
+/*  Function: fail
+    Purpose: prints why the session file could not be used and exits
+    Parameters: the name of the file, what went wrong
+    Returns: N/A
+*/
+static void fail(const char *path, const char *reason)
+{
+    fprintf(stderr, "um: %s: %s\n", path, reason);
+    exit(EXIT_FAILURE);
+}
+
+/*  Function: set_path
+    Purpose: keeps a copy of the name of the session file
+    Parameters: the name
+    Returns: N/A
+*/
+static void set_path(const char *path)
+{
+    assert(path != NULL);
+
+    free(session.path);
+    session.path = malloc(strlen(path) + 1);
+    assert(session.path != NULL);
+    strcpy(session.path, path);
+}
+
+/*  Function: read_all
+    Purpose: reads exactly count bytes of the session file
+    Parameters: the file, where to put the bytes, how many
+    Returns: 1 if they were read, 0 at the end of the file
+*/
+static int read_all(FILE *file, void *bytes, size_t count)
+{
+    size_t got = fread(bytes, 1, count, file);
+    if (got != count && ferror(file)) {
+        fail(session.path, strerror(errno));
+    }
+    return got == count;
+}
+
+/*  Function: session_set_record
+    Purpose: records the session to a file, replacing any file of that name
+    Parameters: the name of the file
+    Returns: N/A
+*/
+void session_set_record(const char *path)
+{
+    set_path(path);
+    session.record = fopen(path, "wb");
+    if (session.record == NULL ||
+        fwrite(SESSION_MAGIC, 1, 8, session.record) != 8) {
+        fail(path, strerror(errno));
+    }
+}
+
+/*  Function: session_set_replay
+    Purpose: reads a recorded session, whose input is handed to the
+    machine instead of stdin's and whose output the machine's is checked
+    against
+    Parameters: the name of the file
+    Returns: N/A
+*/
+void session_set_replay(const char *path)
+{
+    set_path(path);
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        fail(path, strerror(errno));
+    }
+
+    char magic[8];
+    if (!read_all(file, magic, 8) || memcmp(magic, SESSION_MAGIC, 8) != 0) {
+        fail(path, "not a um session");
+    }
+
+    size_t inputs_cap = 64, output_cap = 4096;
+    session.inputs = malloc(inputs_cap * sizeof(struct Input));
+    session.output = malloc(output_cap);
+    assert(session.inputs != NULL && session.output != NULL);
+
+    char tag;
+    while (read_all(file, &tag, 1)) {
+        if (tag == 'I') {
+            if (session.num_inputs == inputs_cap) {
+                inputs_cap *= 2;
+                session.inputs = realloc(session.inputs,
+                                         inputs_cap * sizeof(struct Input));
+                assert(session.inputs != NULL);
+            }
+            struct Input *input = &session.inputs[session.num_inputs++];
+            if (!read_all(file, &input->executed, 8) ||
+                !read_all(file, &input->value, 4)) {
+                fail(path, "ends in the middle of a record");
+            }
+        }
+        else if (tag == 'O') {
+            uint32_t count;
+            if (!read_all(file, &count, 4)) {
+                fail(path, "ends in the middle of a record");
+            }
+            while (session.output_len + count > output_cap) {
+                output_cap *= 2;
+                session.output = realloc(session.output, output_cap);
+                assert(session.output != NULL);
+            }
+            if (!read_all(file, session.output + session.output_len, count)) {
+                fail(path, "ends in the middle of a record");
+            }
+            session.output_len += count;
+        }
+        else {
+            fail(path, "not a um session");
+        }
+    }
+    fclose(file);
+}
+
+/*  Function: session_active
+    Purpose: says whether a session is being recorded or replayed
+    Parameters: none
+    Returns: 1 if it is, otherwise 0
+*/
+int session_active()
+{
+    return session.path != NULL;
+}
+
+/*  Function: diverge
+    Purpose: reports the first place a replay does not match its recording
+    Parameters: a printf format and its arguments
+    Returns: N/A
+*/
+static void diverge(const char *format, ...)
+{
+    if (session.diverged) {
+        return;
+    }
+    session.diverged = 1;
+
+    fprintf(stderr, "um: %s: replay diverged: ", session.path);
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+/*  Function: session_in
+    Purpose: gives an IN instruction its value: the next byte of input
+    when recording, which is recorded, or the next recorded value when
+    replaying
+    Parameters: the console, how many instructions ran before the IN
+    Returns: the value, CONSOLE_EOF once the input has ended
+    Expectation: a session is active
+*/
+uint32_t session_in(Console_T console, uint64_t executed)
+{
+    assert(session_active());
+
+    if (session.record != NULL) {
+        uint32_t value = console_get(console);
+        if (fputc('I', session.record) == EOF ||
+            fwrite(&executed, 8, 1, session.record) != 1 ||
+            fwrite(&value, 4, 1, session.record) != 1) {
+            fail(session.path, strerror(errno));
+        }
+        return value;
+    }
+
+    /* the output so far is checked before the input it answers, as it
+       would be written before a terminal waits */
+    console_flush(console);
+
+    size_t n = session.next_input++;
+    if (n == session.num_inputs) {
+        diverge("input %zu came after %llu instructions, past the end of "
+                "the recording", n, (unsigned long long) executed);
+    }
+    if (n >= session.num_inputs) {
+        return CONSOLE_EOF;
+    }
+    if (session.inputs[n].executed != executed) {
+        diverge("input %zu came after %llu instructions, it was recorded "
+                "after %llu", n, (unsigned long long) executed,
+                (unsigned long long) session.inputs[n].executed);
+    }
+    return session.inputs[n].value;
+}
+
+/*  Function: session_output
+    Purpose: records a block of output, or checks it against the recording
+    Parameters: the bytes, how many there are
+    Returns: N/A
+*/
+void session_output(const unsigned char *bytes, size_t count)
+{
+    if (session.record != NULL) {
+        uint32_t length = count;
+        assert(length == count);
+        if (fputc('O', session.record) == EOF ||
+            fwrite(&length, 4, 1, session.record) != 1 ||
+            fwrite(bytes, 1, count, session.record) != count) {
+            fail(session.path, strerror(errno));
+        }
+        return;
+    }
+    if (!session_active()) {
+        return;
+    }
+
+    for (size_t i = 0; i < count && !session.diverged; i++) {
+        size_t at = session.output_pos + i;
+        if (at == session.output_len) {
+            diverge("output byte %zu is past the end of the recording",
+                    at);
+        }
+        else if (bytes[i] != session.output[at]) {
+            diverge("output byte %zu is %u, it was recorded as %u (%zu "
+                    "inputs had been read)", at, bytes[i],
+                    session.output[at], session.next_input);
+        }
+    }
+    session.output_pos += count;
+}
+
+/*  Function: session_finish
+    Purpose: closes the recording, or checks that a replay read every
+    input and wrote all of the output that was recorded
+    Parameters: none
+    Returns: 1 if a replay diverged, otherwise 0
+*/
+int session_finish()
+{
+    if (session.record != NULL && fclose(session.record) != 0) {
+        fail(session.path, strerror(errno));
+    }
+    else if (session.record == NULL && session_active()) {
+        if (session.next_input < session.num_inputs) {
+            diverge("only %zu of the %zu recorded inputs were read",
+                    session.next_input, session.num_inputs);
+        }
+        if (session.output_pos < session.output_len) {
+            diverge("output ended after %zu bytes, the recording has %zu",
+                    session.output_pos, session.output_len);
+        }
+    }
+
+    int diverged = session.diverged;
+    free(session.path);
+    free(session.inputs);
+    free(session.output);
+    memset(&session, 0, sizeof(session));
+    return diverged;
+}
@@ -0,0 +1,50 @@
+/**************************************************************
+ *                        session.h
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Interface for recording and replaying a session
+ *
+ *     Purpose: Records every value an IN instruction gets, with
+ * 				the number of instructions run before it, and the
+ * 				output written, so an interactive program can be
+ * 				run again with exactly the same input and no
+ * 				terminal. A replay hands the recorded values back
+ * 				in order, and checks that every IN comes at the
+ * 				same instruction and that the output is the same
+ * 				byte for byte, reporting the first place it is
+ * 				not. Like snapshot.h, nothing happens unless um
+ * 				turns it on.
+ *
+ *     Success Output:
+ *              The session file when recording; nothing when a
+ *              replay matches the recording
+ *
+ *     Failure output:
+ *              An error message is printed and the program exits
+ *              if the session file cannot be read or written. A
+ *              replay that diverges is reported to stderr.
+ *
+ **************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+#include "console.h"
+
+#ifndef SESSION_H
+#define SESSION_H
+
+/* the exit status of um when a replay did not match its recording */
+#define SESSION_DIVERGED 5
+
+void session_set_record(const char *path);
+void session_set_replay(const char *path);
+int session_active();
+uint32_t session_in(Console_T console, uint64_t executed);
+void session_output(const unsigned char *bytes, size_t count);
+int session_finish();
+
+#endif
+/* SESSION_H */
@@ -0,0 +1,462 @@
+/**************************************************************
+ *                       snapshot.c
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Implementation for our snapshot.h
+ *
+ *     Purpose: A snapshot file is a magic number followed by
+ * 				one or more frames. A frame holds the registers,
+ * 				the program counter, the size of the segment
+ * 				table, the stack of unmapped IDs and a list of
+ * 				segment records (ID, length, words). A full frame
+ * 				records every mapped segment; a delta frame,
+ * 				written in incremental mode, records only those
+ * 				whose contents changed since the frame before,
+ * 				found by comparing a hash of every segment. The
+ * 				newest frame, with every segment's newest record,
+ * 				is the state that is restored. Words are stored
+ * 				in the byte order of the machine that wrote them,
+ * 				and the file is read through mmap, so restoring
+ * 				costs one copy of each segment.
+ *
+ *     Success Output:
+ *              A restored machine continues exactly where the
+ * 				saved one was waiting for input
+ *
+ *     Failure output:
+ *              An error message is printed and the program exits
+ *              if a snapshot cannot be written, or the file to be
+ *              restored cannot be read or is not a valid snapshot.
+ *              It exits with SEG_LIMIT_EXCEEDED if the machine is
+ *              over the memory limits it is restored with.
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+
+/* the first bytes of every snapshot file; the last one is the version */
+static const char MAGIC[8] = { 'U', 'M', 'S', 'N', 'A', 'P', 0, 1 };
+
+/* the kinds of frame */
+enum frame_kind { FULL = 1, DELTA = 2 };
+
+/* the fixed part of a frame. It is followed by num_free unmapped IDs and
+   then num_records records of an ID, a length and that many words */
+struct Frame {
+    uint32_t kind;
+    uint32_t regs[8];
+    uint32_t pc;
+    uint32_t num_segments;
+    uint32_t num_free;
+    uint32_t alias;
+    uint32_t num_records;
+};
+
+/* this struct holds six variables
+    1. The file snapshots are written to, or NULL if none are
+    2. Whether later snapshots are appended as deltas
+    3. The open file in incremental mode
+    4. How many snapshots have been written
+    5. The hash of every segment as of the last snapshot, 0 if it was not
+       recorded, and how many IDs have room for one
+*/
+static struct {
+    char *path;
+    int incremental;
+    FILE *file;
+    uint64_t saves;
+    uint64_t *hashes;
+    uint32_t num_hashes;
+} writer;
+
+/* the registers and program counter restored from a snapshot, if any */
+static struct {
+    int restored;
+    uint32_t regs[8];
+    uint32_t pc;
+} start;
+
+/*  Function: fail
+    Purpose: prints why a snapshot could not be written or read and exits
+    Parameters: the name of the file, what went wrong
+    Returns: N/A
+*/
+static void fail(const char *path, const char *reason)
+{
+    fprintf(stderr, "um: %s: %s\n", path, reason);
+    exit(EXIT_FAILURE);
+}
+
+/*  Function: hash
+    Purpose: hashes the words of a segment, two at a time. A hash is never
+    0, which is kept for segments that were not recorded.
+    Parameters: the words and how many there are
+    Returns: the hash
+*/
+static uint64_t hash(const uint32_t *words, uint32_t length)
+{
+    const uint64_t K = 0x9E3779B97F4A7C15ull;
+    uint64_t h = K ^ length;
+    uint32_t i = 0;
+
+    for (; i + 1 < length; i += 2) {
+        h = (h ^ (words[i] | (uint64_t) words[i + 1] << 32)) * K;
+        h ^= h >> 29;
+    }
+    if (i < length) {
+        h = (h ^ words[i]) * K;
+        h ^= h >> 29;
+    }
+
+    return h | 1;
+}
+
+/*  Function: put
+    Purpose: writes bytes to a snapshot, exiting if they cannot be written
+    Parameters: the file, the bytes, how many there are
+    Returns: N/A
+*/
+static void put(FILE *file, const void *bytes, size_t count)
+{
+    if (count != 0 && fwrite(bytes, count, 1, file) != 1) {
+        fail(writer.path, strerror(errno));
+    }
+}
+
+/*  Function: snapshot_set_writer
+    Purpose: makes the engines save a snapshot every time the machine
+    waits for input
+    Parameters: the file to save to, and whether snapshots after the first
+    are appended as deltas instead of replacing the file
+    Returns: N/A
+*/
+void snapshot_set_writer(const char *path, int incremental)
+{
+    assert(path != NULL);
+
+    free(writer.path);
+    writer.path = malloc(strlen(path) + 1);
+    assert(writer.path != NULL);
+    strcpy(writer.path, path);
+    writer.incremental = incremental;
+}
+
+/*  Function: changed_segments
+    Purpose: lists the segments a frame has to record: every mapped one
+    for a full frame, and those whose hash changed for a delta. Segment 0
+    is left out while it shares the words of another segment.
+    Parameters: the memory, whether the frame is full, where to put the
+    IDs
+    Returns: how many IDs were listed
+*/
+static uint32_t changed_segments(MemSeg_T memory_total, int full,
+                                 uint32_t *ids)
+{
+    uint32_t n = memory_total->num_segments;
+    uint32_t count = 0;
+
+    if (writer.incremental && writer.num_hashes < n) {
+        writer.hashes = realloc(writer.hashes, n * sizeof(uint64_t));
+        assert(writer.hashes != NULL);
+        memset(writer.hashes + writer.num_hashes, 0,
+               (n - writer.num_hashes) * sizeof(uint64_t));
+        writer.num_hashes = n;
+    }
+
+    for (uint32_t id = 0; id < n; id++) {
+        const struct Segment *segment = &memory_total->table[id];
+        int recorded = segment->words != NULL &&
+                       (id != 0 || memory_total->alias == 0);
+
+        if (!writer.incremental) {
+            if (recorded) {
+                ids[count++] = id;
+            }
+            continue;
+        }
+        if (!recorded) {
+            writer.hashes[id] = 0;
+            continue;
+        }
+        uint64_t h = hash(segment->words, segment->length);
+        if (full || h != writer.hashes[id]) {
+            ids[count++] = id;
+        }
+        writer.hashes[id] = h;
+    }
+
+    return count;
+}
+
+/*  Function: snapshot_wait
+    Purpose: called by the engines when an IN is about to wait for input.
+    Saves a snapshot if a writer was set: a full one, or in incremental
+    mode a delta after the first.
+    Parameters: the memory, the registers, the pc of the IN instruction
+    Returns: N/A
+*/
+void snapshot_wait(MemSeg_T memory_total, const uint32_t *regs, uint32_t pc)
+{
+    if (writer.path == NULL) {
+        return;
+    }
+    /* a snapshot records the table, so an arena memory has none */
+    assert(memory_total != NULL && regs != NULL);
+    assert(memory_total->arena == NULL);
+
+    int full = !writer.incremental || writer.saves == 0;
+    uint32_t *ids = malloc((memory_total->num_segments + 1) *
+                           sizeof(uint32_t));
+    assert(ids != NULL);
+
+    struct Frame frame;
+    frame.kind = full ? FULL : DELTA;
+    memcpy(frame.regs, regs, sizeof(frame.regs));
+    frame.pc = pc;
+    frame.num_segments = memory_total->num_segments;
+    frame.num_free = memory_total->num_free;
+    frame.alias = memory_total->alias;
+    frame.num_records = changed_segments(memory_total, full, ids);
+
+    /* a full snapshot replaces the file, through a temporary so that a
+       crash never leaves half of one */
+    char *temp = NULL;
+    FILE *file = writer.file;
+    if (full) {
+        temp = malloc(strlen(writer.path) + 5);
+        assert(temp != NULL);
+        sprintf(temp, "%s.tmp", writer.path);
+        file = fopen(temp, "wb");
+        if (file == NULL) {
+            fail(temp, strerror(errno));
+        }
+        put(file, MAGIC, sizeof(MAGIC));
+    }
+
+    put(file, &frame, sizeof(frame));
+    put(file, memory_total->free_ids, frame.num_free * sizeof(uint32_t));
+    for (uint32_t i = 0; i < frame.num_records; i++) {
+        const struct Segment *segment = &memory_total->table[ids[i]];
+        uint32_t record[2] = { ids[i], segment->length };
+        put(file, record, sizeof(record));
+        put(file, segment->words, segment->length * sizeof(uint32_t));
+    }
+    if (fflush(file) != 0) {
+        fail(writer.path, strerror(errno));
+    }
+
+    if (full) {
+        if (writer.file != NULL) {
+            fclose(writer.file);
+            writer.file = NULL;
+        }
+        if (rename(temp, writer.path) != 0) {
+            fail(writer.path, strerror(errno));
+        }
+        if (writer.incremental) {
+            writer.file = file;
+        }
+        else if (fclose(file) != 0) {
+            fail(writer.path, strerror(errno));
+        }
+        free(temp);
+    }
+
+    writer.saves++;
+    free(ids);
+}
+
+/*  Function: snapshot_finish
+    Purpose: closes the snapshot file and forgets the writer
+    Parameters: none
+    Returns: N/A
+*/
+void snapshot_finish()
+{
+    if (writer.file != NULL && fclose(writer.file) != 0) {
+        fail(writer.path, strerror(errno));
+    }
+    free(writer.path);
+    free(writer.hashes);
+    memset(&writer, 0, sizeof(writer));
+}
+
+/*  Function: snapshot_restore
+    Purpose: rebuilds the memory of a saved machine and keeps its
+    registers and pc for snapshot_start. The newest record of every
+    mapped segment is copied out of the mapped file.
+    Parameters: the snapshot file, a MemSeg_T with no segments that uses
+    the table
+    Returns: N/A
+    Expectation: snapshot_start is called by the engine that then runs
+*/
+void snapshot_restore(const char *path, MemSeg_T memory_total)
+{
+    assert(path != NULL && memory_total != NULL);
+    assert(memory_total->arena == NULL);
+
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fail(path, strerror(errno));
+    }
+    size_t size = st.st_size;
+    if (size < sizeof(MAGIC)) {
+        fail(path, "not a UM snapshot");
+    }
+    const unsigned char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE,
+                                    fd, 0);
+    if (map == MAP_FAILED) {
+        fail(path, strerror(errno));
+    }
+    close(fd);
+    madvise((void *) map, size, MADV_SEQUENTIAL);
+    if (memcmp(map, MAGIC, sizeof(MAGIC)) != 0) {
+        fail(path, "not a UM snapshot");
+    }
+
+    /* walk the frames, remembering the newest record of every ID */
+    const uint32_t **latest = NULL;
+    uint32_t num_latest = 0;
+    const uint32_t *free_ids = NULL;
+    struct Frame last;
+    size_t off = sizeof(MAGIC);
+    int frames = 0;
+
+    while (off < size) {
+        struct Frame frame;
+        if (size - off < sizeof(frame)) {
+            fail(path, "snapshot is truncated");
+        }
+        memcpy(&frame, map + off, sizeof(frame));
+        off += sizeof(frame);
+        if (frame.kind != FULL && (frame.kind != DELTA || frames == 0)) {
+            fail(path, "snapshot is corrupt");
+        }
+        if (frame.num_free > frame.num_segments ||
+            (size - off) / sizeof(uint32_t) < frame.num_free) {
+            fail(path, "snapshot is truncated");
+        }
+        free_ids = (const uint32_t *) (map + off);
+        off += frame.num_free * sizeof(uint32_t);
+
+        if (num_latest < frame.num_segments) {
+            latest = realloc(latest, frame.num_segments * sizeof(*latest));
+            assert(latest != NULL);
+            memset(latest + num_latest, 0,
+                   (frame.num_segments - num_latest) * sizeof(*latest));
+            num_latest = frame.num_segments;
+        }
+        if (frame.kind == FULL) {
+            memset(latest, 0, num_latest * sizeof(*latest));
+        }
+
+        for (uint32_t i = 0; i < frame.num_records; i++) {
+            if (size - off < 2 * sizeof(uint32_t)) {
+                fail(path, "snapshot is truncated");
+            }
+            const uint32_t *record = (const uint32_t *) (map + off);
+            off += 2 * sizeof(uint32_t);
+            if (record[0] >= frame.num_segments) {
+                fail(path, "snapshot is corrupt");
+            }
+            if ((size - off) / sizeof(uint32_t) < record[1]) {
+                fail(path, "snapshot is truncated");
+            }
+            latest[record[0]] = record;
+            off += (size_t) record[1] * sizeof(uint32_t);
+        }
+
+        last = frame;
+        frames++;
+    }
+    if (frames == 0) {
+        fail(path, "snapshot is empty");
+    }
+
+    /* check the unmapped IDs and segment 0 before building anything */
+    uint8_t *unmapped = calloc(last.num_segments + 1, 1);
+    assert(unmapped != NULL);
+    for (uint32_t i = 0; i < last.num_free; i++) {
+        if (free_ids[i] >= last.num_segments || unmapped[free_ids[i]]) {
+            fail(path, "snapshot is corrupt");
+        }
+        unmapped[free_ids[i]] = 1;
+    }
+    if (last.num_segments == 0 || unmapped[0] ||
+        last.alias >= last.num_segments || unmapped[last.alias]) {
+        fail(path, "snapshot is corrupt");
+    }
+
+    seg_restore_table(memory_total, last.num_segments, free_ids,
+                      last.num_free);
+    for (uint32_t id = 0; id < last.num_segments; id++) {
+        if (unmapped[id]) {
+            continue;
+        }
+        /* a shared segment 0 is given its words by loadprogram below */
+        if (id == 0 && last.alias != 0) {
+            if (seg_restore_segment(memory_total, 0, 0) == NULL) {
+                exit(SEG_LIMIT_EXCEEDED);
+            }
+            continue;
+        }
+        const uint32_t *record = latest[id];
+        if (record == NULL) {
+            fail(path, "snapshot is missing a segment");
+        }
+
+        /* a machine saved without limits may not fit those given now;
+           seg_mem.h has reported it */
+        uint32_t *words = seg_restore_segment(memory_total, id, record[1]);
+        if (words == NULL) {
+            exit(SEG_LIMIT_EXCEEDED);
+        }
+        memcpy(words, record + 2, (size_t) record[1] * sizeof(uint32_t));
+    }
+
+    uint32_t length = seg_length(memory_total, 0);
+    if (last.alias != 0 &&
+        seg_loadprogram(memory_total, last.alias, &length) == NULL) {
+        exit(SEG_LIMIT_EXCEEDED);
+    }
+    if (last.pc >= length) {
+        fail(path, "snapshot is corrupt");
+    }
+
+    start.restored = 1;
+    memcpy(start.regs, last.regs, sizeof(start.regs));
+    start.pc = last.pc;
+
+    free(unmapped);
+    free(latest);
+    munmap((void *) map, size);
+}
+
+/*  Function: snapshot_start
+    Purpose: called by the engines before the first instruction. Puts
+    the registers and pc of a restored machine in place; without a
+    restore they are left as the engine set them.
+    Parameters: the engine's registers and program counter
+    Returns: N/A
+*/
+void snapshot_start(uint32_t *regs, uint32_t *pc)
+{
+    assert(regs != NULL && pc != NULL);
+
+    if (start.restored) {
+        memcpy(regs, start.regs, sizeof(start.regs));
+        *pc = start.pc;
+    }
+}
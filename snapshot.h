@@ -0,0 +1,43 @@
+/**************************************************************
+ *                       snapshot.h
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Interface for our machine-state snapshots
+ *
+ *     Purpose: Saves the whole state of a running machine (its
+ * 				registers, program counter, every mapped segment
+ * 				and the stack of unmapped IDs) to a binary file
+ * 				each time it waits for input, and restores a
+ * 				machine from that file later, so a program's
+ * 				warm-up only has to run once. In incremental
+ * 				mode later snapshots are appended to the file
+ * 				and hold only the segments that changed.
+ *
+ *     Success Output:
+ *              A restored machine continues exactly where the
+ * 				saved one was waiting for input
+ *
+ *     Failure output:
+ *              An error message is printed and the program exits
+ *              if a snapshot cannot be written, or the file to be
+ *              restored cannot be read or is not a valid snapshot
+ *
+ **************************************************************/
+
+#include <stdint.h>
+#include "seg_mem.h"
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+void snapshot_set_writer(const char *path, int incremental);
+void snapshot_restore(const char *path, MemSeg_T memory_total);
+void snapshot_start(uint32_t *regs, uint32_t *pc);
+void snapshot_wait(MemSeg_T memory_total, const uint32_t *regs, uint32_t pc);
+void snapshot_finish();
+
+#endif
+/* SNAPSHOT_H */
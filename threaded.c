@@ -0,0 +1,872 @@
+/**************************************************************
+ *                       threaded.c
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Implementation for our threaded.h
+ *
+ *     Purpose: Executes a program the same way execute() does,
+ * 				but dispatches every instruction through a table
+ * 				of label addresses (computed goto) instead of a
+ * 				chain of if/else comparisons. Registers and the
+ * 				program counter are kept in locals and each
+ * 				instruction comes pre-decoded from decode.h,
+ * 				with frequent sequences fused into one record.
+ * 				The engine can stop at a jump once it has run
+ * 				a budget of instructions, or at an IN waiting
+ * 				for a host's input, and resume later.
+ *
+ *     Success Output:
+ *              Each instruction is run successfully and the
+ * 				output is identical to the reference engine
+ *
+ *     Failure output:
+ *              A Hanson checked runtime exception is raised if
+ *              there is a problem executing any instruction
+ *
+ **************************************************************/
+
+/* UM_FAST builds the engine with every assert compiled out, including
+   those of the inline functions of seg_mem.h and console.h, so it has to
+   come before any header */
+#ifdef UM_FAST
+#define NDEBUG
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <assert.h>
+#include <stdint.h>
+#include "threaded.h"
+#include "decode.h"
+#include "seg_mem.h"
+#include "jit.h"
+#include "seqprof.h"
+#include "snapshot.h"
+#include "profile.h"
+#include "trace.h"
+#include "session.h"
+#include "sample.h"
+
+/* this file is built twice: once as the threaded and jit engines, and
+   once with UM_PROFILE as the profiling engine, which counts every
+   instruction. The counting is compiled out of the first build */
+#ifdef UM_PROFILE
+#define PROFILING 1
+#else
+#define PROFILING 0
+#endif
+
+/* the safety policy is chosen the same way. The default build keeps the
+   asserts, UM_FAST drops them, and UM_STRICT also checks every
+   instruction against the UM spec and reports the first one that breaks
+   it */
+#ifdef UM_STRICT
+#define STRICT 1
+#else
+#define STRICT 0
+#endif
+
+/* UM_TRACE builds the tracing engine, which records every jump, map,
+   unmap, loadprogram and byte of I/O to trace.h */
+#ifdef UM_TRACE
+#define TRACING 1
+#else
+#define TRACING 0
+#endif
+
+/* fetches the next pre-decoded record and jumps straight to its handler.
+   Running off the end of segment 0 lands on the OP_END record, so no
+   bounds check is needed here */
+#define DISPATCH()                                      \
+        do {                                            \
+                ins = &prog[pc++];                      \
+                if (PROFILING) {                        \
+                        count(stats, seq, ins, pc - 1); \
+                }                                       \
+                goto *handlers[ins->op];                \
+        } while (0)
+
+/* goes straight to the handler of the next record of a fused sequence,
+   whose opcode is known, without a trip through the dispatch table */
+#define CHAIN(label)                                    \
+        do {                                            \
+                ins = &prog[pc++];                      \
+                goto label;                             \
+        } while (0)
+
+/* in the strict engine, stops the machine with a report if ok is false.
+   The other engines compile it to nothing */
+#define CHECK(ok, ...)                                                  \
+        do {                                                            \
+                if (STRICT && !(ok)) {                                  \
+                        violation(code, length, pc - 1, __VA_ARGS__);   \
+                        result = RUN_VIOLATION;                         \
+                        machine->status = result;                       \
+                        goto stop;                                      \
+                }                                                       \
+        } while (0)
+
+/* in the tracing engine, adds a record to the trace. The other engines
+   compile it to nothing */
+#define TRACE(kind, field, value)                                       \
+        do {                                                            \
+                if (TRACING) {                                          \
+                        trace_record(trace, kind, field, value);        \
+                }                                                       \
+        } while (0)
+
+/* tells the sampling profiler that the machine has entered the block at
+   a pc. Only jumps publish, and only a machine being sampled, so the
+   instructions in between and every other machine pay nothing */
+#define PUBLISH(at)                                                     \
+        do {                                                            \
+                if (publishing) {                                       \
+                        machine->point.pc = (at);                       \
+                        machine->point.op = prog[at].op;                \
+                        machine->point.generation =                     \
+                                machine->generation;                    \
+                }                                                       \
+        } while (0)
+
+/* checks that a segment is mapped and an offset is inside it */
+#define CHECK_ACCESS(id, offset)                                        \
+        do {                                                            \
+                CHECK(seg_mapped(memory_total, id),                     \
+                      "segment %u is not mapped", id);                  \
+                CHECK(offset < seg_length(memory_total, id),            \
+                      "offset %u is past the end of segment %u "        \
+                      "(length %u)", offset, id,                        \
+                      seg_length(memory_total, id));                    \
+        } while (0)
+
+/*  Function: violation
+    Purpose: reports an instruction that breaks the UM spec, for the
+    strict engine
+    Parameters: the words of segment 0 and how many there are, the pc of
+    the instruction, and a printf format and its arguments saying what it
+    did wrong
+    Returns: N/A
+*/
+static void violation(const uint32_t *code, uint32_t length, uint32_t pc,
+                      const char *format, ...)
+{
+    if (pc < length) {
+        fprintf(stderr, "um: pc %u: %08x (%s): ", pc, code[pc],
+                decode_op_name(code[pc] >> 28));
+    }
+    else {
+        fprintf(stderr, "um: pc %u: ", pc);
+    }
+
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+/*  Function: count
+    Purpose: counts one instruction for the profiling engine
+    Parameters: the profile counters and the sequence profiler, either of
+    which may be NULL, the record about to run and its pc
+    Returns: N/A
+*/
+static inline void count(Profile_T stats, Seqprof_T seq, const Instr *ins,
+                         uint32_t pc)
+{
+    if (stats != NULL) {
+        stats->ops[ins->op]++;
+        stats->pcs[pc]++;
+    }
+    if (seq != NULL) {
+        seqprof_count(seq, pc, ins->op);
+    }
+}
+
+/* this struct holds sixteen variables, the state of an engine between two
+   calls of machine_run
+    1. The memory and the console of the machine
+    2. The decoded records of segment 0 and the JIT, which is NULL if it
+       is not used
+    3. The profile counters and the sequence profiler, which are NULL
+       outside the profiling engine, and when it started running
+    4. The trace, which is NULL outside the tracing engine
+    5. The words of segment 0 that were decoded, the records and how
+       many words there are
+    6. The registers and the program counter
+    7. RUN_HALTED, RUN_FELL_OFF, RUN_VIOLATION or RUN_LIMIT once the
+       machine has stopped for good, otherwise RUN_BUDGET
+    8. How many times another segment has been loaded as segment 0, and
+       for the sampling profiler, the pc and record of the block the
+       machine last entered with that generation
+*/
+struct Threaded_T {
+    MemSeg_T memory_total;
+    Console_T console;
+    Decoded cache;
+    Jit_T jit;
+    Profile_T stats;
+    Seqprof_T seq;
+    double started;
+    Trace_T trace;
+    const uint32_t *code;
+    Instr *prog;
+    uint32_t length;
+    uint32_t r[8];
+    uint32_t pc;
+    int status;
+    uint32_t generation;
+    volatile struct Sample_point point;
+};
+
+/* the machine the sampling profiler looks at, NULL if it is off */
+static Threaded_T sampled = NULL;
+
+/*  Function: where
+    Purpose: tells the sampling profiler which block the machine is in. It
+    runs in a signal handler, between any two instructions of the engine
+    Parameters: where to put the pc, opcode and segment 0 generation
+    Returns: 1, or 0 if no machine is being sampled
+*/
+static int where(struct Sample_point *point)
+{
+    const struct Threaded_T *machine = sampled;
+    if (machine == NULL) {
+        return 0;
+    }
+    point->pc = machine->point.pc;
+    point->op = decode_base(machine->point.op);
+    point->generation = machine->point.generation;
+    return 1;
+}
+
+/*  Function: machine_new
+    Purpose: sets up an engine for a program, before its first instruction
+    Parameters: the memory, with the program loaded as segment 0, the
+    console for input and output, and whether to use the JIT
+    Returns: an allocated engine
+    Expectation: the memory and console must not be NULL
+*/
+static Threaded_T machine_new(MemSeg_T memory_total, Console_T console,
+                              int use_jit)
+{
+    assert(memory_total != NULL && console != NULL);
+
+    Threaded_T machine = malloc(sizeof(struct Threaded_T));
+    assert(machine != NULL);
+
+    /* the profiling engine does not fuse, so it counts every instruction
+       as itself, and does not use the JIT, whose code it could not see */
+    machine->memory_total = memory_total;
+    machine->console = console;
+    machine->started = PROFILING ? profile_now() : 0;
+    machine->stats = PROFILING ? profile_get() : NULL;
+    machine->seq = PROFILING && seqprof_output() != NULL ? seqprof_new()
+                                                         : NULL;
+    machine->cache = decode_new(!PROFILING);
+    machine->code = get_segment(memory_total, 0, &machine->length);
+    machine->prog = decode_program(machine->cache, machine->code,
+                                   machine->length);
+    for (int i = 0; i < 8; i++) {
+        machine->r[i] = 0;
+    }
+    machine->pc = 0;
+    machine->status = RUN_BUDGET;
+    machine->generation = 0;
+
+    /* a machine restored from a snapshot starts where it was saved */
+    snapshot_start(machine->r, &machine->pc);
+    machine->point.pc = machine->pc;
+    machine->point.op = machine->prog[machine->pc < machine->length
+                                      ? machine->pc : machine->length].op;
+    machine->point.generation = 0;
+
+    machine->trace = TRACING ? trace_open() : NULL;
+    if (machine->trace != NULL) {
+        trace_record(machine->trace, TRACE_BLOCK, 0, machine->pc);
+    }
+
+    if (machine->stats != NULL) {
+        profile_open_version(machine->stats, machine->code,
+                             machine->length);
+    }
+
+    /* the JIT is NULL if it was not asked for or this host has none */
+    machine->jit = use_jit && !PROFILING && !TRACING
+                 ? jit_new(memory_total, console, machine->cache) : NULL;
+    if (machine->jit != NULL) {
+        jit_reset(machine->jit, machine->prog, machine->length);
+    }
+
+    return machine;
+}
+
+/* label addresses and computed goto are GNU extensions */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+/*  Function: machine_run
+    Purpose: Executes the program using direct threaded dispatch from
+    where the last call stopped, optionally handing every jump target to
+    the JIT. The budget is only checked at jumps, the end of every basic
+    block, so the instructions in between pay nothing for it.
+    Parameters: the engine, how many instructions it may run, and where to
+    add how many it did run
+    Returns: RUN_HALTED or RUN_FELL_OFF when the program stops,
+    RUN_LIMIT when a map or loadprogram would take it over a memory limit,
+    RUN_BUDGET at the first jump once the budget is used up, and
+    RUN_WAITING at an IN that has to wait for a host program's input
+    Expectation: the engine must not be NULL. Instructions run as compiled
+    code by the JIT are not counted.
+*/
+static int machine_run(Threaded_T machine, uint64_t budget,
+                       uint64_t *executed)
+{
+    /* one handler per decoded opcode, indexed by enum um_op and then by
+       enum fused_op */
+    static void *const handlers[NUM_DECODED_OPS] = {
+        &&op_cmov, &&op_sload, &&op_sstore, &&op_add, &&op_mul, &&op_div,
+        &&op_nand, &&op_halt, &&op_map, &&op_unmap, &&op_out, &&op_in,
+        &&op_loadp, &&op_lv, &&op_invalid, &&fell_off,
+        &&op_lv_sload, &&op_lv_sstore, &&op_lv_add, &&op_lv_nand,
+        &&op_lv_lv, &&op_lv_loadp, &&op_sload_lv, &&op_sstore_lv,
+        &&op_add_lv, &&op_nand_nand, &&op_nand_add, &&op_lv_lv_loadp
+    };
+
+    assert(machine != NULL && executed != NULL);
+    if (machine->status != RUN_BUDGET) {
+        return machine->status;
+    }
+
+    /* the state lives in locals while the machine runs, and is put back
+       when it stops */
+    MemSeg_T memory_total = machine->memory_total;
+    Console_T console = machine->console;
+    Decoded cache = machine->cache;
+    Jit_T jit = machine->jit;
+    Profile_T stats = machine->stats;
+    Seqprof_T seq = machine->seq;
+    Trace_T trace = machine->trace;
+    const uint32_t *code = machine->code;
+    Instr *prog = machine->prog;
+    uint32_t length = machine->length;
+    uint32_t r[8];
+    for (int i = 0; i < 8; i++) {
+        r[i] = machine->r[i];
+    }
+    uint32_t pc = machine->pc;
+    const Instr *ins;
+    int result;
+
+    /* between jumps the pc only moves forward, so the instructions run
+       since the last one are the distance from where the block began */
+    uint64_t count_run = 0;
+    uint32_t block = pc;
+
+    /* decided once, so a machine nobody samples only tests a local at
+       its jumps */
+    const int publishing = machine == sampled;
+    PUBLISH(pc);
+    DISPATCH();
+
+op_cmov:
+    if (r[ins->c] != 0) {
+        r[ins->a] = r[ins->b];
+    }
+    DISPATCH();
+
+op_sload:
+    CHECK_ACCESS(r[ins->b], r[ins->c]);
+    r[ins->a] = segment_load(memory_total, r[ins->b], r[ins->c]);
+    DISPATCH();
+
+op_sstore:
+    CHECK_ACCESS(r[ins->a], r[ins->b]);
+    segment_store(memory_total, r[ins->a], r[ins->b], r[ins->c]);
+    /* self-modifying code: re-decode only the word that was written.
+       The store may overwrite this very record, so it is decoded last */
+    if (r[ins->a] == 0) {
+        decode_store(cache, r[ins->b], r[ins->c]);
+        if (jit != NULL) {
+            jit_invalidate(jit, r[ins->b]);
+        }
+    }
+    DISPATCH();
+
+op_add:
+    r[ins->a] = r[ins->b] + r[ins->c];
+    DISPATCH();
+
+op_mul:
+    r[ins->a] = r[ins->b] * r[ins->c];
+    DISPATCH();
+
+op_div:
+    CHECK(r[ins->c] != 0, "division by zero");
+    r[ins->a] = r[ins->b] / r[ins->c];
+    DISPATCH();
+
+op_nand:
+    r[ins->a] = ~(r[ins->b] & r[ins->c]);
+    DISPATCH();
+
+op_map: {
+    /* rB may be rC, so the length is traced from a copy; it is not called
+       length, which CHECK reads as segment 0's */
+    uint32_t words = r[ins->c];
+    uint32_t id = map_segment(memory_total, words);
+    if (id == 0) {
+        goto over_limit;
+    }
+    r[ins->b] = id;
+    TRACE(TRACE_MAP, words, id);
+    DISPATCH();
+}
+
+op_unmap:
+    CHECK(r[ins->c] != 0, "unmapping segment 0");
+    CHECK(seg_mapped(memory_total, r[ins->c]), "segment %u is not mapped",
+          r[ins->c]);
+    unmap_segment(memory_total, r[ins->c]);
+    TRACE(TRACE_UNMAP, 0, r[ins->c]);
+    DISPATCH();
+
+op_out:
+    CHECK(r[ins->c] <= 255, "output %u is not a byte", r[ins->c]);
+    assert(r[ins->c] <= 255);
+    console_put(console, r[ins->c]);
+    TRACE(TRACE_OUT, 0, r[ins->c]);
+    DISPATCH();
+
+op_in:
+    /* the machine is about to wait for input. A host program's input
+       cannot be waited for, so the machine stops and runs this IN again
+       when it is resumed; otherwise a snapshot taken now resumes here */
+    if (console_waiting(console)) {
+        if (console->in_fd == CONSOLE_MEMORY) {
+            pc--;
+            result = RUN_WAITING;
+            goto stop;
+        }
+        snapshot_wait(memory_total, r, pc - 1);
+    }
+    /* a recorded or replayed session is told how many instructions ran
+       before this one */
+    r[ins->c] = session_active()
+              ? session_in(console, *executed + count_run + (pc - block) - 1)
+              : console_get(console);
+    TRACE(TRACE_IN, 0, r[ins->c]);
+    DISPATCH();
+
+op_loadp: {
+    /* read the target first, decoding may move the records */
+    uint32_t target = r[ins->c];
+
+    CHECK(seg_mapped(memory_total, r[ins->b]), "segment %u is not mapped",
+          r[ins->b]);
+    CHECK(target < seg_length(memory_total, r[ins->b]),
+          "jump to %u is past the end of the program (length %u)", target,
+          seg_length(memory_total, r[ins->b]));
+
+    if (stats != NULL) {
+        if (r[ins->b] != 0) {
+            stats->loadprograms++;
+        }
+        else {
+            stats->jumps++;
+        }
+    }
+
+    /* segment 0 shares the source segment copy-on-write. It only needs
+       decoding if its words are not the ones already decoded */
+    if (r[ins->b] != 0) {
+        uint32_t new_length;
+        const uint32_t *new_code = seg_loadprogram(memory_total, r[ins->b],
+                                                   &new_length);
+        if (new_code == NULL) {
+            goto over_limit;
+        }
+        length = new_length;
+        machine->generation++;
+        TRACE(TRACE_LOADPROGRAM, length, r[ins->b]);
+        if (new_code != code) {
+            if (stats != NULL) {
+                profile_close_version(stats, prog);
+            }
+            code = new_code;
+            prog = decode_program(cache, code, length);
+            if (stats != NULL) {
+                profile_open_version(stats, code, length);
+            }
+            if (jit != NULL) {
+                jit_reset(jit, prog, length);
+            }
+        }
+    }
+    count_run += pc - block;
+    TRACE(TRACE_BLOCK, pc - block, target);
+
+    /* a target past the end lands on the OP_END record */
+    pc = target < length ? target : length;
+    PUBLISH(pc);
+
+    /* every jump target is a block entry: run compiled code from here for
+       as long as it can go. Samples taken in it count against the block
+       it was entered at */
+    if (jit != NULL) {
+        pc = jit_run(jit, r, pc);
+        PUBLISH(pc);
+    }
+    block = pc;
+
+    if (count_run >= budget) {
+        result = RUN_BUDGET;
+        goto stop;
+    }
+    DISPATCH();
+}
+
+op_lv:
+    r[ins->a] = ins->value;
+    DISPATCH();
+
+/* fused sequences: run the first instruction here and chain to the
+   handler of the next */
+
+op_lv_sload:
+    r[ins->a] = ins->value;
+    CHAIN(op_sload);
+
+op_lv_sstore:
+    r[ins->a] = ins->value;
+    CHAIN(op_sstore);
+
+op_lv_add:
+    r[ins->a] = ins->value;
+    CHAIN(op_add);
+
+op_lv_nand:
+    r[ins->a] = ins->value;
+    CHAIN(op_nand);
+
+op_lv_lv:
+    r[ins->a] = ins->value;
+    CHAIN(op_lv);
+
+op_lv_loadp:
+    r[ins->a] = ins->value;
+    CHAIN(op_loadp);
+
+op_sload_lv:
+    CHECK_ACCESS(r[ins->b], r[ins->c]);
+    r[ins->a] = segment_load(memory_total, r[ins->b], r[ins->c]);
+    CHAIN(op_lv);
+
+op_sstore_lv:
+    CHECK_ACCESS(r[ins->a], r[ins->b]);
+    segment_store(memory_total, r[ins->a], r[ins->b], r[ins->c]);
+    /* a store into segment 0 may have changed the next record, so it is
+       dispatched like any other */
+    if (r[ins->a] == 0) {
+        decode_store(cache, r[ins->b], r[ins->c]);
+        if (jit != NULL) {
+            jit_invalidate(jit, r[ins->b]);
+        }
+        DISPATCH();
+    }
+    CHAIN(op_lv);
+
+op_add_lv:
+    r[ins->a] = r[ins->b] + r[ins->c];
+    CHAIN(op_lv);
+
+op_nand_nand:
+    r[ins->a] = ~(r[ins->b] & r[ins->c]);
+    CHAIN(op_nand);
+
+op_nand_add:
+    r[ins->a] = ~(r[ins->b] & r[ins->c]);
+    CHAIN(op_add);
+
+op_lv_lv_loadp:
+    r[ins->a] = ins->value;
+    ins = &prog[pc++];
+    r[ins->a] = ins->value;
+    CHAIN(op_loadp);
+
+op_invalid:
+    CHECK(0, "opcode %u is not an instruction", code[pc - 1] >> 28);
+    assert(0);
+
+fell_off:
+    CHECK(0, "ran off the end of segment 0");
+    /* the OP_END record is not an instruction */
+    pc--;
+    result = RUN_FELL_OFF;
+    machine->status = result;
+    goto stop;
+
+over_limit:
+    /* seg_mem.h has reported it; the machine stays at the instruction */
+    pc--;
+    result = RUN_LIMIT;
+    machine->status = result;
+    goto stop;
+
+op_halt:
+    result = RUN_HALTED;
+    machine->status = result;
+
+stop:
+    TRACE(TRACE_STOP, pc - block, result);
+    count_run += pc - block;
+    *executed += count_run;
+
+    machine->code = code;
+    machine->prog = prog;
+    machine->length = length;
+    for (int i = 0; i < 8; i++) {
+        machine->r[i] = r[i];
+    }
+    machine->pc = pc;
+    return result;
+}
+
+#pragma GCC diagnostic pop
+
+/*  Function: machine_free
+    Purpose: frees an engine along with the memory of its machine, and
+    finishes its profile
+    Parameters: a pointer to the engine
+    Returns: N/A
+    Expectation: the engine must not be NULL
+*/
+static void machine_free(Threaded_T *machine)
+{
+    assert(machine != NULL && *machine != NULL);
+
+    Threaded_T m = *machine;
+    double started = m->started;
+    if (m->stats != NULL) {
+        profile_close_version(m->stats, m->prog);
+        profile_memory(m->stats, m->memory_total);
+        profile_phase("execute", profile_now() - started);
+        started = profile_now();
+    }
+    if (m->seq != NULL) {
+        seqprof_print(m->seq, seqprof_output());
+        seqprof_free(&m->seq);
+    }
+    if (m->jit != NULL) {
+        jit_free(&m->jit);
+    }
+    if (m->trace != NULL) {
+        trace_close(&m->trace);
+    }
+    decode_free(&m->cache);
+    seg_free(m->memory_total);
+    if (m->stats != NULL) {
+        profile_phase("teardown", profile_now() - started);
+    }
+
+    free(m);
+    *machine = NULL;
+}
+
+/*  Function: run
+    Purpose: Executes a whole program and frees its memory
+    Parameters: the memory, with the program loaded as segment 0, the
+    console for input and output, and whether to use the JIT
+    Returns: 0 if the program halted, 1 if it ran off the end of segment 0,
+    RUN_VIOLATION if the strict engine stopped it, RUN_LIMIT if it went
+    over a memory limit
+*/
+static int run(MemSeg_T memory_total, Console_T console, int use_jit)
+{
+    Threaded_T machine = machine_new(memory_total, console, use_jit);
+    if (sample_enabled()) {
+        sampled = machine;
+        sample_start(where);
+    }
+    uint64_t executed = 0;
+    int result = machine_run(machine, RUN_UNLIMITED, &executed);
+    assert(result == RUN_HALTED || result == RUN_FELL_OFF ||
+           result == RUN_VIOLATION || result == RUN_LIMIT);
+
+    /* the sampling profiler must not look at the machine once it is gone */
+    if (machine == sampled) {
+        sample_stop();
+        sampled = NULL;
+    }
+    machine_free(&machine);
+    return result;
+}
+
+#ifdef UM_PROFILE
+
+/*  Function: execute_profiled
+    Purpose: Executes all the opcodes in the program like execute_threaded,
+    counting them for profile.h and seqprof.h
+    Parameters: the memory, with the program loaded as segment 0, and the
+    console for input and output
+    Returns: 0 if the program halted, 1 if it ran off the end of segment 0,
+    RUN_LIMIT if it went over a memory limit
+*/
+int execute_profiled(MemSeg_T memory_total, Console_T console)
+{
+    return run(memory_total, console, 0);
+}
+
+#elif defined(UM_FAST)
+
+/*  Function: execute_fast
+    Purpose: Executes all the opcodes in the program like execute_threaded,
+    with no checks at all, for trusted programs
+    Parameters: the memory, with the program loaded as segment 0, and the
+    console for input and output
+    Returns: 0 if the program halted, 1 if it ran off the end of segment 0,
+    RUN_LIMIT if it went over a memory limit
+    Expectation: the program never breaks the UM spec
+*/
+int execute_fast(MemSeg_T memory_total, Console_T console)
+{
+    return run(memory_total, console, 0);
+}
+
+#elif defined(UM_TRACE)
+
+/*  Function: execute_traced
+    Purpose: Executes all the opcodes in the program like execute_threaded,
+    recording every jump, map, unmap, loadprogram and byte of I/O to the
+    file given to trace_set_output
+    Parameters: the memory, with the program loaded as segment 0, and the
+    console for input and output
+    Returns: 0 if the program halted, 1 if it ran off the end of segment 0,
+    RUN_LIMIT if it went over a memory limit
+*/
+int execute_traced(MemSeg_T memory_total, Console_T console)
+{
+    return run(memory_total, console, 0);
+}
+
+#elif defined(UM_STRICT)
+
+/*  Function: execute_strict
+    Purpose: Executes all the opcodes in the program like execute_threaded,
+    checking each one against the UM spec. The first that breaks it is
+    reported to stderr with its pc and stops the machine.
+    Parameters: the memory, with the program loaded as segment 0, and the
+    console for input and output
+    Returns: 0 if the program halted, RUN_LIMIT if it went over a memory
+    limit, otherwise RUN_VIOLATION
+*/
+int execute_strict(MemSeg_T memory_total, Console_T console)
+{
+    return run(memory_total, console, 0);
+}
+
+#else
+
+/*  Function: execute_threaded
+    Purpose: Executes all the opcodes in the program using direct threaded
+    dispatch
+    Parameters: the memory, with the program loaded as segment 0, and the
+    console for input and output
+    Returns: 0 if the program halted, 1 if it ran off the end of segment 0,
+    RUN_LIMIT if it went over a memory limit
+*/
+int execute_threaded(MemSeg_T memory_total, Console_T console)
+{
+    return run(memory_total, console, 0);
+}
+
+/*  Function: execute_jit
+    Purpose: Executes all the opcodes in the program using direct threaded
+    dispatch, compiling hot blocks of segment 0 to x86-64 code
+    Parameters: the memory, with the program loaded as segment 0, and the
+    console for input and output
+    Returns: 0 if the program halted, 1 if it ran off the end of segment 0,
+    RUN_LIMIT if it went over a memory limit
+*/
+int execute_jit(MemSeg_T memory_total, Console_T console)
+{
+    return run(memory_total, console, 1);
+}
+
+/*  Function: threaded_new
+    Purpose: sets up the threaded engine for a program that is run a slice
+    at a time with threaded_run
+    Parameters: the memory, with the program loaded as segment 0, the
+    console for input and output, and whether to use the JIT
+    Returns: an allocated Threaded_T
+    Expectation: the memory and console must not be NULL
+*/
+Threaded_T threaded_new(MemSeg_T memory_total, Console_T console, int use_jit)
+{
+    return machine_new(memory_total, console, use_jit);
+}
+
+/*  Function: threaded_run
+    Purpose: runs the program from where the last call stopped
+    Parameters: the engine, how many instructions it may run (it stops at
+    the first jump after that many), and where to add how many it ran
+    Returns: a run_status
+    Expectation: the engine must not be NULL
+*/
+int threaded_run(Threaded_T machine, uint64_t budget, uint64_t *executed)
+{
+    return machine_run(machine, budget, executed);
+}
+
+/*  Function: threaded_jump
+    Purpose: sets the registers and program counter the engine starts from,
+    for a machine that has already run elsewhere (aot.h)
+    Parameters: the engine, the eight registers, the pc
+    Returns: N/A
+    Expectation: the engine must not be NULL and must not have run yet. A
+    pc past the end of segment 0 runs off the end.
+*/
+void threaded_jump(Threaded_T machine, const uint32_t *regs, uint32_t pc)
+{
+    assert(machine != NULL && regs != NULL);
+
+    for (int i = 0; i < 8; i++) {
+        machine->r[i] = regs[i];
+    }
+    machine->pc = pc < machine->length ? pc : machine->length;
+}
+
+/*  Function: threaded_state
+    Purpose: gives the registers and program counter the engine stopped
+    with
+    Parameters: the engine, where to put the eight registers and the pc
+    Returns: N/A
+    Expectation: the engine must not be NULL. After RUN_BUDGET the pc is
+    the target of the last jump, clamped to the length of segment 0
+*/
+void threaded_state(Threaded_T machine, uint32_t *regs, uint32_t *pc)
+{
+    assert(machine != NULL && regs != NULL && pc != NULL);
+
+    for (int i = 0; i < 8; i++) {
+        regs[i] = machine->r[i];
+    }
+    *pc = machine->pc;
+}
+
+/*  Function: threaded_free
+    Purpose: frees the engine and the memory of its machine
+    Parameters: a pointer to the engine
+    Returns: N/A
+    Expectation: the engine must not be NULL
+*/
+void threaded_free(Threaded_T *machine)
+{
+    machine_free(machine);
+}
+
+#endif
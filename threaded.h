@@ -0,0 +1,76 @@
+/**************************************************************
+ *                       threaded.h
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Interface for our threaded execution engine
+ *
+ *     Purpose: Executes a program the same way execute() does,
+ * 				but dispatches every instruction through a table
+ * 				of label addresses (computed goto) instead of a
+ * 				chain of if/else comparisons. Registers and the
+ * 				program counter are kept in locals and each
+ * 				instruction comes pre-decoded from decode.h,
+ * 				with frequent sequences fused into one record.
+ * 				execute_jit also hands every jump target to
+ * 				jit.h, which runs hot blocks as native code.
+ * 				execute_profiled is the same engine built again
+ * 				with UM_PROFILE, counting every instruction.
+ * 				execute_fast (UM_FAST) has every check compiled
+ * 				out, and execute_strict (UM_STRICT) reports the
+ * 				pc and instruction of any UM spec violation.
+ * 				execute_traced (UM_TRACE) records every block,
+ * 				map, unmap, loadprogram and I/O byte to trace.h.
+ * 				threaded_new, threaded_run and threaded_free run
+ * 				a program a slice of instructions at a time, for
+ * 				a host program embedding the machine (vm.h).
+ * 				threaded_jump starts one where translated code
+ * 				(aot.h) left off.
+ *
+ *     Success Output:
+ *              Each instruction is run successfully and the
+ * 				output is identical to the reference engine
+ *
+ *     Failure output:
+ *              A Hanson checked runtime exception is raised if
+ *              there is a problem executing any instruction
+ *
+ **************************************************************/
+
+#include <stdint.h>
+#include "seg_mem.h"
+#include "console.h"
+
+#ifndef THREADED_H
+#define THREADED_H
+
+/* why threaded_run stopped: the program halted, ran off the end of
+   segment 0, used up its budget, reached an IN with no input from the
+   host yet, broke the UM spec in the strict engine, or tried to map or
+   load a program that would take it over a memory limit. All but
+   RUN_BUDGET and RUN_WAITING are final. Final statuses are um's exit
+   status too, so RUN_LIMIT is SEG_LIMIT_EXCEEDED */
+enum run_status { RUN_HALTED = 0, RUN_FELL_OFF = 1, RUN_BUDGET, RUN_WAITING,
+    RUN_VIOLATION, RUN_LIMIT = SEG_LIMIT_EXCEEDED };
+
+/* a budget that is never used up */
+#define RUN_UNLIMITED UINT64_MAX
+
+typedef struct Threaded_T *Threaded_T;
+
+int execute_threaded(MemSeg_T memory_total, Console_T console);
+int execute_jit(MemSeg_T memory_total, Console_T console);
+int execute_profiled(MemSeg_T memory_total, Console_T console);
+int execute_fast(MemSeg_T memory_total, Console_T console);
+int execute_strict(MemSeg_T memory_total, Console_T console);
+int execute_traced(MemSeg_T memory_total, Console_T console);
+Threaded_T threaded_new(MemSeg_T memory_total, Console_T console, int use_jit);
+int threaded_run(Threaded_T machine, uint64_t budget, uint64_t *executed);
+void threaded_jump(Threaded_T machine, const uint32_t *regs, uint32_t pc);
+void threaded_state(Threaded_T machine, uint32_t *regs, uint32_t *pc);
+void threaded_free(Threaded_T *machine);
+
+#endif
+/* THREADED_H */
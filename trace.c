@@ -0,0 +1,116 @@
+/**************************************************************
+ *                         trace.c
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Implementation for our trace.h
+ *
+ *     Purpose: Creates the trace file at its full size and maps
+ * 				it shared, so every record is in the page cache
+ * 				the moment it is written and reaches the file
+ * 				even if the machine never exits cleanly.
+ *
+ *     Success Output:
+ *              A trace file with a header and the ring
+ *
+ *     Failure output:
+ *              An error message is printed and the program exits
+ *              if the trace file cannot be created
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "trace.h"
+
+/* the file the tracing engine writes to, NULL if tracing is off */
+static char *trace_path = NULL;
+
+/*  Function: fail
+    Purpose: prints why the trace file could not be written and exits
+    Parameters: the name of the file, what went wrong
+    Returns: N/A
+*/
+static void fail(const char *path, const char *reason)
+{
+    fprintf(stderr, "um: %s: %s\n", path, reason);
+    exit(EXIT_FAILURE);
+}
+
+/*  Function: trace_set_output
+    Purpose: turns on tracing, with the trace written to a file
+    Parameters: the name of the file
+    Returns: N/A
+*/
+void trace_set_output(const char *path)
+{
+    assert(path != NULL);
+
+    free(trace_path);
+    trace_path = malloc(strlen(path) + 1);
+    assert(trace_path != NULL);
+    strcpy(trace_path, path);
+}
+
+/*  Function: trace_open
+    Purpose: creates the trace file, replacing any file of that name, with
+    an empty ring
+    Parameters: none
+    Returns: the trace, or NULL if tracing is off
+*/
+Trace_T trace_open()
+{
+    if (trace_path == NULL) {
+        return NULL;
+    }
+
+    size_t size = sizeof(struct Trace_header) +
+                  (size_t) TRACE_RECORDS * sizeof(struct Trace_record);
+    int fd = open(trace_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, size) != 0) {
+        fail(trace_path, strerror(errno));
+    }
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        fail(trace_path, strerror(errno));
+    }
+    close(fd);
+
+    Trace_T trace = malloc(sizeof(struct Trace_T));
+    assert(trace != NULL);
+    trace->header = map;
+    trace->ring = (struct Trace_record *) (trace->header + 1);
+    trace->mask = TRACE_RECORDS - 1;
+    trace->size = size;
+
+    memcpy(trace->header->magic, TRACE_MAGIC, sizeof(trace->header->magic));
+    trace->header->capacity = TRACE_RECORDS;
+    trace->header->count = 0;
+
+    return trace;
+}
+
+/*  Function: trace_close
+    Purpose: unmaps the trace file, which keeps every record written
+    Parameters: a pointer to the trace
+    Returns: N/A
+    Expectation: the trace must not be NULL
+*/
+void trace_close(Trace_T *trace)
+{
+    assert(trace != NULL && *trace != NULL);
+
+    if (munmap((*trace)->header, (*trace)->size) != 0) {
+        fail(trace_path, strerror(errno));
+    }
+    free(*trace);
+    *trace = NULL;
+}
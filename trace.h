@@ -0,0 +1,123 @@
+/**************************************************************
+ *                         trace.h
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Interface for our binary execution trace
+ *
+ *     Purpose: Records what a program did in a ring of fixed
+ * 				size records in a memory-mapped file: every jump
+ * 				with the number of instructions of the block it
+ * 				ended, every map, unmap and loadprogram, and
+ * 				every byte read or written. Only the most recent
+ * 				records are kept once the ring is full, and the
+ * 				file is complete even if the machine crashes.
+ * 				Only the engine built from threaded.c with
+ * 				UM_TRACE records anything (./um -T), and it
+ * 				records blocks, not instructions, so it runs at
+ * 				close to the speed of the threaded engine.
+ * 				umtrace decodes the file. Records are in the
+ * 				byte order of the machine that wrote them.
+ *
+ *     Success Output:
+ *              A trace file with a header and the ring
+ *
+ *     Failure output:
+ *              An error message is printed and the program exits
+ *              if the trace file cannot be created
+ *
+ **************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef TRACE_H
+#define TRACE_H
+
+/* the first bytes of every trace file */
+#define TRACE_MAGIC "UMTRACE1"
+
+/* how many records the ring holds, 32 MB worth. A power of two */
+#define TRACE_RECORDS (1u << 22)
+
+/* the largest count or size a record can hold; larger ones are recorded
+   as this */
+#define TRACE_FIELD_MAX 0x0fffffffu
+
+/* what a record is of, and what its field and value hold:
+    TRACE_BLOCK        instructions since the last jump, the jump target
+    TRACE_LOADPROGRAM  length of the new segment 0, the segment loaded
+    TRACE_MAP          length of the segment, its ID
+    TRACE_UNMAP        0, the ID
+    TRACE_OUT          0, the byte written
+    TRACE_IN           0, the byte read, or all ones at end of input
+    TRACE_STOP         instructions since the last jump, the run_status
+   The first record of a run is a TRACE_BLOCK for the pc it starts at */
+enum trace_kind { TRACE_BLOCK = 0, TRACE_LOADPROGRAM, TRACE_MAP,
+    TRACE_UNMAP, TRACE_OUT, TRACE_IN, TRACE_STOP };
+
+/* this struct holds four variables
+    1. TRACE_MAGIC
+    2. How many records the ring holds
+    3. How many records have been written, of which the last capacity are
+       in the ring, the nth at n % capacity
+    4. Unused, so that the ring starts 8-byte aligned
+*/
+struct Trace_header {
+    char magic[8];
+    uint64_t capacity;
+    uint64_t count;
+    uint64_t unused;
+};
+
+/* this struct holds two variables
+    1. The enum trace_kind in the top four bits and a field below it
+    2. A value
+*/
+struct Trace_record {
+    uint32_t head;
+    uint32_t value;
+};
+
+typedef struct Trace_T *Trace_T;
+
+/* this struct holds three variables
+    1. The header and the ring, both in the mapped file
+    2. The capacity of the ring less one, to index it with
+    3. The size of the mapping
+
+   It is defined here so that the tracing engine can record inline.
+*/
+struct Trace_T {
+    struct Trace_header *header;
+    struct Trace_record *ring;
+    uint64_t mask;
+    size_t size;
+};
+
+void trace_set_output(const char *path);
+Trace_T trace_open();
+void trace_close(Trace_T *trace);
+
+/*  Function: trace_record
+    Purpose: adds a record to the ring, over the oldest once it is full
+    Parameters: the trace, the enum trace_kind, the field and the value
+    Returns: N/A
+    Expectation: the trace must not be NULL
+*/
+static inline void trace_record(Trace_T trace, int kind, uint32_t field,
+                                uint32_t value)
+{
+    uint64_t n = trace->header->count;
+    struct Trace_record *record = &trace->ring[n & trace->mask];
+
+    record->head = (uint32_t) kind << 28 |
+                   (field < TRACE_FIELD_MAX ? field : TRACE_FIELD_MAX);
+    record->value = value;
+    trace->header->count = n + 1;
+}
+
+#endif
+/* TRACE_H */
@@ -11,6 +11,73 @@
  *     for a file (typically with a name like some program.um) 
  *     that contains machine instructions for your emulator to 
  *     execute. 
+ *
+ *     Usage: um [-s] [-t] [-a] [-A] [-f] [-d] [-p file.json] [-P prefix]
+ *               [-T trace] [-S samples] [-i | -I session] [-e engine]
+ *               [-m words] [-M words] [-n segments] [-w | -W snapshot]
+ *               [-l socket | -x inputs [-c count]]
+ *               {program.um | -r snapshot}
+ *              -e threaded   computed-goto dispatch engine (default)
+ *              -e reference  original if/else dispatch loop
+ *              -e jit        threaded engine that compiles hot blocks
+ *              -e fast       threaded engine with every check compiled out
+ *              -e strict     threaded engine that reports the pc and
+ *                            instruction of any UM spec violation
+ *              -s            print memory statistics to stderr at exit
+ *              -t            print load and execution times, the peak
+ *                            resident set size and the page faults to
+ *                            stderr
+ *              -a            write output from a separate writer thread
+ *              -A            keep the segments in one arena, where an ID
+ *                            is the offset of the segment's words, rather
+ *                            than in a table (not with -w, -W or -r)
+ *              -f            print the most frequent instruction sequences
+ *              -d            run the reference and threaded engines in
+ *                            lockstep, comparing them after every block,
+ *                            and exit with status 7 at the first place
+ *                            they differ (reads all of stdin first;
+ *                            threaded engine only)
+ *              -p file.json  write opcode counts, hot pcs, loadprogram
+ *                            counts and phase times as JSON
+ *              -P prefix     write every version of segment 0 to
+ *                            prefix.N.um and its per-pc counts to
+ *                            prefix.N.prof, for umdump
+ *                            (-f, -p and -P run the profiling build of
+ *                            the threaded engine)
+ *              -T trace      record every jump, map, unmap, loadprogram
+ *                            and I/O byte to a ring in the file trace,
+ *                            for umtrace (runs the tracing build of the
+ *                            threaded engine)
+ *              -S samples    sample where the program spends CPU time
+ *                            and write it as folded stacks, for
+ *                            flamegraph.pl, by block for the threaded
+ *                            engines
+ *              -i session    record every input and the output to a file
+ *              -I session    replay a recorded session instead of reading
+ *                            stdin, checking that the output is the same
+ *                            and exiting with status 5 if it is not
+ *                            (neither works with -e jit)
+ *              -m words      stop a program that holds more words than
+ *                            this in all its segments at once
+ *              -M words      stop a program that maps a longer segment
+ *              -n segments   stop a program that maps more segments at
+ *                            once (segment 0 included); any of the three
+ *                            limits exits with status 6, or with -l ends
+ *                            just the session that went over
+ *              -w snapshot   save the machine each time it waits for input
+ *              -W snapshot   the same, appending only changed segments
+ *              -r snapshot   resume a saved machine instead of a program
+ *              -l socket     serve the program on a UNIX domain socket,
+ *                            one machine per connection, until SIGINT
+ *                            or SIGTERM (threaded engine only)
+ *              -x inputs     run the program to its first IN, then fork a
+ *                            worker from there for every file named in
+ *                            inputs, one per line, writing the output for
+ *                            file to file.out, one worker per core at a
+ *                            time (threaded engine only)
+ *              -c count      fork the workers after count instructions
+ *                            rather than at the first IN
+ *     The program may be a pipe, or - to read it from stdin.
  *     
  *     Success Output: 
  *              The UM program runs correctly and executes all
@@ -25,41 +92,302 @@
  #include <stdlib.h>
  #include <assert.h>
  #include <stdio.h>
+ #include <string.h>
+ #include <errno.h>
+ #include <unistd.h>
  #include "readfile.h"
  #include "execute_op.h"
- #include <sys/stat.h>
+ #include "threaded.h"
+ #include "seg_mem.h"
+ #include "console.h"
+ #include "snapshot.h"
+ #include "seqprof.h"
+ #include "profile.h"
+ #include "trace.h"
+ #include "session.h"
+ #include "sample.h"
+ #include "lockstep.h"
+ #include "server.h"
+ #include "explore.h"
+ #include <time.h>
+ #include <sys/resource.h>
+
+/* the execution engines that can be selected with -e */
+static const struct {
+    const char *name;
+    int (*run)(MemSeg_T memory_total, Console_T console);
+} engines[] = {
+    { "threaded",  execute_threaded },
+    { "reference", execute },
+    { "jit",       execute_jit },
+    { "fast",      execute_fast },
+    { "strict",    execute_strict },
+};
+
+static const int NUM_ENGINES = sizeof(engines) / sizeof(engines[0]);
+
+/*  Function: usage
+    Purpose: Prints how to run the program and exits with failure
+    Parameters: the name the program was invoked with
+    Returns: N/A
+*/
+static void usage(const char *progname)
+{
+    fprintf(stderr, "Usage: %s [-s] [-t] [-a] [-A] [-f] [-d] "
+            "[-p file.json] [-P prefix] [-T trace] [-S samples] "
+            "[-i | -I session] [-e engine] "
+            "[-m words] [-M words] [-n segments] [-w | -W snapshot] "
+            "[-l socket | -x inputs [-c count]] "
+            "{program.um | -r snapshot}\n",
+            progname);
+    fprintf(stderr, "Engines:");
+    for (int i = 0; i < NUM_ENGINES; i++) {
+        fprintf(stderr, " %s", engines[i].name);
+    }
+    fprintf(stderr, "\n");
+    exit(EXIT_FAILURE);
+}
+
+/*  Function: limit
+    Purpose: reads the value of a memory limit option
+    Parameters: the option's argument, the largest limit there can be, the
+    name the program was invoked with
+    Returns: the limit
+    Expectation: the argument is a positive number no larger than max,
+    otherwise the usage is printed
+*/
+static uint64_t limit(const char *arg, uint64_t max, const char *progname)
+{
+    char *end;
+    errno = 0;
+    unsigned long long value = strtoull(arg, &end, 10);
+    if (*arg == '\0' || *arg == '-' || *end != '\0' || errno != 0 ||
+        value == 0 || value > max) {
+        usage(progname);
+    }
+    return value;
+}
+
+/*  Function: now
+    Purpose: reads a monotonic clock
+    Parameters: none
+    Returns: the time in seconds
+*/
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
 
 /*  Function: main
     Purpose: Call auxillary functions 
     Parameters: int argc, char *argv
     Returns: 0 if program ran succesfully, otherwise 1.
-    Expectation: argc == 2
+    Expectation: a single program file after the options
 */
 int main(int argc, char *argv[]){
     
-    if(argc != 2) {
-        fprintf(stderr, "Error exiting failure\n");
-        exit(EXIT_FAILURE); 
+    int engine = 0;
+    int timing = 0;
+    int async = 0;
+    const char *restore = NULL;
+    int profiled = 0;
+    int traced = 0;
+    int sampled = 0;
+    int differential = 0;
+    int sessions = 0;
+    int arena = 0;
+    int snapshots = 0;
+    const char *socket_path = NULL;
+    const char *inputs = NULL;
+    uint64_t marker = EXPLORE_AT_INPUT;
+    struct Seg_limits limits = { UINT64_MAX, UINT32_MAX, UINT32_MAX };
+    int opt;
+
+    while ((opt = getopt(argc, argv, "e:stafAdp:P:T:S:i:I:m:M:n:w:W:r:l:x:c:"))
+           != -1) {
+        switch (opt) {
+        case 'e':
+            for (engine = 0; engine < NUM_ENGINES; engine++) {
+                if (strcmp(optarg, engines[engine].name) == 0) {
+                    break;
+                }
+            }
+            if (engine == NUM_ENGINES) {
+                usage(argv[0]);
+            }
+            break;
+        case 's':
+            seg_set_report(stderr);
+            break;
+        case 't':
+            timing = 1;
+            break;
+        case 'a':
+            async = 1;
+            break;
+        case 'A':
+            arena = 1;
+            break;
+        case 'f':
+            seqprof_set_output(stderr);
+            profiled = 1;
+            break;
+        case 'd':
+            differential = 1;
+            break;
+        case 'p':
+            profile_set_output(optarg);
+            profiled = 1;
+            break;
+        case 'P':
+            profile_set_dump(optarg);
+            profiled = 1;
+            break;
+        case 'T':
+            trace_set_output(optarg);
+            traced = 1;
+            break;
+        case 'S':
+            sample_set_output(optarg);
+            sampled = 1;
+            break;
+        case 'i':
+            session_set_record(optarg);
+            sessions++;
+            break;
+        case 'I':
+            session_set_replay(optarg);
+            sessions++;
+            break;
+        case 'm':
+            limits.words = limit(optarg, UINT64_MAX, argv[0]);
+            break;
+        case 'M':
+            limits.length = limit(optarg, UINT32_MAX, argv[0]);
+            break;
+        case 'n':
+            limits.segments = limit(optarg, UINT32_MAX, argv[0]);
+            break;
+        case 'w':
+        case 'W':
+            snapshot_set_writer(optarg, opt == 'W');
+            snapshots = 1;
+            break;
+        case 'r':
+            restore = optarg;
+            break;
+        case 'l':
+            socket_path = optarg;
+            break;
+        case 'x':
+            inputs = optarg;
+            break;
+        case 'c':
+            marker = limit(optarg, EXPLORE_AT_INPUT - 1, argv[0]);
+            break;
+        default:
+            usage(argv[0]);
+        }
     }
 
-    struct stat stats;
-    
-    if (stat(argv[1], &stats) == -1) {
-        fprintf(stderr, "Error exiting failure\n");
-        exit(EXIT_FAILURE);
+    if(argc - optind != (restore == NULL ? 1 : 0) ||
+       profiled + traced + sampled + differential > 1) {
+        usage(argv[0]);
     }
-    if (stats.st_size % 4 != 0) {
-        fprintf(stderr, "Error exiting faulure\n");
-        exit(EXIT_FAILURE);
+
+    /* a session needs the count of instructions run before every IN,
+       which the JIT does not keep */
+    if (sessions > 1 ||
+        (sessions == 1 && engines[engine].run == execute_jit)) {
+        usage(argv[0]);
+    }
+
+    /* lockstep starts both engines from the same program and input. It
+       steps the threaded engine a block at a time by its budget, which
+       the other builds of threaded.c do not export and the JIT does not
+       count, so -e picking any of them is refused rather than ignored */
+    if (differential && (sessions > 0 || restore != NULL ||
+                         engines[engine].run != execute_threaded)) {
+        usage(argv[0]);
+    }
+
+    /* the server runs every session a slice at a time, which only the
+       threaded engine can do, with its input from the client; the workers
+       of -x stop and start the same way, on their own input. The JIT
+       counts none of what it runs, so it could neither end a slice nor
+       stop at the marker of -c, and the workers' counts would be wrong */
+    if ((marker != EXPLORE_AT_INPUT && inputs == NULL) ||
+        (socket_path != NULL && inputs != NULL)) {
+        usage(argv[0]);
+    }
+    if ((socket_path != NULL || inputs != NULL) &&
+        (profiled + traced + sampled + differential + sessions + snapshots
+         > 0 || restore != NULL ||
+         engines[engine].run != execute_threaded)) {
+        usage(argv[0]);
+    }
+
+    /* a snapshot records the segment table, which an arena does not
+       have */
+    if (arena && (snapshots || restore != NULL)) {
+        usage(argv[0]);
+    }
+
+    seg_set_default_limits(limits);
+    seg_set_default_arena(arena);
+
+    /* Read in the file and store it as segment 0, or bring back a whole
+    saved machine */
+    double start = now();
+    MemSeg_T memory_total = seg_new();
+    uint32_t proglength;
+    if (restore != NULL) {
+        snapshot_restore(restore, memory_total);
+        proglength = seg_length(memory_total, 0);
+    }
+    else {
+        proglength = load_program(argv[optind], memory_total);
+    }
+    double loaded = now();
+
+    if (socket_path != NULL) {
+        return server_run(socket_path, memory_total);
+    }
+    if (inputs != NULL) {
+        return explore_run(memory_total, inputs, marker);
     }
 
-    int proglength = stats.st_size / 4;
-    
-    /* Read in the file and store it in a sequence */
-    UArray_T codewords = read_file(argv[1], proglength);
-    
     /* Executes the instructions read in from the file and returns whether 
     program executed correctly */
-    return execute(codewords);
+    Console_T console = console_new(STDIN_FILENO, STDOUT_FILENO, async);
+    int result = profiled ? execute_profiled(memory_total, console)
+               : traced   ? execute_traced(memory_total, console)
+               : differential ? lockstep_run(memory_total, STDIN_FILENO,
+                                             STDOUT_FILENO)
+                          : engines[engine].run(memory_total, console);
+    console_free(&console);
+    if (session_finish()) {
+        result = SESSION_DIVERGED;
+    }
+    snapshot_finish();
+    sample_finish();
+    profile_phase("load", loaded - start);
+    profile_finish();
+
+    if (timing) {
+        fprintf(stderr, "load:    %10.3f ms (%u words)\n",
+                (loaded - start) * 1e3, proglength);
+        fprintf(stderr, "execute: %10.3f ms\n", (now() - loaded) * 1e3);
+
+        /* ru_maxrss is in kilobytes on Linux */
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        fprintf(stderr, "peak rss: %9ld KB\n", usage.ru_maxrss);
+        fprintf(stderr, "faults:  %10ld minor, %ld major\n",
+                usage.ru_minflt, usage.ru_majflt);
+    }
+
+    return result;
 }
- 
\ No newline at end of file
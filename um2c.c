@@ -0,0 +1,315 @@
+/**************************************************************
+ *                          um2c.c
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Ahead-of-time translator from um programs to C
+ *
+ *     Purpose: Writes a um program out as one C function with
+ * 				a label for every basic block and return address,
+ * 				and each instruction translated into a line or
+ * 				two of C over the registers r0 to r7. Jumps whose
+ * 				targets cfg.h could work out go straight to their
+ * 				label; the rest go through a table of the labels
+ * 				by pc. Compiled against libum.a (make
+ * 				prog.native), the program runs on the same
+ * 				memory and console as ./um, and hands over to the
+ * 				threaded engine where the translation no longer
+ * 				holds: at a loadprogram of another segment, an
+ * 				invalid instruction, a jump to a pc without a
+ * 				label, or code whose words were overwritten.
+ * 				See aot.h.
+ *
+ *     Usage: um2c program.um > program.c
+ *
+ *     Success Output:
+ *              The C program on stdout
+ *
+ *     Failure output:
+ *              An error message is printed and the program exits
+ *              if the program cannot be read
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "readfile.h"
+#include "seg_mem.h"
+#include "decode.h"
+#include "cfg.h"
+
+/* the fields of an instruction, the same way decode.c reads them */
+#define OPCODE(word) ((word) >> 28)
+#define REG_A(word) (((word) >> 6) & 0x7)
+#define REG_B(word) (((word) >> 3) & 0x7)
+#define REG_C(word) ((word) & 0x7)
+#define LV_REG(word) (((word) >> 25) & 0x7)
+#define LV_VALUE(word) ((word) & 0x1ffffff)
+
+/* whether a pc starts a region of the translated code, and has a label */
+#define ENTRY(region_of, pc) \
+        ((pc) == 0 || (region_of)[pc] != (region_of)[(pc) - 1])
+
+/*  Function: usage
+    Purpose: Prints how to run the program and exits with failure
+    Parameters: the name the program was invoked with
+    Returns: N/A
+*/
+static void usage(const char *progname)
+{
+    fprintf(stderr, "Usage: %s program.um > program.c\n", progname);
+    exit(EXIT_FAILURE);
+}
+
+/*  Function: print_table
+    Purpose: prints an array of words as a C initializer, with one word
+    past the end so that no array is empty
+    Parameters: the name and type of the array, its words, how many there
+    are, and the word past the end
+    Returns: N/A
+*/
+static void print_table(const char *declaration, const uint32_t *words,
+                        uint32_t length, uint32_t last)
+{
+    printf("\n%s[LENGTH + 1] = {", declaration);
+    for (uint32_t i = 0; i < length; i++) {
+        printf("%s0x%08x,", i % 8 == 0 ? "\n    " : " ", words[i]);
+    }
+    printf("\n    0x%08x\n};\n", last);
+}
+
+/*  Function: find_regions
+    Purpose: splits the program into regions, the stretches of translated
+    code from one label to the next. Every block starts a region, and so
+    does every pc that is ever loaded as a constant, which is most likely
+    a return address or some other code pointer. Labelling only these
+    keeps the function small enough to compile; a computed jump anywhere
+    else is interpreted.
+    Parameters: the graph, where to put how many regions there are
+    Returns: a malloc'd region for every pc, and one past the end
+*/
+static uint32_t *find_regions(Cfg_T cfg, uint32_t *num_regions)
+{
+    uint32_t length = cfg->length;
+    uint32_t *region_of = calloc((size_t) length + 1, sizeof(uint32_t));
+    assert(region_of != NULL);
+
+    /* mark the entries first, then number them */
+    for (uint32_t i = 0; i < cfg->num_blocks; i++) {
+        region_of[cfg->blocks[i].start] = 1;
+    }
+    for (uint32_t pc = 0; pc < length; pc++) {
+        if (OPCODE(cfg->code[pc]) == 13 &&
+            LV_VALUE(cfg->code[pc]) < length) {
+            region_of[LV_VALUE(cfg->code[pc])] = 1;
+        }
+    }
+
+    uint32_t n = 0;
+    for (uint32_t pc = 0; pc < length; pc++) {
+        n += region_of[pc];
+        region_of[pc] = n - 1;
+    }
+    region_of[length] = n;
+
+    *num_regions = n;
+    return region_of;
+}
+
+/*  Function: print_jump
+    Purpose: prints a LOADP. Another segment is left to the interpreter;
+    targets cfg.h found are compared with and jumped to directly, and any
+    other goes through the table of labels.
+    Parameters: the graph, the block the jump ends, the instruction
+    Returns: N/A
+*/
+static void print_jump(Cfg_T cfg, const struct Block *block, uint32_t word)
+{
+    uint32_t pc = block->end - 1;
+    unsigned b = REG_B(word), c = REG_C(word);
+
+    printf("    if (r%u != 0) {\n        AOT_FALLBACK(%uu);\n    }\n", b, pc);
+    for (int s = 0; block->exit == EXIT_JUMP && s < block->num_succs; s++) {
+        uint32_t target = cfg->blocks[block->succs[s]].start;
+        printf("    if (r%u == %uu) {\n        goto L%u;\n    }\n", c,
+               target, target);
+    }
+    printf("    AOT_DISPATCH(r%u);\n", c);
+}
+
+/*  Function: print_instruction
+    Purpose: prints the C for one instruction that does not end a block
+    with a jump
+    Parameters: the pc and the word there
+    Returns: N/A
+*/
+static void print_instruction(uint32_t pc, uint32_t word)
+{
+    unsigned a = REG_A(word), b = REG_B(word), c = REG_C(word);
+
+    switch (OPCODE(word)) {
+    case 0:
+        printf("    if (r%u != 0) {\n        r%u = r%u;\n    }\n", c, a, b);
+        break;
+    case 1:
+        printf("    r%u = segment_load(memory_total, r%u, r%u);\n", a, b, c);
+        break;
+    case 2:
+        /* a store into segment 0 may overwrite translated code */
+        printf("    if (r%u == 0) {\n"
+               "        if (aot_store(aot, r%u, r%u, %uu)) {\n"
+               "            AOT_FALLBACK(%uu);\n"
+               "        }\n"
+               "    }\n"
+               "    else {\n"
+               "        segment_store(memory_total, r%u, r%u, r%u);\n"
+               "    }\n", a, b, c, pc, pc + 1, a, b, c);
+        break;
+    case 3:
+        printf("    r%u = r%u + r%u;\n", a, b, c);
+        break;
+    case 4:
+        printf("    r%u = r%u * r%u;\n", a, b, c);
+        break;
+    case 5:
+        printf("    r%u = r%u / r%u;\n", a, b, c);
+        break;
+    case 6:
+        printf("    r%u = ~(r%u & r%u);\n", a, b, c);
+        break;
+    case 7:
+        printf("    return AOT_HALTED;\n");
+        break;
+    case 8:
+        /* a map over a memory limit is left for the interpreter to stop
+           at, with rB as it was */
+        printf("    at = map_segment(memory_total, r%u);\n"
+               "    if (at == 0) {\n"
+               "        AOT_FALLBACK(%uu);\n"
+               "    }\n"
+               "    r%u = at;\n", c, pc, b);
+        break;
+    case 9:
+        printf("    unmap_segment(memory_total, r%u);\n", c);
+        break;
+    case 10:
+        printf("    assert(r%u <= 255);\n    console_put(console, r%u);\n",
+               c, c);
+        break;
+    case 11:
+        printf("    r%u = console_get(console);\n", c);
+        break;
+    case 13:
+        printf("    r%u = %uu;\n", LV_REG(word), LV_VALUE(word));
+        break;
+    default:
+        /* the interpreter reports it */
+        printf("    AOT_FALLBACK(%uu);\n", pc);
+    }
+}
+
+/*  Function: print_run
+    Purpose: prints the translated program, block by block, with a label
+    at the start of every region
+    Parameters: the graph of the program, the region of every pc
+    Returns: N/A
+*/
+static void print_run(Cfg_T cfg, const uint32_t *region_of)
+{
+    char text[96];
+
+    printf("\nstatic int run(Aot_T aot)\n{\n"
+           "    static void *const table[LENGTH + 1] = {");
+    for (uint32_t pc = 0; pc < cfg->length; pc++) {
+        printf("%s", pc % 4 == 0 ? "\n        " : " ");
+        if (ENTRY(region_of, pc)) {
+            printf("&&L%u,", pc);
+        }
+        else {
+            printf("&&fallback,");
+        }
+    }
+    printf("\n        &&fallback\n    };\n"
+           "    MemSeg_T memory_total = aot->memory_total;\n"
+           "    Console_T console = aot->console;\n"
+           "    uint32_t r0 = 0, r1 = 0, r2 = 0, r3 = 0;\n"
+           "    uint32_t r4 = 0, r5 = 0, r6 = 0, r7 = 0;\n"
+           "    uint32_t at;\n"
+           "    (void) table;\n"
+           "    (void) memory_total;\n"
+           "    (void) console;\n");
+
+    for (uint32_t i = 0; i < cfg->num_blocks; i++) {
+        const struct Block *block = &cfg->blocks[i];
+
+        printf("\n    /* block %u */\n", i);
+        for (uint32_t pc = block->start; pc < block->end; pc++) {
+            uint32_t word = cfg->code[pc];
+            if (ENTRY(region_of, pc)) {
+                printf("L%u:\n    AOT_ENTER(%u, %uu);\n", pc, region_of[pc],
+                       pc);
+            }
+            decode_text(word, text, sizeof(text));
+            printf("    /* %u: %s */\n", pc, text);
+            if (OPCODE(word) == 12) {
+                print_jump(cfg, block, word);
+            }
+            else {
+                print_instruction(pc, word);
+            }
+        }
+    }
+
+    /* running off the end is reported by the interpreter */
+    printf("\n    AOT_FALLBACK(LENGTH);\n\n"
+           "fallback:\n"
+           "    aot->regs[0] = r0;\n    aot->regs[1] = r1;\n"
+           "    aot->regs[2] = r2;\n    aot->regs[3] = r3;\n"
+           "    aot->regs[4] = r4;\n    aot->regs[5] = r5;\n"
+           "    aot->regs[6] = r6;\n    aot->regs[7] = r7;\n"
+           "    aot->pc = at;\n"
+           "    return AOT_INTERPRET;\n}\n");
+}
+
+/*  Function: main
+    Purpose: reads a program and prints it translated to C
+    Parameters: int argc, char *argv
+    Returns: 0 if the program could be read, otherwise 1
+    Expectation: a single program file
+*/
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        usage(argv[0]);
+    }
+
+    /* the program is loaded the same way um loads it */
+    MemSeg_T memory_total = seg_new();
+    uint32_t length = load_program(argv[1], memory_total);
+    const uint32_t *code = get_segment(memory_total, 0, &length);
+    Cfg_T cfg = cfg_new(code, length);
+    uint32_t num_regions;
+    uint32_t *region_of = find_regions(cfg, &num_regions);
+
+    printf("/* %s translated by um2c: %u words, %u blocks */\n\n"
+           "#include \"aot.h\"\n\n"
+           "/* label addresses and computed goto are GNU extensions */\n"
+           "#pragma GCC diagnostic ignored \"-Wpedantic\"\n\n"
+           "#define LENGTH %uu\n#define REGIONS %uu\n", argv[1], length,
+           cfg->num_blocks, length, num_regions);
+    print_table("static const uint32_t image", code, length, 0);
+    print_table("static const uint32_t region_of", region_of, length,
+                num_regions);
+    print_run(cfg, region_of);
+    printf("\nint main(int argc, char *argv[])\n{\n"
+           "    return aot_main(argc, argv, image, LENGTH, region_of, REGIONS,"
+           " run);\n}\n");
+
+    free(region_of);
+    cfg_free(&cfg);
+    seg_free(memory_total);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,379 @@
+/**************************************************************
+ *                        umdump.c
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Disassembler and control-flow analyzer for um programs
+ *
+ *     Purpose: Prints a um program one basic block at a time,
+ * 				with every instruction disassembled and every
+ * 				block's jump targets, or its control-flow graph
+ * 				in Graphviz dot form, or a summary of its
+ * 				hottest blocks and loops. Given the per-pc counts
+ * 				um -P writes, every instruction, block and loop
+ * 				is shown with how often it ran.
+ *
+ *     Usage: umdump [-p prefix.N.prof] [-t count | -g] program.um
+ *              -p file   lay the counts of a um -P profile over the
+ *                        program, which must be the matching
+ *                        prefix.N.um (or the image itself for N = 0)
+ *              -t count  print the count hottest blocks and loops
+ *                        instead of the listing
+ *              -g        print the control-flow graph for dot
+ *
+ *     Success Output:
+ *              The listing, summary or graph on stdout
+ *
+ *     Failure output:
+ *              An error message is printed and the program exits
+ *              if the program or the profile cannot be read, or
+ *              the profile does not match the program
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "readfile.h"
+#include "seg_mem.h"
+#include "decode.h"
+#include "cfg.h"
+
+/* one block or loop and the count it is ranked by */
+struct Ranked {
+    uint32_t index;
+    uint64_t key;
+};
+
+/*  Function: usage
+    Purpose: Prints how to run the program and exits with failure
+    Parameters: the name the program was invoked with
+    Returns: N/A
+*/
+static void usage(const char *progname)
+{
+    fprintf(stderr, "Usage: %s [-p prefix.N.prof] [-t count | -g] "
+            "program.um\n", progname);
+    exit(EXIT_FAILURE);
+}
+
+/*  Function: fail
+    Purpose: prints why a file could not be used and exits
+    Parameters: the name of the file, what went wrong
+    Returns: N/A
+*/
+static void fail(const char *file_name, const char *reason)
+{
+    fprintf(stderr, "umdump: %s: %s\n", file_name, reason);
+    exit(EXIT_FAILURE);
+}
+
+/*  Function: read_counts
+    Purpose: reads a profile written by um -P: a "pc count" line for every
+    pc that ran, after comment lines starting with #
+    Parameters: the name of the file, the length of the program
+    Returns: a calloc'd count for every pc of the program
+*/
+static uint64_t *read_counts(const char *file_name, uint32_t length)
+{
+    FILE *file = fopen(file_name, "r");
+    if (file == NULL) {
+        fail(file_name, strerror(errno));
+    }
+
+    uint64_t *counts = calloc((size_t) length + 1, sizeof(uint64_t));
+    assert(counts != NULL);
+
+    char line[128];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        unsigned pc;
+        unsigned long long count;
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        if (sscanf(line, "%u %llu", &pc, &count) != 2) {
+            fail(file_name, "not a um -P profile");
+        }
+        if (pc >= length) {
+            fail(file_name, "has a pc past the end of the program");
+        }
+        counts[pc] = count;
+    }
+    fclose(file);
+
+    return counts;
+}
+
+/*  Function: share
+    Purpose: gives a count as a percentage of all instructions run
+    Parameters: the count, the total
+    Returns: the percentage, 0 without a profile
+*/
+static double share(uint64_t count, uint64_t total)
+{
+    return total == 0 ? 0 : 100.0 * count / total;
+}
+
+/*  Function: print_exit
+    Purpose: prints where a block goes when it is done
+    Parameters: the graph, the block
+    Returns: N/A
+*/
+static void print_exit(Cfg_T cfg, const struct Block *block)
+{
+    printf(";   ");
+    switch (block->exit) {
+    case EXIT_FALL:
+        if (block->num_succs == 0) {
+            printf("runs off the end of the program\n");
+            return;
+        }
+        printf("falls into");
+        break;
+    case EXIT_JUMP:
+        printf("jumps to");
+        break;
+    case EXIT_COMPUTED:
+        printf("computed jump\n");
+        return;
+    case EXIT_LOADPROGRAM:
+        printf("loads another segment\n");
+        return;
+    case EXIT_HALT:
+        printf("halts\n");
+        return;
+    default:
+        printf("invalid instruction\n");
+        return;
+    }
+    for (int s = 0; s < block->num_succs; s++) {
+        printf("%s pc %u", s ? "," : "",
+               cfg->blocks[block->succs[s]].start);
+    }
+    printf("\n");
+}
+
+/*  Function: print_listing
+    Purpose: prints every block, its instructions and where it goes
+    Parameters: the graph, the count of every pc or NULL, the total count
+    Returns: N/A
+*/
+static void print_listing(Cfg_T cfg, const uint64_t *counts, uint64_t total)
+{
+    char text[96];
+
+    for (uint32_t i = 0; i < cfg->num_blocks; i++) {
+        const struct Block *block = &cfg->blocks[i];
+
+        printf("\n; block %u, pc %u..%u%s", i, block->start, block->end - 1,
+               block->loop ? ", loop header" : "");
+        if (counts != NULL) {
+            printf(", entered %llu times, %.2f%% of instructions",
+                   (unsigned long long) block->entries,
+                   share(block->instructions, total));
+        }
+        printf("\n");
+
+        for (uint32_t pc = block->start; pc < block->end; pc++) {
+            decode_text(cfg->code[pc], text, sizeof(text));
+            if (counts != NULL) {
+                printf("%8u  %08x  %12llu  %s\n", pc, cfg->code[pc],
+                       (unsigned long long) counts[pc], text);
+            }
+            else {
+                printf("%8u  %08x  %s\n", pc, cfg->code[pc], text);
+            }
+        }
+        print_exit(cfg, block);
+    }
+}
+
+/*  Function: by_key
+    Purpose: orders ranked entries by descending key, then by index
+    Parameters: two struct Ranked
+    Returns: negative, zero or positive, as qsort expects
+*/
+static int by_key(const void *x, const void *y)
+{
+    const struct Ranked *a = x, *b = y;
+    if (a->key != b->key) {
+        return a->key < b->key ? 1 : -1;
+    }
+    return a->index < b->index ? -1 : a->index > b->index;
+}
+
+/*  Function: print_summary
+    Purpose: prints counts of the graph and its hottest blocks and loops,
+    or its longest without a profile
+    Parameters: the graph, whether there is a profile, the total count,
+    how many blocks and loops to print
+    Returns: N/A
+*/
+static void print_summary(Cfg_T cfg, int profiled, uint64_t total,
+                          uint32_t top)
+{
+    uint32_t jumps = 0, computed = 0;
+    for (uint32_t i = 0; i < cfg->num_blocks; i++) {
+        jumps += cfg->blocks[i].exit == EXIT_JUMP;
+        computed += cfg->blocks[i].exit == EXIT_COMPUTED;
+    }
+    printf("%u words, %u blocks, %u loops, %u jumps with known targets, "
+           "%u computed\n", cfg->length, cfg->num_blocks, cfg->num_loops,
+           jumps, computed);
+    if (profiled) {
+        printf("%llu instructions ran\n", (unsigned long long) total);
+    }
+
+    uint32_t most = cfg->num_blocks > cfg->num_loops ? cfg->num_blocks
+                                                     : cfg->num_loops;
+    struct Ranked *ranked = malloc((most + 1) * sizeof(struct Ranked));
+    assert(ranked != NULL);
+
+    for (uint32_t i = 0; i < cfg->num_blocks; i++) {
+        const struct Block *block = &cfg->blocks[i];
+        ranked[i].index = i;
+        ranked[i].key = profiled ? block->instructions
+                                 : block->end - block->start;
+    }
+    qsort(ranked, cfg->num_blocks, sizeof(struct Ranked), by_key);
+    printf("\n%s blocks\n%8s %8s %8s %14s %14s %7s\n",
+           profiled ? "hottest" : "longest", "block", "pc", "length",
+           "entries", "instructions", "share");
+    for (uint32_t r = 0; r < top && r < cfg->num_blocks; r++) {
+        const struct Block *block = &cfg->blocks[ranked[r].index];
+        printf("%8u %8u %8u %14llu %14llu %6.2f%%%s\n", ranked[r].index,
+               block->start, block->end - block->start,
+               (unsigned long long) block->entries,
+               (unsigned long long) block->instructions,
+               share(block->instructions, total),
+               block->loop ? "  loop header" : "");
+    }
+
+    for (uint32_t l = 0; l < cfg->num_loops; l++) {
+        ranked[l].index = l;
+        ranked[l].key = profiled ? cfg->loops[l].instructions
+                                 : cfg->loops[l].num_blocks;
+    }
+    qsort(ranked, cfg->num_loops, sizeof(struct Ranked), by_key);
+    printf("\n%s loops\n%8s %8s %8s %14s %7s\n",
+           profiled ? "hottest" : "largest", "header", "pc", "blocks",
+           "instructions", "share");
+    for (uint32_t r = 0; r < top && r < cfg->num_loops; r++) {
+        const struct Loop *loop = &cfg->loops[ranked[r].index];
+        printf("%8u %8u %8u %14llu %6.2f%%\n", loop->header,
+               cfg->blocks[loop->header].start, loop->num_blocks,
+               (unsigned long long) loop->instructions,
+               share(loop->instructions, total));
+    }
+
+    free(ranked);
+}
+
+/*  Function: print_dot
+    Purpose: prints the control-flow graph for Graphviz. With a profile,
+    every block is shaded by the share of instructions it ran.
+    Parameters: the graph, whether there is a profile, the total count
+    Returns: N/A
+*/
+static void print_dot(Cfg_T cfg, int profiled, uint64_t total)
+{
+    uint64_t hottest = 1;
+    for (uint32_t i = 0; i < cfg->num_blocks; i++) {
+        if (cfg->blocks[i].instructions > hottest) {
+            hottest = cfg->blocks[i].instructions;
+        }
+    }
+
+    printf("digraph cfg {\n    node [shape=box, fontname=monospace];\n");
+    for (uint32_t i = 0; i < cfg->num_blocks; i++) {
+        const struct Block *block = &cfg->blocks[i];
+        printf("    b%u [label=\"pc %u..%u", i, block->start,
+               block->end - 1);
+        if (profiled) {
+            printf("\\n%llu entries\\n%.2f%%",
+                   (unsigned long long) block->entries,
+                   share(block->instructions, total));
+        }
+        printf("\"%s", block->loop ? ", peripheries=2" : "");
+        if (profiled && block->instructions > 0) {
+            printf(", style=filled, fillcolor=\"0.0 %.3f 1.0\"",
+                   (double) block->instructions / hottest);
+        }
+        printf("];\n");
+        for (int s = 0; s < block->num_succs; s++) {
+            printf("    b%u -> b%u;\n", i, block->succs[s]);
+        }
+    }
+    printf("}\n");
+}
+
+/*  Function: main
+    Purpose: reads the program and the profile and prints what was asked
+    Parameters: int argc, char *argv
+    Returns: 0 if the program could be read, otherwise 1
+    Expectation: a single program file after the options
+*/
+int main(int argc, char *argv[])
+{
+    const char *profile = NULL;
+    long top = 0;
+    int graph = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:t:g")) != -1) {
+        switch (opt) {
+        case 'p':
+            profile = optarg;
+            break;
+        case 't':
+            top = strtol(optarg, NULL, 10);
+            if (top <= 0) {
+                usage(argv[0]);
+            }
+            break;
+        case 'g':
+            graph = 1;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (argc - optind != 1 || (graph && top > 0)) {
+        usage(argv[0]);
+    }
+
+    /* the program is loaded the same way um loads it */
+    MemSeg_T memory_total = seg_new();
+    uint32_t length = load_program(argv[optind], memory_total);
+    const uint32_t *code = get_segment(memory_total, 0, &length);
+    Cfg_T cfg = cfg_new(code, length);
+
+    uint64_t *counts = NULL;
+    uint64_t total = 0;
+    if (profile != NULL) {
+        counts = read_counts(profile, length);
+        for (uint32_t pc = 0; pc < length; pc++) {
+            total += counts[pc];
+        }
+        cfg_counts(cfg, counts);
+    }
+
+    if (graph) {
+        print_dot(cfg, counts != NULL, total);
+    }
+    else if (top > 0) {
+        print_summary(cfg, counts != NULL, total, top);
+    }
+    else {
+        print_listing(cfg, counts, total);
+    }
+
+    free(counts);
+    cfg_free(&cfg);
+    seg_free(memory_total);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,346 @@
+/**************************************************************
+ *                        umtrace.c
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Decoder for the traces um -T writes
+ *
+ *     Purpose: Prints the records kept in a trace, oldest
+ * 				first, one per line, or a summary of them: how
+ * 				many blocks and instructions they cover, the maps,
+ * 				unmaps, loadprograms and I/O, and the jump
+ * 				targets that were hit the most. Targets are
+ * 				shown as version.pc, where the version counts
+ * 				the loadprograms of another segment since the
+ * 				oldest record kept.
+ *
+ *     Usage: umtrace [-s] [-n count] trace
+ *              -s        print a summary instead of the records
+ *              -n count  look at the last count records only
+ *
+ *     Success Output:
+ *              The records or the summary on stdout
+ *
+ *     Failure output:
+ *              An error message is printed and the program exits
+ *              if the trace cannot be read or is not a trace
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "trace.h"
+
+/* how many of the most hit jump targets the summary prints */
+#define TOP_TARGETS 10
+
+/* one jump target of the summary, and how many times it was hit */
+struct Target {
+    uint64_t key;
+    uint64_t hits;
+};
+
+/*  Function: usage
+    Purpose: Prints how to run the program and exits with failure
+    Parameters: the name the program was invoked with
+    Returns: N/A
+*/
+static void usage(const char *progname)
+{
+    fprintf(stderr, "Usage: %s [-s] [-n count] trace\n", progname);
+    exit(EXIT_FAILURE);
+}
+
+/*  Function: fail
+    Purpose: prints why the trace could not be used and exits
+    Parameters: the name of the file, what went wrong
+    Returns: N/A
+*/
+static void fail(const char *path, const char *reason)
+{
+    fprintf(stderr, "umtrace: %s: %s\n", path, reason);
+    exit(EXIT_FAILURE);
+}
+
+/*  Function: map_trace
+    Purpose: maps a trace file and checks that it is one
+    Parameters: the name of the file, where to put the size of the mapping
+    Returns: the header, followed by the ring
+*/
+static const struct Trace_header *map_trace(const char *path, size_t *size)
+{
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        fail(path, strerror(errno));
+    }
+    if ((size_t) info.st_size < sizeof(struct Trace_header)) {
+        fail(path, "not a um trace");
+    }
+
+    *size = info.st_size;
+    const struct Trace_header *header = mmap(NULL, *size, PROT_READ,
+                                             MAP_PRIVATE, fd, 0);
+    if (header == MAP_FAILED) {
+        fail(path, strerror(errno));
+    }
+    close(fd);
+
+    if (memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->capacity == 0 ||
+        (header->capacity & (header->capacity - 1)) != 0 ||
+        (*size - sizeof(struct Trace_header)) / sizeof(struct Trace_record)
+            < header->capacity) {
+        fail(path, "not a um trace");
+    }
+    return header;
+}
+
+/*  Function: print_field
+    Purpose: prints a count or size, which is at least the field if the
+    field is full
+    Parameters: the field
+    Returns: N/A
+*/
+static void print_field(uint32_t field)
+{
+    printf(field == TRACE_FIELD_MAX ? "%u or more" : "%u", field);
+}
+
+/*  Function: print_byte
+    Purpose: prints a byte of I/O, and the character if it is printable
+    Parameters: the byte
+    Returns: N/A
+*/
+static void print_byte(uint32_t byte)
+{
+    printf("%u", byte);
+    if (byte >= 32 && byte < 127) {
+        printf(" '%c'", byte);
+    }
+}
+
+/*  Function: print_record
+    Purpose: prints one record on a line
+    Parameters: its number in the trace, the record
+    Returns: N/A
+*/
+static void print_record(uint64_t n, struct Trace_record record)
+{
+    static const char *const statuses[] = {
+        "halted", "ran off the end", "budget used up", "waiting for input",
+        "violated the spec"
+    };
+    uint32_t field = record.head & TRACE_FIELD_MAX;
+    uint32_t value = record.value;
+
+    printf("%12llu  ", (unsigned long long) n);
+    switch (record.head >> 28) {
+    case TRACE_BLOCK:
+        printf("block        pc %u after ", value);
+        print_field(field);
+        printf(" instructions");
+        break;
+    case TRACE_LOADPROGRAM:
+        printf("loadprogram  segment %u, ", value);
+        print_field(field);
+        printf(" words");
+        break;
+    case TRACE_MAP:
+        printf("map          segment %u, ", value);
+        print_field(field);
+        printf(" words");
+        break;
+    case TRACE_UNMAP:
+        printf("unmap        segment %u", value);
+        break;
+    case TRACE_OUT:
+        printf("out          ");
+        print_byte(value);
+        break;
+    case TRACE_IN:
+        printf("in           ");
+        if (value == ~(uint32_t) 0) {
+            printf("end of input");
+        }
+        else {
+            print_byte(value);
+        }
+        break;
+    case TRACE_STOP:
+        printf("stop         %s after ",
+               value < sizeof(statuses) / sizeof(statuses[0])
+               ? statuses[value] : "unknown status");
+        print_field(field);
+        printf(" instructions");
+        break;
+    default:
+        printf("unknown      %08x %08x", record.head, value);
+    }
+    printf("\n");
+}
+
+/*  Function: by_key
+    Purpose: orders targets by key, for counting equal keys
+    Parameters: two struct Target
+    Returns: negative, zero or positive, as qsort expects
+*/
+static int by_key(const void *x, const void *y)
+{
+    const struct Target *a = x, *b = y;
+    return a->key < b->key ? -1 : a->key > b->key;
+}
+
+/*  Function: by_hits
+    Purpose: orders targets by descending hits, then by key
+    Parameters: two struct Target
+    Returns: negative, zero or positive, as qsort expects
+*/
+static int by_hits(const void *x, const void *y)
+{
+    const struct Target *a = x, *b = y;
+    if (a->hits != b->hits) {
+        return a->hits < b->hits ? 1 : -1;
+    }
+    return by_key(x, y);
+}
+
+/*  Function: print_summary
+    Purpose: prints what the records cover and the most hit jump targets
+    Parameters: the ring, its mask, the first record and how many to read
+    Returns: N/A
+*/
+static void print_summary(const struct Trace_record *ring, uint64_t mask,
+                          uint64_t first, uint64_t kept)
+{
+    uint64_t kinds[TRACE_STOP + 1] = { 0 };
+    uint64_t instructions = 0, version = 0, num_targets = 0;
+    struct Target *targets = malloc((kept + 1) * sizeof(struct Target));
+    assert(targets != NULL);
+
+    for (uint64_t n = first; n < first + kept; n++) {
+        struct Trace_record record = ring[n & mask];
+        unsigned kind = record.head >> 28;
+        if (kind > TRACE_STOP) {
+            continue;
+        }
+        kinds[kind]++;
+        if (kind == TRACE_BLOCK || kind == TRACE_STOP) {
+            instructions += record.head & TRACE_FIELD_MAX;
+        }
+        if (kind == TRACE_LOADPROGRAM) {
+            version++;
+        }
+        if (kind == TRACE_BLOCK) {
+            targets[num_targets].key = version << 32 | record.value;
+            targets[num_targets++].hits = 1;
+        }
+    }
+
+    printf("%llu blocks entered, %llu instructions\n"
+           "%llu loadprograms, %llu maps, %llu unmaps\n"
+           "%llu bytes in, %llu bytes out\n",
+           (unsigned long long) kinds[TRACE_BLOCK],
+           (unsigned long long) instructions,
+           (unsigned long long) kinds[TRACE_LOADPROGRAM],
+           (unsigned long long) kinds[TRACE_MAP],
+           (unsigned long long) kinds[TRACE_UNMAP],
+           (unsigned long long) kinds[TRACE_IN],
+           (unsigned long long) kinds[TRACE_OUT]);
+    if (kinds[TRACE_STOP] == 0) {
+        printf("the machine did not stop cleanly\n");
+    }
+
+    /* equal targets are next to each other once sorted, and are merged
+       into the first of them */
+    qsort(targets, num_targets, sizeof(struct Target), by_key);
+    uint64_t unique = 0;
+    for (uint64_t i = 0; i < num_targets; i++) {
+        if (unique > 0 && targets[unique - 1].key == targets[i].key) {
+            targets[unique - 1].hits++;
+        }
+        else {
+            targets[unique++] = targets[i];
+        }
+    }
+    qsort(targets, unique, sizeof(struct Target), by_hits);
+
+    printf("\nmost hit jump targets\n%14s %7s  %s\n", "hits", "share",
+           "version.pc");
+    for (uint64_t i = 0; i < unique && i < TOP_TARGETS; i++) {
+        printf("%14llu %6.2f%%  %llu.%llu\n",
+               (unsigned long long) targets[i].hits,
+               100.0 * targets[i].hits / kinds[TRACE_BLOCK],
+               (unsigned long long) (targets[i].key >> 32),
+               (unsigned long long) (targets[i].key & 0xffffffff));
+    }
+
+    free(targets);
+}
+
+/*  Function: main
+    Purpose: reads a trace and prints its records or a summary
+    Parameters: int argc, char *argv
+    Returns: 0 if the trace could be read, otherwise 1
+    Expectation: a single trace file after the options
+*/
+int main(int argc, char *argv[])
+{
+    int summary = 0;
+    long long last = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "sn:")) != -1) {
+        switch (opt) {
+        case 's':
+            summary = 1;
+            break;
+        case 'n':
+            last = strtoll(optarg, NULL, 10);
+            if (last <= 0) {
+                usage(argv[0]);
+            }
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (argc - optind != 1) {
+        usage(argv[0]);
+    }
+
+    size_t size;
+    const struct Trace_header *header = map_trace(argv[optind], &size);
+    const struct Trace_record *ring =
+        (const struct Trace_record *) (header + 1);
+    uint64_t count = header->count;
+    uint64_t kept = count < header->capacity ? count : header->capacity;
+    if (last > 0 && (uint64_t) last < kept) {
+        kept = last;
+    }
+    uint64_t first = count - kept;
+
+    printf("# %llu records written, %llu read from record %llu\n",
+           (unsigned long long) count, (unsigned long long) kept,
+           (unsigned long long) first);
+    if (summary) {
+        print_summary(ring, header->capacity - 1, first, kept);
+    }
+    else {
+        for (uint64_t n = first; n < count; n++) {
+            print_record(n, ring[n & (header->capacity - 1)]);
+        }
+    }
+
+    munmap((void *) header, size);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,197 @@
+/**************************************************************
+ *                         vm.c
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Implementation for our vm.h
+ *
+ *     Purpose: Lets a host program run any number of machines
+ * 				side by side. Each machine is its own memory, a
+ * 				console made with CONSOLE_MEMORY and a threaded
+ * 				engine, which keeps its registers and program
+ * 				counter between slices. Nothing is shared
+ * 				between machines.
+ *
+ *     Success Output:
+ *              Each machine produces the same output as ./um
+ *              given the same input
+ *
+ *     Failure output:
+ *              A Hanson checked runtime exception is raised if
+ *              a machine runs an invalid instruction or any
+ *              function is called with invalid arguments. A
+ *              program that goes over the memory limits given to
+ *              vm_set_limits is reported to stderr and vm_run
+ *              returns VM_LIMIT.
+ *
+ **************************************************************/
+
+#include <stdlib.h>
+#include <assert.h>
+#include "vm.h"
+#include "seg_mem.h"
+#include "console.h"
+#include "readfile.h"
+#include "threaded.h"
+
+/* this struct holds four variables
+    1. The memory of the machine, which the engine frees
+    2. The console its input is fed to and output drained from
+    3. The threaded engine running it
+    4. The number of instructions it has run so far
+*/
+struct Vm_T {
+    MemSeg_T memory_total;
+    Console_T console;
+    Threaded_T engine;
+    uint64_t instructions;
+};
+
+/*  Function: vm_new
+    Purpose: creates a machine, ready to run its first instruction
+    Parameters: the program, as the bytes of a .um file, and how many bytes
+    there are
+    Returns: an allocated Vm_T, or NULL if the image is not a whole number
+    of instructions
+    Expectation: the image is only read during the call
+*/
+Vm_T vm_new(const void *image, size_t size)
+{
+    assert(image != NULL || size == 0);
+
+    if (size % 4 != 0 || size / 4 > UINT32_MAX) {
+        return NULL;
+    }
+
+    Vm_T vm = malloc(sizeof(struct Vm_T));
+    assert(vm != NULL);
+
+    vm->memory_total = seg_new();
+    load_image(image, size, vm->memory_total);
+    vm->console = console_new(CONSOLE_MEMORY, CONSOLE_MEMORY, 0);
+    vm->engine = threaded_new(vm->memory_total, vm->console, 0);
+    vm->instructions = 0;
+
+    return vm;
+}
+
+/*  Function: vm_free
+    Purpose: frees a machine, whether or not it has halted. Output not yet
+    drained is lost.
+    Parameters: a pointer to the machine
+    Returns: N/A
+    Expectation: the machine must not be NULL
+*/
+void vm_free(Vm_T *vm)
+{
+    assert(vm != NULL && *vm != NULL);
+
+    threaded_free(&(*vm)->engine);
+    console_free(&(*vm)->console);
+    free(*vm);
+    *vm = NULL;
+}
+
+/*  Function: vm_run
+    Purpose: runs a machine from where it last stopped, until it halts,
+    waits for input or has used up its budget
+    Parameters: the machine, and how many instructions it may run. The
+    budget is checked at jumps, so a slice ends at the first jump after
+    that many instructions; VM_UNLIMITED runs until the machine halts or
+    waits.
+    Returns: why it stopped
+    Expectation: the machine must not be NULL
+*/
+enum vm_status vm_run(Vm_T vm, uint64_t budget)
+{
+    assert(vm != NULL);
+
+    switch (threaded_run(vm->engine, budget, &vm->instructions)) {
+    case RUN_HALTED:
+        return VM_HALTED;
+    case RUN_FELL_OFF:
+        return VM_FELL_OFF;
+    case RUN_BUDGET:
+        return VM_BUDGET;
+    case RUN_LIMIT:
+        return VM_LIMIT;
+    default:
+        return VM_WAITING;
+    }
+}
+
+/*  Function: vm_input
+    Purpose: gives a machine more input, after any it has not read yet
+    Parameters: the machine, the bytes, how many there are
+    Returns: N/A
+    Expectation: the machine must not be NULL and its input must not have
+    been ended
+*/
+void vm_input(Vm_T vm, const void *bytes, size_t count)
+{
+    assert(vm != NULL);
+
+    console_feed(vm->console, bytes, count);
+}
+
+/*  Function: vm_end_input
+    Purpose: ends a machine's input: once it has read every byte already
+    given to it, IN puts all ones in its register
+    Parameters: the machine
+    Returns: N/A
+    Expectation: the machine must not be NULL
+*/
+void vm_end_input(Vm_T vm)
+{
+    assert(vm != NULL);
+
+    console_end_input(vm->console);
+}
+
+/*  Function: vm_output
+    Purpose: takes the output a machine has written so far, oldest first
+    Parameters: the machine, where to copy it, and room for how many bytes
+    Returns: the number of bytes copied, 0 once there are none left
+    Expectation: the machine must not be NULL
+*/
+size_t vm_output(Vm_T vm, void *buffer, size_t size)
+{
+    assert(vm != NULL);
+
+    return console_drain(vm->console, buffer, size);
+}
+
+/*  Function: vm_instructions
+    Purpose: gives how many instructions a machine has run
+    Parameters: the machine
+    Returns: the count over every vm_run so far
+    Expectation: the machine must not be NULL
+*/
+uint64_t vm_instructions(Vm_T vm)
+{
+    assert(vm != NULL);
+
+    return vm->instructions;
+}
+
+/*  Function: vm_set_limits
+    Purpose: caps the memory a machine's program may hold. A map or
+    loadprogram that would go over a limit is reported to stderr and
+    refused, and vm_run returns VM_LIMIT for good, instead of the machine
+    growing until the OOM killer takes down the host
+    Parameters: the machine, the most words all segments may hold, the
+    most words one segment may hold, the most segments mapped at once
+    (UINT64_MAX or UINT32_MAX for no limit)
+    Returns: N/A
+    Expectation: the machine must not be NULL
+*/
+void vm_set_limits(Vm_T vm, uint64_t words, uint32_t length,
+                   uint32_t segments)
+{
+    assert(vm != NULL);
+
+    struct Seg_limits limits = { words, length, segments };
+    seg_set_limits(vm->memory_total, limits);
+}
@@ -0,0 +1,63 @@
+/**************************************************************
+ *                         vm.h
+ *
+ *     Assignment: Homework 6 - Universal Machine
+ *     Authors: Archit Jain (ajain08), Jahansheer Khan (jkhan03)
+ *     Date: Nov 21, 2021
+ *
+ *     Interface for embedding the machine in another program
+ *
+ *     Purpose: Lets a host program run any number of machines
+ * 				side by side. Each is created from a program
+ * 				image in memory and run a slice of instructions
+ * 				at a time; its input is fed and its output is
+ * 				drained through buffers, so a machine never
+ * 				touches stdin or stdout and never blocks. The
+ * 				instruction budget of a slice is only checked
+ * 				at jumps, so slicing costs the threaded engine
+ * 				nothing between them.
+ *
+ *     Success Output:
+ *              Each machine produces the same output as ./um
+ *              given the same input
+ *
+ *     Failure output:
+ *              A Hanson checked runtime exception is raised if
+ *              a machine runs an invalid instruction or any
+ *              function is called with invalid arguments. A
+ *              program that goes over the memory limits given to
+ *              vm_set_limits is reported to stderr and its
+ *              machine stops with VM_LIMIT.
+ *
+ **************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef VM_H
+#define VM_H
+
+/* why vm_run returned. VM_HALTED, VM_FELL_OFF and VM_LIMIT, a map or
+   loadprogram over the memory limits, are final; after VM_BUDGET the
+   machine can simply be run again, and after VM_WAITING it needs vm_input
+   or vm_end_input first */
+enum vm_status { VM_HALTED = 0, VM_FELL_OFF, VM_BUDGET, VM_WAITING,
+    VM_LIMIT };
+
+/* a budget that is never used up */
+#define VM_UNLIMITED UINT64_MAX
+
+typedef struct Vm_T *Vm_T;
+
+Vm_T vm_new(const void *image, size_t size);
+void vm_free(Vm_T *vm);
+enum vm_status vm_run(Vm_T vm, uint64_t budget);
+void vm_input(Vm_T vm, const void *bytes, size_t count);
+void vm_end_input(Vm_T vm);
+size_t vm_output(Vm_T vm, void *buffer, size_t size);
+uint64_t vm_instructions(Vm_T vm);
+void vm_set_limits(Vm_T vm, uint64_t words, uint32_t length,
+                   uint32_t segments);
+
+#endif
+/* VM_H */